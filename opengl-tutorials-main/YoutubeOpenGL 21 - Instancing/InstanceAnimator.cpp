@@ -0,0 +1,103 @@
+#include"InstanceAnimator.h"
+
+#include<glm/gtc/type_ptr.hpp>
+
+// Layout of a single orbit in orbit.comp
+struct GPUOrbit
+{
+	glm::vec4 orbit;
+	glm::vec4 rotation;
+	glm::vec4 scale;
+};
+
+InstanceAnimator::InstanceAnimator
+(
+	InstanceFormat format,
+	std::vector<glm::vec4>& orbits,
+	std::vector<glm::quat>& rotations,
+	std::vector<glm::vec3>& scales
+) :
+	orbitShader("orbit.comp")
+{
+	InstanceAnimator::instanceCount = (unsigned int)orbits.size();
+	InstanceAnimator::format = format;
+
+	std::vector<GPUOrbit> data(instanceCount);
+	for (unsigned int i = 0; i < instanceCount; i++)
+	{
+		// The packed formats store unit quaternions, do the normalizing once here instead of every frame
+		glm::quat rotation = glm::normalize(rotations[i]);
+		// Only one scale fits the 16 byte format, keep the one with the same volume (and mirroring)
+		float volume = scales[i].x * scales[i].y * scales[i].z;
+		float uniformScale = glm::sign(volume) * glm::pow(glm::abs(volume), 1.0f / 3.0f);
+		data[i].orbit = orbits[i];
+		data[i].rotation = glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+		data[i].scale = glm::vec4(scales[i], uniformScale);
+	}
+	glGenBuffers(1, &orbitBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, orbitBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, data.size() * sizeof(GPUOrbit), data.data(), GL_STATIC_DRAW);
+
+	// Written by the GPU and read by the GPU every frame
+	glGenBuffers(1, &instanceBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, instanceCount * instance_words(format) * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glGenQueries(2, timers);
+}
+
+// Writes where every instance is at a given time into instanceBuffer
+void InstanceAnimator::Animate(float time)
+{
+	// Read the timer of the pass before last, it has had a whole frame to finish
+	GLuint timer = timers[frame % 2];
+	GLint available = GL_FALSE;
+	if (frame >= 2)
+		glGetQueryObjectiv(timer, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == GL_TRUE)
+	{
+		GLuint64 elapsed;
+		glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &elapsed);
+		animateTime = elapsed / 1000000.0;
+	}
+	frame++;
+	glBeginQuery(GL_TIME_ELAPSED, timer);
+
+	orbitShader.Activate();
+	glUniform1ui(glGetUniformLocation(orbitShader.ID, "instanceCount"), instanceCount);
+	glUniform1f(glGetUniformLocation(orbitShader.ID, "time"), time);
+	glUniform1ui(glGetUniformLocation(orbitShader.ID, "instanceFormat"), format);
+	glUniform1ui(glGetUniformLocation(orbitShader.ID, "instanceWordCount"), instance_words(format));
+	glUniform3f(glGetUniformLocation(orbitShader.ID, "boundsMin"), boundsMin.x, boundsMin.y, boundsMin.z);
+	glUniform3f(glGetUniformLocation(orbitShader.ID, "boundsMax"), boundsMax.x, boundsMax.y, boundsMax.z);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, orbitBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, instanceBuffer);
+	glDispatchCompute((instanceCount + 63) / 64, 1, 1);
+
+	// The instances are read next as attributes, by the culling pass or by the fetch shader
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	glEndQuery(GL_TIME_ELAPSED);
+}
+
+// GPU time of the last animation pass that finished in milliseconds
+double InstanceAnimator::AnimateTime()
+{
+	return animateTime;
+}
+
+// Deletes the buffers and the shader
+void InstanceAnimator::Delete()
+{
+	glDeleteBuffers(1, &orbitBuffer);
+	glDeleteBuffers(1, &instanceBuffer);
+	glDeleteQueries(2, timers);
+	orbitShader.Delete();
+}
+
+// Tells if the current context has compute shaders
+bool InstanceAnimator::Supported()
+{
+	return GLAD_GL_VERSION_4_3;
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef INSTANCE_ANIMATOR_CLASS_H
+#define INSTANCE_ANIMATOR_CLASS_H
+
+#include"shaderClass.h"
+#include"InstanceFormat.h"
+
+// Moves instances along circular orbits in a compute shader that writes the packed transformations
+// straight into the instance buffer, so the CPU never touches them after they are uploaded once
+class InstanceAnimator
+{
+public:
+	// The packed instances the animation pass writes, draw or cull from this one
+	GLuint instanceBuffer;
+	// Number of instances and how they are stored
+	unsigned int instanceCount;
+	InstanceFormat format;
+	// Box the positions of INSTANCE_COMPACT16 are relative to, it has to fit the whole orbit
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(1.0f);
+
+	// Uploads the orbits (radius, angle at time 0, angular speed and height) and the shape of every instance
+	InstanceAnimator
+	(
+		InstanceFormat format,
+		std::vector<glm::vec4>& orbits,
+		std::vector<glm::quat>& rotations,
+		std::vector<glm::vec3>& scales
+	);
+
+	// Writes where every instance is at a given time into instanceBuffer
+	void Animate(float time);
+	// GPU time of the last animation pass that finished in milliseconds
+	double AnimateTime();
+
+	// Deletes the buffers and the shader
+	void Delete();
+
+	// Tells if the current context has compute shaders
+	static bool Supported();
+
+private:
+	Shader orbitShader;
+	GLuint orbitBuffer;
+
+	// Timer queries that alternate so the result of the last frame is read while the new one runs
+	GLuint timers[2];
+	unsigned int frame = 0;
+	double animateTime = 0.0;
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include"InstanceCuller.h"
+
+#include<algorithm>
+
+InstanceCuller::InstanceCuller(GLuint instanceBuffer, unsigned int instanceCount, InstanceFormat format, std::vector<GLuint> indexCounts, float meshRadius, int width, int height) :
+	cullShader("cull.comp"),
+	pyramidShader("hiz.comp")
+{
+	InstanceCuller::instanceBuffer = instanceBuffer;
+	InstanceCuller::instanceCount = instanceCount;
+	InstanceCuller::format = format;
+	InstanceCuller::meshRadius = meshRadius;
+	InstanceCuller::width = width;
+	InstanceCuller::height = height;
+
+	// The output is rewritten every frame and can hold every instance in case all of them are visible
+	glGenBuffers(1, &visibleBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, instanceCount * instance_words(format) * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+
+	for (unsigned int i = 0; i < indexCounts.size(); i++)
+		commands.push_back(DrawElementsIndirectCommand{ indexCounts[i], 0, 0, 0, 0 });
+	glGenBuffers(1, &commandBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// Depth buffer copy, it has to be a depth format for glCopyTexSubImage2D to read the depth
+	glGenTextures(1, &depthTexture);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// Every level of the pyramid halves the size until a single texel is left
+	levels = 1;
+	while ((std::max(width, height) >> levels) > 0)
+		levels++;
+	glGenTextures(1, &pyramid);
+	glBindTexture(GL_TEXTURE_2D, pyramid);
+	glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenQueries(2, timers);
+}
+
+// Fills visibleBuffer and the commands with the instances the camera can see
+void InstanceCuller::Cull(Camera& camera)
+{
+	// Read the timer of the pass before last, it has had a whole frame to finish
+	GLuint timer = timers[frame % 2];
+	GLint available = GL_FALSE;
+	if (frame >= 2)
+		glGetQueryObjectiv(timer, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == GL_TRUE)
+	{
+		GLuint64 elapsed;
+		glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &elapsed);
+		cullTime = elapsed / 1000000.0;
+	}
+	frame++;
+	glBeginQuery(GL_TIME_ELAPSED, timer);
+
+	// Start from zero instances
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// Gribb-Hartmann: every frustum plane is the last row of the camera matrix plus or minus another row
+	glm::mat4 m = glm::transpose(camera.cameraMatrix);
+	glm::vec4 planes[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+	for (unsigned int i = 0; i < 6; i++)
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+
+	cullShader.Activate();
+	glUniform1ui(glGetUniformLocation(cullShader.ID, "instanceCount"), instanceCount);
+	glUniform1ui(glGetUniformLocation(cullShader.ID, "commandCount"), (GLuint)commands.size());
+	glUniform1ui(glGetUniformLocation(cullShader.ID, "instanceFormat"), format);
+	glUniform1ui(glGetUniformLocation(cullShader.ID, "instanceWordCount"), instance_words(format));
+	glUniform3f(glGetUniformLocation(cullShader.ID, "boundsMin"), boundsMin.x, boundsMin.y, boundsMin.z);
+	glUniform3f(glGetUniformLocation(cullShader.ID, "boundsMax"), boundsMax.x, boundsMax.y, boundsMax.z);
+	glUniform1f(glGetUniformLocation(cullShader.ID, "meshRadius"), meshRadius);
+	glUniform4fv(glGetUniformLocation(cullShader.ID, "frustumPlanes"), 6, glm::value_ptr(planes[0]));
+	glUniform1i(glGetUniformLocation(cullShader.ID, "occlusion"), occlusion && hasPyramid);
+	glUniform2f(glGetUniformLocation(cullShader.ID, "hiZSize"), (float)width, (float)height);
+	glUniformMatrix4fv(glGetUniformLocation(cullShader.ID, "hiZMatrix"), 1, GL_FALSE, glm::value_ptr(pyramidMatrix));
+	glUniform1i(glGetUniformLocation(cullShader.ID, "hiZ"), 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, pyramid);
+
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer, instanceOffset, instanceCount * instance_words(format) * sizeof(GLuint));
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibleBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, commandBuffer);
+	glDispatchCompute((instanceCount + 63) / 64, 1, 1);
+
+	// The draw reads the commands and the instances that were just written (as attributes or from a buffer)
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	glEndQuery(GL_TIME_ELAPSED);
+}
+
+// Copies the depth buffer of the frame that was just drawn and builds the pyramid out of it (call this after the opaque objects)
+void InstanceCuller::UpdatePyramid(Camera& camera)
+{
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+	pyramidShader.Activate();
+	glUniform1i(glGetUniformLocation(pyramidShader.ID, "depthTexture"), 0);
+	for (int level = 0; level < levels; level++)
+	{
+		glUniform1i(glGetUniformLocation(pyramidShader.ID, "firstLevel"), level == 0);
+		if (level > 0)
+			glBindImageTexture(0, pyramid, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		glBindImageTexture(1, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		int levelWidth = std::max(width >> level, 1);
+		int levelHeight = std::max(height >> level, 1);
+		glDispatchCompute((levelWidth + 7) / 8, (levelHeight + 7) / 8, 1);
+		// The next level reads this one
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+	// The culling pass samples the pyramid as a texture
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	pyramidMatrix = camera.cameraMatrix;
+	hasPyramid = true;
+}
+
+// GPU time of the last culling pass that finished in milliseconds
+double InstanceCuller::CullTime()
+{
+	return cullTime;
+}
+
+// Deletes all the buffers, textures and shaders
+void InstanceCuller::Delete()
+{
+	glDeleteBuffers(1, &visibleBuffer);
+	glDeleteBuffers(1, &commandBuffer);
+	glDeleteTextures(1, &depthTexture);
+	glDeleteTextures(1, &pyramid);
+	glDeleteQueries(2, timers);
+	cullShader.Delete();
+	pyramidShader.Delete();
+}
+
+// Tells if the current context has compute shaders and indirect draws
+bool InstanceCuller::Supported()
+{
+	return GLAD_GL_VERSION_4_3;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef INSTANCE_CULLER_CLASS_H
+#define INSTANCE_CULLER_CLASS_H
+
+#include"Model.h"
+#include"InstanceFormat.h"
+
+// Culls instances on the GPU against the camera frustum and a depth pyramid of the previous frame,
+// the instances that pass are packed into a buffer and counted straight into indirect draw commands
+class InstanceCuller
+{
+public:
+	// Every instance, the input of the culling pass (not owned by the culler)
+	GLuint instanceBuffer;
+	// Where the instances start in instanceBuffer, changes every frame when they are streamed
+	GLintptr instanceOffset = 0;
+	// Instances that passed in the same format, instanced meshes read these
+	GLuint visibleBuffer;
+	// One DrawElementsIndirectCommand per mesh with the instance count written by the culling pass
+	GLuint commandBuffer;
+	// Number of instances in instanceBuffer and how they are stored
+	unsigned int instanceCount;
+	InstanceFormat format;
+	// Box the positions of INSTANCE_COMPACT16 are relative to
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(1.0f);
+	// Turn off to only cull against the frustum
+	bool occlusion = true;
+
+	// Makes the output buffers and depth pyramid for a buffer of instances and a screen of the given size
+	InstanceCuller(GLuint instanceBuffer, unsigned int instanceCount, InstanceFormat format, std::vector<GLuint> indexCounts, float meshRadius, int width, int height);
+
+	// Fills visibleBuffer and the commands with the instances the camera can see
+	void Cull(Camera& camera);
+	// Copies the depth buffer of the frame that was just drawn and builds the pyramid out of it (call this after the opaque objects)
+	void UpdatePyramid(Camera& camera);
+	// GPU time of the last culling pass that finished in milliseconds
+	double CullTime();
+
+	// Deletes all the buffers (except instanceBuffer), textures and shaders
+	void Delete();
+
+	// Tells if the current context has compute shaders and indirect draws
+	static bool Supported();
+
+private:
+	Shader cullShader;
+	Shader pyramidShader;
+
+	// Commands with an instance count of 0, copied over the commands before every pass
+	std::vector<DrawElementsIndirectCommand> commands;
+	float meshRadius;
+
+	// Copy of the depth buffer and the pyramid of the farthest depths built from it
+	GLuint depthTexture;
+	GLuint pyramid;
+	int width;
+	int height;
+	int levels;
+	// Camera matrix the pyramid was drawn with
+	glm::mat4 pyramidMatrix;
+	bool hasPyramid = false;
+
+	// Timer queries that alternate so the result of the last frame is read while the new one runs
+	GLuint timers[2];
+	unsigned int frame = 0;
+	double cullTime = 0.0;
+};
+#endif
\ No newline at end of file
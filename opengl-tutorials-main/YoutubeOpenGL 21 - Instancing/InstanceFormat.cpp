@@ -0,0 +1,88 @@
+#include"InstanceFormat.h"
+
+#include<glm/gtc/packing.hpp>
+#include<glm/gtc/matrix_transform.hpp>
+#include<glm/gtc/type_ptr.hpp>
+#include<cstring>
+
+// Number of 32 bit words a single instance takes up
+unsigned int instance_words(InstanceFormat format)
+{
+	switch (format)
+	{
+		case INSTANCE_COMPACT32: return 8;
+		case INSTANCE_COMPACT16: return 4;
+		default: return 16;
+	}
+}
+
+// Puts two 16 bit values into one word, the first one in the low half
+static GLuint pack_pair(glm::uint16 low, glm::uint16 high)
+{
+	return (GLuint)low | ((GLuint)high << 16);
+}
+
+// Packs position, rotation and scale of a single instance into instance_words(format) words at out
+void pack_instance
+(
+	InstanceFormat format,
+	glm::vec3 position,
+	glm::quat rotation,
+	glm::vec3 scale,
+	glm::vec3 boundsMin,
+	glm::vec3 boundsMax,
+	GLuint* out
+)
+{
+	if (format == INSTANCE_MAT4)
+	{
+		glm::mat4 matrix = glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+		memcpy(out, glm::value_ptr(matrix), sizeof(glm::mat4));
+		return;
+	}
+
+	// Snorm can only hold unit quaternions, the shaders normalize again to undo the rounding
+	rotation = glm::normalize(rotation);
+	glm::i16vec4 packedRotation = glm::packSnorm<glm::int16>(glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w));
+	if (format == INSTANCE_COMPACT32)
+	{
+		memcpy(out, glm::value_ptr(position), sizeof(glm::vec3));
+		glm::u16vec4 packedScale = glm::packHalf(glm::vec4(scale, 0.0f));
+		out[3] = pack_pair(packedScale.x, packedScale.y);
+		out[4] = pack_pair(packedScale.z, packedScale.w);
+		out[5] = pack_pair(packedRotation.x, packedRotation.y);
+		out[6] = pack_pair(packedRotation.z, packedRotation.w);
+		out[7] = 0;
+	}
+	else
+	{
+		// The position becomes a fraction of the bounds, which is plenty for a belt a few hundred units wide
+		glm::vec3 relative = glm::clamp((position - boundsMin) / (boundsMax - boundsMin), 0.0f, 1.0f);
+		glm::u16vec3 packedPosition = glm::packUnorm<glm::uint16>(relative);
+		// Only one scale fits, keep the one with the same volume (and mirroring) as the original
+		float volume = scale.x * scale.y * scale.z;
+		float uniformScale = glm::sign(volume) * glm::pow(glm::abs(volume), 1.0f / 3.0f);
+		out[0] = pack_pair(packedPosition.x, packedPosition.y);
+		out[1] = pack_pair(packedPosition.z, glm::packHalf1x16(uniformScale));
+		out[2] = pack_pair(packedRotation.x, packedRotation.y);
+		out[3] = pack_pair(packedRotation.z, packedRotation.w);
+	}
+}
+
+// Packs position, rotation and scale of every instance into a format (the bounds are only used by INSTANCE_COMPACT16)
+std::vector<GLuint> pack_instances
+(
+	InstanceFormat format,
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::quat>& rotations,
+	std::vector<glm::vec3>& scales,
+	glm::vec3 boundsMin,
+	glm::vec3 boundsMax
+)
+{
+	unsigned int words = instance_words(format);
+	std::vector<GLuint> packed(positions.size() * words, 0);
+	for (unsigned int i = 0; i < positions.size(); i++)
+		pack_instance(format, positions[i], rotations[i], scales[i], boundsMin, boundsMax, &packed[i * words]);
+	return packed;
+}
\ No newline at end of file
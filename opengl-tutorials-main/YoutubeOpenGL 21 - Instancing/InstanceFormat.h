@@ -0,0 +1,44 @@
+#ifndef INSTANCE_FORMAT_CLASS_H
+#define INSTANCE_FORMAT_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<glm/gtc/quaternion.hpp>
+#include<vector>
+
+// Ways the transformation of an instance can be stored, the values match the instanceFormat uniform of the shaders
+enum InstanceFormat
+{
+	// Full matrix, 64 bytes
+	INSTANCE_MAT4 = 0,
+	// float3 position, half4 scale (w unused), snorm16x4 rotation and padding, 32 bytes
+	INSTANCE_COMPACT32 = 1,
+	// unorm16x3 position inside the bounds, half uniform scale, snorm16x4 rotation, 16 bytes
+	INSTANCE_COMPACT16 = 2
+};
+
+// Number of 32 bit words a single instance takes up
+unsigned int instance_words(InstanceFormat format);
+
+// Packs position, rotation and scale of a single instance into instance_words(format) words at out
+void pack_instance
+(
+	InstanceFormat format,
+	glm::vec3 position,
+	glm::quat rotation,
+	glm::vec3 scale,
+	glm::vec3 boundsMin,
+	glm::vec3 boundsMax,
+	GLuint* out
+);
+// Packs position, rotation and scale of every instance into a format (the bounds are only used by INSTANCE_COMPACT16)
+std::vector<GLuint> pack_instances
+(
+	InstanceFormat format,
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::quat>& rotations,
+	std::vector<glm::vec3>& scales,
+	glm::vec3 boundsMin = glm::vec3(0.0f),
+	glm::vec3 boundsMax = glm::vec3(1.0f)
+);
+#endif
\ No newline at end of file
@@ -4,12 +4,35 @@ namespace fs = std::filesystem;
 //------------------------------
 
 #include<math.h>
-#include"Model.h"
+#include<cfloat>
+#include<chrono>
+#include<thread>
+#include"InstanceCuller.h"
+#include"StreamBuffer.h"
+#include"InstanceAnimator.h"
+#include"SpatialGrid.h"
 
 
 const unsigned int width = 800;
 const unsigned int height = 800;
 
+// How the asteroid transformations are stored (see InstanceFormat.h)
+InstanceFormat instanceFormat = INSTANCE_COMPACT32;
+// Fetch the asteroid transformations from a shader storage buffer instead of instanced attributes (needs OpenGL 4.3)
+bool fetchInstances = false;
+// Move the asteroids along their orbits every frame, streaming the new transformations through a persistently
+// mapped buffer (needs OpenGL 4.4, raise the number of asteroids to 100000 to see what it costs)
+bool animateInstances = false;
+// Integrate the orbits in a compute shader that writes the instance buffer directly (needs OpenGL 4.3),
+// the persistently mapped stream is only used when this is off or compute shaders are missing
+bool animateOnGPU = true;
+// Time the animation pass for 5 thousand up to 2 million asteroids before opening the scene
+bool benchmarkAnimation = false;
+// Time radius and box queries of a spatial grid over 10 thousand up to 1 million asteroids against going over all of them
+bool benchmarkSpatialGrid = false;
+// Asteroids closer to the camera than this get counted every frame through the spatial grid
+float nearbyRadius = 10.0f;
+
 
 
 float skyboxVertices[] =
@@ -52,6 +75,168 @@ float randf()
 	return -1.0f + (rand() / (RAND_MAX / 2.0f));
 }
 
+// Times the compute animation of ever bigger belts against packing the same belt on the CPU and prints the results
+void benchmark_animation(InstanceFormat format)
+{
+	const unsigned int counts[] = { 5000, 20000, 100000, 500000, 1000000, 2000000 };
+	const unsigned int passes = 100;
+	GLuint timestamps[2];
+	glGenQueries(2, timestamps);
+
+	std::cout << "Asteroids | GPU ms/frame | GPU ns/asteroid | CPU pack ms/frame" << std::endl;
+	for (unsigned int count : counts)
+	{
+		std::vector <glm::vec4> orbits;
+		std::vector <glm::quat> rotations;
+		std::vector <glm::vec3> scales;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			float orbitRadius = 100.0f + randf() * 25.0f;
+			orbits.push_back(glm::vec4(orbitRadius, randf() * 3.14159265f, 20.0f * pow(orbitRadius, -1.5f), randf()));
+			rotations.push_back(glm::quat(1.0f, randf(), randf(), randf()));
+			scales.push_back(0.1f * glm::vec3(randf(), randf(), randf()));
+		}
+		InstanceAnimator animator(format, orbits, rotations, scales);
+		animator.boundsMin = glm::vec3(-125.0f, -1.0f, -125.0f);
+		animator.boundsMax = glm::vec3(125.0f, 1.0f, 125.0f);
+
+		// Warm up, then time a run of passes with timestamps (the animator already has a timer running inside)
+		animator.Animate(0.0f);
+		glQueryCounter(timestamps[0], GL_TIMESTAMP);
+		for (unsigned int pass = 0; pass < passes; pass++)
+			animator.Animate(pass / 60.0f);
+		glQueryCounter(timestamps[1], GL_TIMESTAMP);
+		GLuint64 start, end;
+		glGetQueryObjectui64v(timestamps[0], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(timestamps[1], GL_QUERY_RESULT, &end);
+		double gpuMs = (end - start) / 1000000.0 / passes;
+
+		// What streaming the same belt from the CPU would cost before the upload even starts
+		std::vector <GLuint> words(count * instance_words(format));
+		auto cpuStart = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < count; i++)
+		{
+			float angle = orbits[i].y + orbits[i].z;
+			glm::vec3 position = glm::vec3(cos(angle) * orbits[i].x, orbits[i].w, sin(angle) * orbits[i].x);
+			pack_instance(format, position, rotations[i], scales[i], animator.boundsMin, animator.boundsMax, &words[i * instance_words(format)]);
+		}
+		double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
+
+		std::cout << count << " | " << gpuMs << " | " << gpuMs * 1000000.0 / count << " | " << cpuMs << std::endl;
+		animator.Delete();
+	}
+	glDeleteQueries(2, timestamps);
+}
+
+// Builds spatial grids over ever bigger belts and compares their queries, moves and threaded queries to brute force
+void benchmark_spatial_grid()
+{
+	const unsigned int counts[] = { 10000, 100000, 1000000 };
+	const unsigned int queries = 1000;
+	const unsigned int threads = 4;
+	const float queryRadius = 5.0f;
+
+	std::cout << "Spatial grid | asteroids | build ms | radius ms (brute) | box ms (brute) | found | move 10% ms | " << threads << " threads radius ms" << std::endl;
+	for (unsigned int count : counts)
+	{
+		// Same belt as the scene, just with more asteroids in it
+		std::vector <glm::vec3> positions;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			float angle = randf() * 3.14159265f;
+			float orbitRadius = 100.0f + randf() * 25.0f;
+			positions.push_back(glm::vec3(cos(angle) * orbitRadius, randf(), sin(angle) * orbitRadius));
+		}
+		std::vector <glm::vec3> centers;
+		for (unsigned int i = 0; i < queries; i++)
+			centers.push_back(positions[rand() % count]);
+
+		SpatialGrid grid(4.0f);
+		auto start = std::chrono::steady_clock::now();
+		grid.Build(positions);
+		double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		// Radius queries through the grid and by testing every asteroid, both have to find the same ones
+		std::vector <unsigned int> found;
+		size_t gridFound = 0, bruteFound = 0;
+		start = std::chrono::steady_clock::now();
+		for (glm::vec3 center : centers)
+		{
+			found.clear();
+			grid.QueryRadius(center, queryRadius, found);
+			gridFound += found.size();
+		}
+		double radiusMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		start = std::chrono::steady_clock::now();
+		for (glm::vec3 center : centers)
+		{
+			found.clear();
+			for (unsigned int i = 0; i < count; i++)
+			{
+				glm::vec3 offset = positions[i] - center;
+				if (glm::dot(offset, offset) <= queryRadius * queryRadius)
+					found.push_back(i);
+			}
+			bruteFound += found.size();
+		}
+		double bruteRadiusMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		// Box queries of the same size
+		size_t boxFound = 0, bruteBoxFound = 0;
+		start = std::chrono::steady_clock::now();
+		for (glm::vec3 center : centers)
+		{
+			found.clear();
+			grid.QueryBox(center - queryRadius, center + queryRadius, found);
+			boxFound += found.size();
+		}
+		double boxMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		start = std::chrono::steady_clock::now();
+		for (glm::vec3 center : centers)
+		{
+			found.clear();
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (glm::all(glm::greaterThanEqual(positions[i], center - queryRadius)) && glm::all(glm::lessThanEqual(positions[i], center + queryRadius)))
+					found.push_back(i);
+			}
+			bruteBoxFound += found.size();
+		}
+		double bruteBoxMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		// A tenth of the asteroids drifting a little, most of them stay in their cell
+		start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < count; i += 10)
+		{
+			positions[i] += glm::vec3(0.5f, 0.0f, 0.5f);
+			grid.Move(i, positions[i]);
+		}
+		double moveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		// The same queries spread over a few threads that read the grid at the same time
+		start = std::chrono::steady_clock::now();
+		std::vector <std::thread> workers;
+		for (unsigned int t = 0; t < threads; t++)
+		{
+			workers.emplace_back([&, t]()
+			{
+				std::vector <unsigned int> threadFound;
+				for (unsigned int i = t; i < queries; i += threads)
+				{
+					threadFound.clear();
+					grid.QueryRadius(centers[i], queryRadius, threadFound);
+				}
+			});
+		}
+		for (std::thread& worker : workers)
+			worker.join();
+		double threadedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << count << " | " << buildMs << " | " << radiusMs << " (" << bruteRadiusMs << ") | " << boxMs << " (" << bruteBoxMs << ") | "
+			<< gridFound / queries << (gridFound == bruteFound && boxFound == bruteBoxFound ? "" : " MISMATCH") << " | " << moveMs << " | " << threadedMs << std::endl;
+	}
+}
+
 int main()
 {
 	// Initialize GLFW
@@ -90,7 +275,10 @@ int main()
 	// Generates Shader objects
 	Shader shaderProgram("default.vert", "default.frag");
 	Shader skyboxShader("skybox.vert", "skybox.frag");
-	Shader asteroidShader("asteroid.vert", "default.frag");
+	// The asteroid shader has to match the way the instances are stored
+	fetchInstances = fetchInstances && GLAD_GL_VERSION_4_3;
+	const char* asteroidVertexFile = fetchInstances ? "asteroid_fetch.vert" : instanceFormat == INSTANCE_MAT4 ? "asteroid.vert" : "asteroid_compact.vert";
+	Shader asteroidShader(asteroidVertexFile, "default.frag");
 
 	// Take care of all the light related things
 	glm::vec4 lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
@@ -220,7 +408,12 @@ int main()
 	}
 
 
-	// The number of asteroids to be created
+	if (benchmarkAnimation && InstanceAnimator::Supported())
+		benchmark_animation(instanceFormat);
+	if (benchmarkSpatialGrid)
+		benchmark_spatial_grid();
+
+	// The number of asteroids to be created (raise it up to 1000000 to see how the culling scales)
 	const unsigned int number = 5000;
 	// Radius of circle around which asteroids orbit
 	float radius = 100.0f;
@@ -228,7 +421,15 @@ int main()
 	float radiusDeviation = 25.0f;
 
 	// Holds all transformations for the asteroids
-	std::vector <glm::mat4> instanceMatrix;
+	std::vector <glm::vec3> instancePositions;
+	std::vector <glm::quat> instanceRotations;
+	std::vector <glm::vec3> instanceScales;
+	// Box around every asteroid position, the 16 byte format stores positions relative to it
+	glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+	glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+	// Where every asteroid is along its orbit and how fast it goes around (only used when animating)
+	// (radius, angle at time 0, angular speed, height)
+	std::vector <glm::vec4> orbits;
 
 	for (unsigned int i = 0; i < number; i++)
 	{
@@ -258,22 +459,99 @@ int main()
 		// Generates random scales
 		tempScale = 0.1f * glm::vec3(randf(), randf(), randf());
 
+		// Push the transformations, they get packed into the instance format below
+		instancePositions.push_back(tempTranslation);
+		instanceRotations.push_back(tempRotation);
+		instanceScales.push_back(tempScale);
+		boundsMin = glm::min(boundsMin, tempTranslation);
+		boundsMax = glm::max(boundsMax, tempTranslation);
+
+		// Inner asteroids go around faster, just like planets do (Kepler's third law)
+		float orbitRadius = glm::length(glm::vec2(tempTranslation.x, tempTranslation.z));
+		float orbitAngle = atan2(tempTranslation.z, tempTranslation.x);
+		orbits.push_back(glm::vec4(orbitRadius, orbitAngle, 20.0f * pow(orbitRadius, -1.5f), tempTranslation.y));
+	}
+	// Orbiting asteroids can end up anywhere on their circle, so the bounds have to fit all of them
+	if (animateInstances)
+	{
+		float maxRadius = radius + radiusDeviation;
+		boundsMin = glm::vec3(-maxRadius, boundsMin.y, -maxRadius);
+		boundsMax = glm::vec3(maxRadius, boundsMax.y, maxRadius);
+	}
+	// Lets the CPU find asteroids by where they are without going over all of them
+	SpatialGrid asteroidGrid(4.0f);
+	asteroidGrid.Build(instancePositions);
+	std::vector <unsigned int> nearbyAsteroids;
+
+	// Pack the transformations and upload them into an instance buffer
+	std::vector<GLuint> instanceData = pack_instances(instanceFormat, instancePositions, instanceRotations, instanceScales, boundsMin, boundsMax);
+	VBO instanceVBO(instanceData);
+	instanceVBO.Unbind();
+	std::cout << "Asteroid instances: " << number << " x " << instance_words(instanceFormat) * sizeof(GLuint) << " bytes = "
+		<< instanceData.size() * sizeof(GLuint) / (1024.0 * 1024.0) << " MB" << std::endl;
 
-		// Initialize matrices
-		glm::mat4 trans = glm::mat4(1.0f);
-		glm::mat4 rot = glm::mat4(1.0f);
-		glm::mat4 sca = glm::mat4(1.0f);
+	asteroidShader.Activate();
+	glUniform1i(glGetUniformLocation(asteroidShader.ID, "instanceFormat"), instanceFormat);
+	glUniform3f(glGetUniformLocation(asteroidShader.ID, "boundsMin"), boundsMin.x, boundsMin.y, boundsMin.z);
+	glUniform3f(glGetUniformLocation(asteroidShader.ID, "boundsMax"), boundsMax.x, boundsMax.y, boundsMax.z);
 
-		// Transform the matrices to their correct form
-		trans = glm::translate(trans, tempTranslation);
-		rot = glm::mat4_cast(tempRotation);
-		sca = glm::scale(sca, tempScale);
+	// Create the asteroid model with instancing enabled, it reads the instances from the buffer above
+	Model asteroid((parentDir + asteroidPath).c_str(), number);
+	asteroid.SetInstanceBuffer(instanceVBO.ID, instanceFormat);
 
-		// Push matrix transformation
-		instanceMatrix.push_back(trans * rot * sca);
+	// Culls the asteroids on the GPU when compute shaders are available, the asteroids then only draw the survivors
+	InstanceCuller* culler = NULL;
+	if (InstanceCuller::Supported())
+	{
+		culler = new InstanceCuller(instanceVBO.ID, number, instanceFormat, asteroid.IndexCounts(), asteroid.BoundingRadius(), width, height);
+		culler->boundsMin = boundsMin;
+		culler->boundsMax = boundsMax;
+		asteroid.SetInstanceBuffer(culler->visibleBuffer, instanceFormat);
 	}
-	// Create the asteroid model with instancing enabled
-	Model asteroid((parentDir + asteroidPath).c_str(), number, instanceMatrix);
+	// The buffer the asteroids get drawn from, the fetch shader reads it through binding 3
+	GLuint drawnInstances = culler != NULL ? culler->visibleBuffer : instanceVBO.ID;
+
+	// Streams the animated transformations, one region per frame so the GPU can still read the last two
+	GLsizeiptr instanceStride = instance_words(instanceFormat) * sizeof(GLuint);
+	StreamBuffer* stream = NULL;
+	// Or moves them on the GPU, which leaves the CPU with a single dispatch per frame
+	InstanceAnimator* animator = NULL;
+	if (animateInstances && animateOnGPU && InstanceAnimator::Supported())
+	{
+		animator = new InstanceAnimator(instanceFormat, orbits, instanceRotations, instanceScales);
+		animator->boundsMin = boundsMin;
+		animator->boundsMax = boundsMax;
+		if (culler != NULL)
+		{
+			culler->instanceBuffer = animator->instanceBuffer;
+		}
+		else
+		{
+			asteroid.SetInstanceBuffer(animator->instanceBuffer, instanceFormat);
+			drawnInstances = animator->instanceBuffer;
+		}
+	}
+	else if (animateInstances && StreamBuffer::Supported())
+	{
+		stream = new StreamBuffer(number * instanceStride);
+		if (culler != NULL)
+		{
+			culler->instanceBuffer = stream->ID;
+		}
+		else
+		{
+			asteroid.SetInstanceBuffer(stream->ID, instanceFormat);
+			drawnInstances = stream->ID;
+		}
+	}
+	// Measure the GPU time and the triangles of the asteroid draw, alternating so a result is only read a frame later
+	GLuint drawTimers[2];
+	GLuint drawPrimitives[2];
+	glGenQueries(2, drawTimers);
+	glGenQueries(2, drawPrimitives);
+	unsigned int drawFrame = 0;
+	double drawTime = 0.0;
+	GLuint64 primitives = 0;
 
 
 	// Main while loop
@@ -290,6 +568,19 @@ int main()
 			std::string FPS = std::to_string((1.0 / timeDiff) * counter);
 			std::string ms = std::to_string((timeDiff / counter) * 1000);
 			std::string newTitle = "YoutubeOpenGL - " + FPS + "FPS / " + ms + "ms";
+			// GPU cost of the asteroids and how many triangles per second they push through
+			if (culler != NULL)
+				newTitle += " / cull " + std::to_string(culler->CullTime()) + "ms";
+			newTitle += " / draw " + std::to_string(drawTime) + "ms, " + std::to_string(primitives) + " tris";
+			if (drawTime > 0.0)
+				newTitle += " (" + std::to_string(primitives / drawTime / 1000.0) + " Mtris/s)";
+			// Frames where the CPU had to wait for the GPU before it could write the transformations
+			if (stream != NULL)
+				newTitle += " / " + std::to_string(stream->stalls) + " stalls";
+			if (animator != NULL)
+				newTitle += " / animate " + std::to_string(animator->AnimateTime()) + "ms";
+			// Asteroids the grid found around the camera (the GPU animation never tells the CPU where they went)
+			newTitle += " / " + std::to_string(nearbyAsteroids.size()) + " asteroids nearby";
 			glfwSetWindowTitle(window, newTitle.c_str());
 
 			// Resets times and counter
@@ -313,8 +604,76 @@ int main()
 
 		// Draw jupiter
 		jupiter.Draw(shaderProgram, camera);
-		// Draw the asteroids
-		asteroid.Draw(asteroidShader, camera);
+		// Read the asteroid queries of the frame before last if they are done
+		GLint available = GL_FALSE;
+		if (drawFrame >= 2)
+			glGetQueryObjectiv(drawTimers[drawFrame % 2], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_TRUE)
+		{
+			GLuint64 elapsed;
+			glGetQueryObjectui64v(drawTimers[drawFrame % 2], GL_QUERY_RESULT, &elapsed);
+			glGetQueryObjectui64v(drawPrimitives[drawFrame % 2], GL_QUERY_RESULT, &primitives);
+			drawTime = elapsed / 1000000.0;
+		}
+
+		// Move the asteroids along their orbits and write them straight into this frame's region of the stream
+		GLintptr streamOffset = 0;
+		if (stream != NULL)
+		{
+			stream->Begin();
+			GLuint* words = (GLuint*)stream->Allocate(number * instanceStride, instanceStride, streamOffset);
+			float orbitTime = (float)glfwGetTime();
+			for (unsigned int i = 0; i < number; i++)
+			{
+				float angle = orbits[i].y + orbits[i].z * orbitTime;
+				glm::vec3 position = glm::vec3(cos(angle) * orbits[i].x, orbits[i].w, sin(angle) * orbits[i].x);
+				pack_instance(instanceFormat, position, instanceRotations[i], instanceScales[i], boundsMin, boundsMax, words + i * instance_words(instanceFormat));
+				// Most asteroids stay in their cell from one frame to the next, which only updates the stored position
+				asteroidGrid.Move(i, position);
+			}
+			// The culler reads from the region directly, otherwise the draw starts at the region's first instance
+			if (culler != NULL)
+				culler->instanceOffset = streamOffset;
+			else
+				asteroid.SetBaseInstance((GLuint)(streamOffset / instanceStride));
+		}
+
+		if (animator != NULL)
+			animator->Animate((float)glfwGetTime());
+
+		// Look for the asteroids around the camera like a ship would before checking them for collisions
+		nearbyAsteroids.clear();
+		asteroidGrid.QueryRadius(camera.Position, nearbyRadius, nearbyAsteroids);
+
+		// Draw the asteroids, when culling only the ones the camera can see get drawn
+		if (culler != NULL)
+			culler->Cull(camera);
+		// The fetch shader only sees gl_InstanceID which doesn't include the base instance, so bind the region instead
+		if (fetchInstances && stream != NULL && culler == NULL)
+		{
+			asteroid.SetBaseInstance(0);
+			stream->BindRange(GL_SHADER_STORAGE_BUFFER, 3, streamOffset, number * instanceStride);
+		}
+		else if (fetchInstances)
+		{
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, drawnInstances);
+		}
+		glBeginQuery(GL_TIME_ELAPSED, drawTimers[drawFrame % 2]);
+		glBeginQuery(GL_PRIMITIVES_GENERATED, drawPrimitives[drawFrame % 2]);
+		if (culler != NULL)
+			asteroid.DrawIndirect(asteroidShader, camera, culler->commandBuffer);
+		else
+			asteroid.Draw(asteroidShader, camera);
+		glEndQuery(GL_PRIMITIVES_GENERATED);
+		glEndQuery(GL_TIME_ELAPSED);
+		drawFrame++;
+		// Nothing else reads this frame's region, so it can be fenced off right away
+		if (stream != NULL)
+			stream->End();
+
+		// Everything opaque has been drawn, so the depth buffer can be turned into next frame's occlusion pyramid
+		if (culler != NULL)
+			culler->UpdatePyramid(camera);
 
 		// Since the cubemap will always have a depth of 1.0, we need that equal sign so it doesn't get discarded
 		glDepthFunc(GL_LEQUAL);
@@ -352,6 +711,25 @@ int main()
 	// Delete all the objects we've created
 	shaderProgram.Delete();
 	skyboxShader.Delete();
+	asteroidShader.Delete();
+	instanceVBO.Delete();
+	if (stream != NULL)
+	{
+		stream->Delete();
+		delete stream;
+	}
+	if (animator != NULL)
+	{
+		animator->Delete();
+		delete animator;
+	}
+	if (culler != NULL)
+	{
+		culler->Delete();
+		delete culler;
+	}
+	glDeleteQueries(2, drawTimers);
+	glDeleteQueries(2, drawPrimitives);
 	// Delete window before ending the program
 	glfwDestroyWindow(window);
 	// Terminate GLFW before ending the program
@@ -47,6 +47,75 @@ Mesh::Mesh
 }
 
 
+// Makes the instance attributes (4 to 7) read their transformations from another buffer
+void Mesh::SetInstanceBuffer(GLuint buffer, InstanceFormat format)
+{
+	VAO.Bind();
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	GLsizei stride = instance_words(format) * sizeof(GLuint);
+	if (format == INSTANCE_MAT4)
+	{
+		// Same layout as the instance VBO made in the constructor
+		for (unsigned int i = 0; i < 4; i++)
+			glVertexAttribPointer(4 + i, 4, GL_FLOAT, GL_FALSE, stride, (void*)(i * sizeof(glm::vec4)));
+	}
+	else if (format == INSTANCE_COMPACT32)
+	{
+		// Position, half scale and normalized short rotation, the GPU converts them to floats on the fly
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+		glVertexAttribPointer(5, 4, GL_HALF_FLOAT, GL_FALSE, stride, (void*)12);
+		glVertexAttribPointer(6, 4, GL_SHORT, GL_TRUE, stride, (void*)20);
+	}
+	else
+	{
+		// Position as a fraction of the bounds, one half scale and normalized short rotation
+		glVertexAttribPointer(4, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0);
+		glVertexAttribPointer(5, 1, GL_HALF_FLOAT, GL_FALSE, stride, (void*)6);
+		glVertexAttribPointer(6, 4, GL_SHORT, GL_TRUE, stride, (void*)8);
+	}
+	// Only the attributes the format uses stay on, the divisors are part of the VAO
+	unsigned int attributes = format == INSTANCE_MAT4 ? 4 : 3;
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		if (i < attributes)
+		{
+			glEnableVertexAttribArray(4 + i);
+			glVertexAttribDivisor(4 + i, 1);
+		}
+		else
+		{
+			glDisableVertexAttribArray(4 + i);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	VAO.Unbind();
+}
+
+// Draws the instances with the command at a given offset of the bound GL_DRAW_INDIRECT_BUFFER
+void Mesh::DrawIndirect(Shader& shader, Camera& camera, GLintptr command)
+{
+	shader.Activate();
+	VAO.Bind();
+
+	BindTextures(shader);
+	// Take care of the camera Matrix
+	glUniform3f(glGetUniformLocation(shader.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
+	camera.Matrix(shader, "camMatrix");
+
+	// The instance count was written by the GPU, the CPU never gets to see it
+	glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)command);
+}
+
+// Radius of a sphere around the origin that contains every vertex
+float Mesh::BoundingRadius()
+{
+	float radius = 0.0f;
+	for (unsigned int i = 0; i < vertices.size(); i++)
+		radius = glm::max(radius, glm::length(vertices[i].position));
+	return radius;
+}
+
+
 void Mesh::Draw
 (
 	Shader& shader, 
@@ -61,25 +130,7 @@ void Mesh::Draw
 	shader.Activate();
 	VAO.Bind();
 
-	// Keep track of how many of each type of textures we have
-	unsigned int numDiffuse = 0;
-	unsigned int numSpecular = 0;
-
-	for (unsigned int i = 0; i < textures.size(); i++)
-	{
-		std::string num;
-		std::string type = textures[i].type;
-		if (type == "diffuse")
-		{
-			num = std::to_string(numDiffuse++);
-		}
-		else if (type == "specular")
-		{
-			num = std::to_string(numSpecular++);
-		}
-		textures[i].texUnit(shader, (type + num).c_str(), i);
-		textures[i].Bind();
-	}
+	BindTextures(shader);
 	// Take care of the camera Matrix
 	glUniform3f(glGetUniformLocation(shader.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
 	camera.Matrix(shader, "camMatrix");
@@ -108,6 +159,33 @@ void Mesh::Draw
 	}
 	else
 	{
-		glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instancing);
+		if (baseInstance == 0)
+			glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instancing);
+		else
+			glDrawElementsInstancedBaseInstance(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instancing, baseInstance);
+	}
+}
+
+// Binds the textures of the mesh and points the shader's samplers at them
+void Mesh::BindTextures(Shader& shader)
+{
+	// Keep track of how many of each type of textures we have
+	unsigned int numDiffuse = 0;
+	unsigned int numSpecular = 0;
+
+	for (unsigned int i = 0; i < textures.size(); i++)
+	{
+		std::string num;
+		std::string type = textures[i].type;
+		if (type == "diffuse")
+		{
+			num = std::to_string(numDiffuse++);
+		}
+		else if (type == "specular")
+		{
+			num = std::to_string(numSpecular++);
+		}
+		textures[i].texUnit(shader, (type + num).c_str(), i);
+		textures[i].Bind();
 	}
 }
\ No newline at end of file
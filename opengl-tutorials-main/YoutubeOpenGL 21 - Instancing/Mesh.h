@@ -7,6 +7,17 @@
 #include"EBO.h"
 #include"Camera.h"
 #include"Texture.h"
+#include"InstanceFormat.h"
+
+// Layout of the commands read by glDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
 
 class Mesh
 {
@@ -19,6 +30,8 @@ public:
 
 	// Holds number of instances (if 1 the mesh will be rendered normally)
 	unsigned int instancing;
+	// Instance the instanced attributes start reading at (lets a mesh draw out of any region of a stream buffer)
+	GLuint baseInstance = 0;
 
 	// Initializes the mesh
 	Mesh
@@ -40,5 +53,14 @@ public:
 		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
 		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f)
 	);
+
+	// Binds the textures of the mesh and points the shader's samplers at them
+	void BindTextures(Shader& shader);
+	// Makes the instance attributes (4 to 7) read their transformations from another buffer
+	void SetInstanceBuffer(GLuint buffer, InstanceFormat format = INSTANCE_MAT4);
+	// Draws the instances with the command at a given offset of the bound GL_DRAW_INDIRECT_BUFFER
+	void DrawIndirect(Shader& shader, Camera& camera, GLintptr command);
+	// Radius of a sphere around the origin that contains every vertex
+	float BoundingRadius();
 };
 #endif
\ No newline at end of file
@@ -26,6 +26,53 @@ void Model::Draw(Shader& shader, Camera& camera, glm::vec3 translation, glm::qua
 	}
 }
 
+void Model::SetInstanceBuffer(GLuint buffer, InstanceFormat format)
+{
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		meshes[i].SetInstanceBuffer(buffer, format);
+	}
+}
+
+void Model::SetBaseInstance(GLuint baseInstance)
+{
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		meshes[i].baseInstance = baseInstance;
+	}
+}
+
+void Model::DrawIndirect(Shader& shader, Camera& camera, GLuint commandBuffer)
+{
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		meshes[i].DrawIndirect(shader, camera, i * sizeof(DrawElementsIndirectCommand));
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+std::vector<GLuint> Model::IndexCounts()
+{
+	std::vector<GLuint> counts;
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		counts.push_back((GLuint)meshes[i].indices.size());
+	}
+	return counts;
+}
+
+float Model::BoundingRadius()
+{
+	// Instanced meshes ignore their node transformations, so only the vertices themselves matter
+	float radius = 0.0f;
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		radius = glm::max(radius, meshes[i].BoundingRadius());
+	}
+	return radius;
+}
+
 void Model::loadMesh(unsigned int indMesh)
 {
 	// Get all accessor indices
@@ -22,6 +22,17 @@ public:
 		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f)
 	);
 
+	// Makes every mesh read its instance transformations from another buffer
+	void SetInstanceBuffer(GLuint buffer, InstanceFormat format = INSTANCE_MAT4);
+	// Makes every mesh start reading its instanced attributes at a given instance
+	void SetBaseInstance(GLuint baseInstance);
+	// Draws every mesh with its own command out of a buffer of DrawElementsIndirectCommands (one per mesh)
+	void DrawIndirect(Shader& shader, Camera& camera, GLuint commandBuffer);
+	// Number of indices of every mesh, in the order DrawIndirect expects their commands
+	std::vector<GLuint> IndexCounts();
+	// Radius of a sphere around the origin of an instance that contains all of its meshes
+	float BoundingRadius();
+
 private:
 	// Variables for easy access
 	const char* file;
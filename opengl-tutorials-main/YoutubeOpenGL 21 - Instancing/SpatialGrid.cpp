@@ -0,0 +1,223 @@
+#include"SpatialGrid.h"
+
+#include<cmath>
+
+SpatialGrid::SpatialGrid(float cellSize)
+{
+	SpatialGrid::cellSize = cellSize;
+	table.assign(64, empty);
+}
+
+// Throws everything away and adds all the positions at once, instance i gets position i
+void SpatialGrid::Build(const std::vector<glm::vec3>& positions)
+{
+	cells.clear();
+	table.assign(64, empty);
+	instanceCells.assign(positions.size(), empty);
+	instanceSlots.assign(positions.size(), empty);
+	count = 0;
+
+	// Find the cell of every instance first and count what goes where, so every cell's entries get allocated once
+	std::vector<unsigned int> cellOf(positions.size());
+	for (unsigned int i = 0; i < positions.size(); i++)
+		cellOf[i] = findOrAdd(coordinatesOf(positions[i]));
+	std::vector<unsigned int> sizes(cells.size(), 0);
+	for (unsigned int i = 0; i < positions.size(); i++)
+		sizes[cellOf[i]]++;
+	for (unsigned int i = 0; i < cells.size(); i++)
+		cells[i].entries.reserve(sizes[i]);
+	for (unsigned int i = 0; i < positions.size(); i++)
+	{
+		Cell& cell = cells[cellOf[i]];
+		instanceCells[i] = cellOf[i];
+		instanceSlots[i] = (unsigned int)cell.entries.size();
+		cell.entries.push_back(Entry{ positions[i], i });
+	}
+	count = (unsigned int)positions.size();
+}
+
+// Adds a single instance
+void SpatialGrid::Insert(unsigned int instance, glm::vec3 position)
+{
+	if (instance >= instanceCells.size())
+	{
+		instanceCells.resize(instance + 1, empty);
+		instanceSlots.resize(instance + 1, empty);
+	}
+	if (instanceCells[instance] != empty)
+	{
+		Move(instance, position);
+		return;
+	}
+	unsigned int cell = findOrAdd(coordinatesOf(position));
+	instanceCells[instance] = cell;
+	instanceSlots[instance] = (unsigned int)cells[cell].entries.size();
+	cells[cell].entries.push_back(Entry{ position, instance });
+	count++;
+}
+
+// Moves a single instance, an instance that stays in its cell only has its position updated
+void SpatialGrid::Move(unsigned int instance, glm::vec3 position)
+{
+	if (instance >= instanceCells.size() || instanceCells[instance] == empty)
+	{
+		Insert(instance, position);
+		return;
+	}
+	Cell& cell = cells[instanceCells[instance]];
+	if (cell.coordinates == coordinatesOf(position))
+	{
+		cell.entries[instanceSlots[instance]].position = position;
+		return;
+	}
+	Remove(instance);
+	Insert(instance, position);
+}
+
+// Removes a single instance
+void SpatialGrid::Remove(unsigned int instance)
+{
+	if (instance >= instanceCells.size() || instanceCells[instance] == empty)
+		return;
+	// The last entry of the cell takes the place of the removed one so the entries stay packed
+	std::vector<Entry>& entries = cells[instanceCells[instance]].entries;
+	unsigned int slot = instanceSlots[instance];
+	entries[slot] = entries.back();
+	instanceSlots[entries[slot].instance] = slot;
+	entries.pop_back();
+	instanceCells[instance] = empty;
+	instanceSlots[instance] = empty;
+	count--;
+}
+
+// Adds the instances within radius of center to out
+void SpatialGrid::QueryRadius(glm::vec3 center, float radius, std::vector<unsigned int>& out) const
+{
+	float radius2 = radius * radius;
+	forCells(coordinatesOf(center - radius), coordinatesOf(center + radius), [&](const Cell& cell)
+	{
+		for (const Entry& entry : cell.entries)
+		{
+			glm::vec3 offset = entry.position - center;
+			if (glm::dot(offset, offset) <= radius2)
+				out.push_back(entry.instance);
+		}
+	});
+}
+
+// Adds the instances inside of the box to out
+void SpatialGrid::QueryBox(glm::vec3 boxMin, glm::vec3 boxMax, std::vector<unsigned int>& out) const
+{
+	forCells(coordinatesOf(boxMin), coordinatesOf(boxMax), [&](const Cell& cell)
+	{
+		for (const Entry& entry : cell.entries)
+		{
+			if (glm::all(glm::greaterThanEqual(entry.position, boxMin)) && glm::all(glm::lessThanEqual(entry.position, boxMax)))
+				out.push_back(entry.instance);
+		}
+	});
+}
+
+// Every cell that was ever used
+const std::vector<SpatialGrid::Cell>& SpatialGrid::Cells() const
+{
+	return cells;
+}
+
+glm::vec3 SpatialGrid::CellMin(const Cell& cell) const
+{
+	return glm::vec3(cell.coordinates) * cellSize;
+}
+
+glm::vec3 SpatialGrid::CellMax(const Cell& cell) const
+{
+	return glm::vec3(cell.coordinates + 1) * cellSize;
+}
+
+// Number of instances in the grid
+unsigned int SpatialGrid::Size() const
+{
+	return count;
+}
+
+glm::ivec3 SpatialGrid::coordinatesOf(glm::vec3 position) const
+{
+	return glm::ivec3(glm::floor(position / cellSize));
+}
+
+unsigned int SpatialGrid::hash(glm::ivec3 coordinates)
+{
+	// Large primes spread neighbouring cells over the whole table
+	return (unsigned int)coordinates.x * 73856093u ^ (unsigned int)coordinates.y * 19349663u ^ (unsigned int)coordinates.z * 83492791u;
+}
+
+// Finds a cell, returns empty if there is none
+unsigned int SpatialGrid::find(glm::ivec3 coordinates) const
+{
+	unsigned int mask = (unsigned int)table.size() - 1;
+	for (unsigned int slot = hash(coordinates) & mask; ; slot = (slot + 1) & mask)
+	{
+		unsigned int cell = table[slot];
+		if (cell == empty || cells[cell].coordinates == coordinates)
+			return cell;
+	}
+}
+
+// Finds a cell or makes it
+unsigned int SpatialGrid::findOrAdd(glm::ivec3 coordinates)
+{
+	unsigned int mask = (unsigned int)table.size() - 1;
+	unsigned int slot = hash(coordinates) & mask;
+	for (; table[slot] != empty; slot = (slot + 1) & mask)
+	{
+		if (cells[table[slot]].coordinates == coordinates)
+			return table[slot];
+	}
+	table[slot] = (unsigned int)cells.size();
+	cells.push_back(Cell{ coordinates, {} });
+	if (cells.size() * 2 > table.size())
+		grow();
+	return (unsigned int)cells.size() - 1;
+}
+
+// Doubles the table and puts every cell into it again
+void SpatialGrid::grow()
+{
+	table.assign(table.size() * 2, empty);
+	unsigned int mask = (unsigned int)table.size() - 1;
+	for (unsigned int i = 0; i < cells.size(); i++)
+	{
+		unsigned int slot = hash(cells[i].coordinates) & mask;
+		while (table[slot] != empty)
+			slot = (slot + 1) & mask;
+		table[slot] = i;
+	}
+}
+
+// Calls visit for every cell that overlaps the box of cell coordinates
+template<typename Visit> void SpatialGrid::forCells(glm::ivec3 first, glm::ivec3 last, Visit visit) const
+{
+	// A box that covers more cells than exist is cheaper to answer by going over the cells that do
+	glm::dvec3 span = glm::dvec3(last - first) + 1.0;
+	if (span.x * span.y * span.z > (double)cells.size())
+	{
+		for (const Cell& cell : cells)
+		{
+			if (glm::all(glm::greaterThanEqual(cell.coordinates, first)) && glm::all(glm::lessThanEqual(cell.coordinates, last)))
+				visit(cell);
+		}
+		return;
+	}
+	for (int z = first.z; z <= last.z; z++)
+	{
+		for (int y = first.y; y <= last.y; y++)
+		{
+			for (int x = first.x; x <= last.x; x++)
+			{
+				unsigned int cell = find(glm::ivec3(x, y, z));
+				if (cell != empty)
+					visit(cells[cell]);
+			}
+		}
+	}
+}
\ No newline at end of file
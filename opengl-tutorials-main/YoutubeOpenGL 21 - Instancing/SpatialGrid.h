@@ -0,0 +1,76 @@
+#ifndef SPATIAL_GRID_CLASS_H
+#define SPATIAL_GRID_CLASS_H
+
+#include<glm/glm.hpp>
+#include<vector>
+
+// Spatial hash over the positions of instances, for questions like "which asteroids are near the ship" that
+// shouldn't have to go over every instance. Space is split into cubes of cellSize and only the cubes that hold
+// something exist, they are found through an open addressing hash table. Every cell keeps the positions of its
+// instances next to their indices, so a query reads one small contiguous array per cell and never the instances.
+//
+// The queries only read, any number of threads can run them at the same time as long as nothing is being
+// added, moved or removed while they do.
+class SpatialGrid
+{
+public:
+	// An instance as a cell stores it
+	struct Entry
+	{
+		glm::vec3 position;
+		unsigned int instance;
+	};
+	// A cube of space and the instances inside of it
+	struct Cell
+	{
+		glm::ivec3 coordinates;
+		std::vector<Entry> entries;
+	};
+
+	// Edge length of the cells, queries with a radius of about this size are the fastest
+	float cellSize;
+
+	SpatialGrid(float cellSize = 4.0f);
+
+	// Throws everything away and adds all the positions at once, instance i gets position i
+	void Build(const std::vector<glm::vec3>& positions);
+	// Adds, moves and removes single instances (an instance that stays in its cell only has its position updated)
+	void Insert(unsigned int instance, glm::vec3 position);
+	void Move(unsigned int instance, glm::vec3 position);
+	void Remove(unsigned int instance);
+
+	// Adds the instances within radius of center or inside of the box to out (out is not cleared)
+	void QueryRadius(glm::vec3 center, float radius, std::vector<unsigned int>& out) const;
+	void QueryBox(glm::vec3 boxMin, glm::vec3 boxMax, std::vector<unsigned int>& out) const;
+
+	// Every cell that was ever used (some may be empty again), for visibility code that wants to test whole cells
+	const std::vector<Cell>& Cells() const;
+	// Corners of a cell, an instance in it can stick out of it by as much as the instance is big
+	glm::vec3 CellMin(const Cell& cell) const;
+	glm::vec3 CellMax(const Cell& cell) const;
+	// Number of instances in the grid
+	unsigned int Size() const;
+
+private:
+	static constexpr unsigned int empty = 0xFFFFFFFF;
+
+	std::vector<Cell> cells;
+	// Cell index of every slot, a power of two in size and never more than half full
+	std::vector<unsigned int> table;
+	// Cell and position in the cell of every instance (empty for instances that aren't in the grid)
+	std::vector<unsigned int> instanceCells;
+	std::vector<unsigned int> instanceSlots;
+	unsigned int count = 0;
+
+	glm::ivec3 coordinatesOf(glm::vec3 position) const;
+	static unsigned int hash(glm::ivec3 coordinates);
+	// Finds a cell, returns empty if there is none
+	unsigned int find(glm::ivec3 coordinates) const;
+	// Finds a cell or makes it
+	unsigned int findOrAdd(glm::ivec3 coordinates);
+	// Doubles the table and puts every cell into it again
+	void grow();
+	// Calls visit for every cell that overlaps the box of cell coordinates
+	template<typename Visit> void forCells(glm::ivec3 first, glm::ivec3 last, Visit visit) const;
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include"StreamBuffer.h"
+
+#include<iostream>
+#include<stdexcept>
+
+// Creates the buffer and maps it for the lifetime of the buffer
+StreamBuffer::StreamBuffer(GLsizeiptr regionSize)
+{
+	// Regions start on an alignment every kind of binding accepts
+	GLintptr alignment = Alignment();
+	StreamBuffer::regionSize = (regionSize + alignment - 1) / alignment * alignment;
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &ID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, StreamBuffer::regionSize * regions, NULL, flags);
+	// Coherent means writes show up on the GPU without having to flush them
+	mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, StreamBuffer::regionSize * regions, flags);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	if (mapped == NULL)
+		throw std::runtime_error("Failed to map the stream buffer");
+}
+
+// Moves on to the next region, waiting for the GPU to finish reading it if needed
+void StreamBuffer::Begin()
+{
+	region = (region + 1) % regions;
+	used = 0;
+	if (fences[region] == 0)
+		return;
+
+	// Three regions give the GPU two frames to catch up, so this should almost never block
+	GLenum result = glClientWaitSync(fences[region], 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		stalls++;
+		while (result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	}
+	glDeleteSync(fences[region]);
+	fences[region] = 0;
+}
+
+// Reserves bytes in the current region, returns where to write them and sets offset to where they are in the buffer
+void* StreamBuffer::Allocate(GLsizeiptr size, GLintptr alignment, GLintptr& offset)
+{
+	GLsizeiptr start = (used + alignment - 1) / alignment * alignment;
+	if (start + size > regionSize)
+		throw std::out_of_range("Stream buffer region is full");
+	used = start + size;
+	offset = region * regionSize + start;
+	return mapped + offset;
+}
+
+// Binds a part of the buffer to an indexed target like GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER
+void StreamBuffer::BindRange(GLenum target, GLuint index, GLintptr offset, GLsizeiptr size)
+{
+	glBindBufferRange(target, index, ID, offset, size);
+}
+
+// Fences the current region so it isn't written again before the GPU is done with it
+void StreamBuffer::End()
+{
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// Unmaps and deletes the buffer
+void StreamBuffer::Delete()
+{
+	for (unsigned int i = 0; i < regions; i++)
+		if (fences[i] != 0)
+			glDeleteSync(fences[i]);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(1, &ID);
+}
+
+// Tells if the current context can make persistently mapped buffers
+bool StreamBuffer::Supported()
+{
+	return GLAD_GL_VERSION_4_4;
+}
+
+// Alignment that satisfies vertex, uniform and shader storage offsets
+GLintptr StreamBuffer::Alignment()
+{
+	GLint uniformAlignment = 256;
+	GLint storageAlignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+	// Never go below 256 so every instance format (64, 32 or 16 bytes) divides the region offsets evenly
+	GLint alignment = 256;
+	while (alignment < uniformAlignment || alignment < storageAlignment)
+		alignment *= 2;
+	return alignment;
+}
\ No newline at end of file
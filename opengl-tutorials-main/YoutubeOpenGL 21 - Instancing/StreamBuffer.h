@@ -0,0 +1,48 @@
+#ifndef STREAM_BUFFER_CLASS_H
+#define STREAM_BUFFER_CLASS_H
+
+#include<glad/glad.h>
+
+// Persistently mapped buffer split into three regions, the CPU writes one region while the GPU reads the other two.
+// Every frame Begin waits until the GPU is done with the region (normally it already is), Allocate hands out
+// pieces of it for instances, uniform blocks or vertices and End fences it off (needs OpenGL 4.4)
+class StreamBuffer
+{
+public:
+	// Reference ID of the buffer
+	GLuint ID;
+	// Size of a single region in bytes
+	GLsizeiptr regionSize;
+	// Number of times Begin actually had to wait for the GPU
+	unsigned int stalls = 0;
+
+	// Creates the buffer and maps it for the lifetime of the buffer
+	StreamBuffer(GLsizeiptr regionSize);
+
+	// Moves on to the next region, waiting for the GPU to finish reading it if needed
+	void Begin();
+	// Reserves bytes in the current region, returns where to write them and sets offset to where they are in the buffer
+	void* Allocate(GLsizeiptr size, GLintptr alignment, GLintptr& offset);
+	// Binds a part of the buffer to an indexed target like GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER
+	void BindRange(GLenum target, GLuint index, GLintptr offset, GLsizeiptr size);
+	// Fences the current region so it isn't written again before the GPU is done with it
+	void End();
+
+	// Unmaps and deletes the buffer
+	void Delete();
+
+	// Tells if the current context can make persistently mapped buffers
+	static bool Supported();
+	// Alignment that satisfies vertex, uniform and shader storage offsets
+	static GLintptr Alignment();
+
+private:
+	static const unsigned int regions = 3;
+
+	unsigned char* mapped;
+	GLsync fences[regions] = { 0, 0, 0 };
+	unsigned int region = 0;
+	// Bytes already handed out in the current region
+	GLsizeiptr used = 0;
+};
+#endif
\ No newline at end of file
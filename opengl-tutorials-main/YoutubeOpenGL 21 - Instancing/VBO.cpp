@@ -14,6 +14,13 @@ VBO::VBO(std::vector<glm::mat4>& mat4s)
 	glBufferData(GL_ARRAY_BUFFER, mat4s.size() * sizeof(glm::mat4), mat4s.data(), GL_STATIC_DRAW);
 }
 
+VBO::VBO(std::vector<GLuint>& words)
+{
+	glGenBuffers(1, &ID);
+	glBindBuffer(GL_ARRAY_BUFFER, ID);
+	glBufferData(GL_ARRAY_BUFFER, words.size() * sizeof(GLuint), words.data(), GL_STATIC_DRAW);
+}
+
 // Binds the VBO
 void VBO::Bind()
 {
@@ -24,6 +24,8 @@ public:
 	// Constructor that generates a Vertex Buffer Object and links it to vertices
 	VBO(std::vector<Vertex>& vertices);
 	VBO(std::vector<glm::mat4>& mat4s);
+	// Constructor that generates a Vertex Buffer Object out of raw 32 bit words (like packed instances)
+	VBO(std::vector<GLuint>& words);
 
 	// Binds the VBO
 	void Bind();
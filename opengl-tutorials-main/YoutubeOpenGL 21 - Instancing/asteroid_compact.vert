@@ -0,0 +1,59 @@
+#version 330 core
+
+// Positions/Coordinates
+layout (location = 0) in vec3 aPos;
+// Normals (not necessarily normalized)
+layout (location = 1) in vec3 aNormal;
+// Colors
+layout (location = 2) in vec3 aColor;
+// Texture Coordinates
+layout (location = 3) in vec2 aTex;
+// Compact instance transformations (see InstanceFormat.h), the GPU converts halfs and snorms on its own
+layout (location = 4) in vec3 instancePosition;
+layout (location = 5) in vec4 instanceScale;
+layout (location = 6) in vec4 instanceRotation;
+
+
+// Outputs the current position for the Fragment Shader
+out vec3 crntPos;
+// Outputs the normal for the Fragment Shader
+out vec3 Normal;
+// Outputs the color for the Fragment Shader
+out vec3 color;
+// Outputs the texture coordinates to the Fragment Shader
+out vec2 texCoord;
+
+
+
+// Imports the camera matrix
+uniform mat4 camMatrix;
+// 1 for the 32 byte format, 2 for the 16 byte format
+uniform int instanceFormat;
+// Box the positions of the 16 byte format are relative to
+uniform vec3 boundsMin;
+uniform vec3 boundsMax;
+
+
+// Rotates a vector by a unit quaternion
+vec3 rotate(vec4 q, vec3 v)
+{
+	return v + 2.0f * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main()
+{
+	// Unpack the instance, the 16 byte format stores a fraction of the bounds and a single scale
+	vec3 position = instanceFormat == 2 ? mix(boundsMin, boundsMax, instancePosition) : instancePosition;
+	vec3 scale = instanceFormat == 2 ? vec3(instanceScale.x) : instanceScale.xyz;
+	// calculates current position
+	crntPos = position + rotate(normalize(instanceRotation), scale * aPos);
+	// Assigns the normal from the Vertex Data to "Normal"
+	Normal = aNormal;
+	// Assigns the colors from the Vertex Data to "color"
+	color = aColor;
+	// Assigns the texture coordinates from the Vertex Data to "texCoord"
+	texCoord = mat2(0.0, -1.0, 1.0, 0.0) * aTex;
+	
+	// Outputs the positions/coordinates of all vertices
+	gl_Position = camMatrix * vec4(crntPos, 1.0);
+}
\ No newline at end of file
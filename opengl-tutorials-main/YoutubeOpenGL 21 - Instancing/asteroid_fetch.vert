@@ -0,0 +1,86 @@
+#version 430 core
+
+// Positions/Coordinates
+layout (location = 0) in vec3 aPos;
+// Normals (not necessarily normalized)
+layout (location = 1) in vec3 aNormal;
+// Colors
+layout (location = 2) in vec3 aColor;
+// Texture Coordinates
+layout (location = 3) in vec2 aTex;
+
+// Raw instance data (see InstanceFormat.h), fetched with gl_InstanceID instead of through attributes
+layout (std430, binding = 3) readonly buffer Instances
+{
+	uint instanceWords[];
+};
+
+
+// Outputs the current position for the Fragment Shader
+out vec3 crntPos;
+// Outputs the normal for the Fragment Shader
+out vec3 Normal;
+// Outputs the color for the Fragment Shader
+out vec3 color;
+// Outputs the texture coordinates to the Fragment Shader
+out vec2 texCoord;
+
+
+
+// Imports the camera matrix
+uniform mat4 camMatrix;
+// 0 for matrices, 1 for the 32 byte format, 2 for the 16 byte format
+uniform int instanceFormat;
+// Box the positions of the 16 byte format are relative to
+uniform vec3 boundsMin;
+uniform vec3 boundsMax;
+
+
+// Rotates a vector by a unit quaternion
+vec3 rotate(vec4 q, vec3 v)
+{
+	return v + 2.0f * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+vec3 transformInstance(uint instance, vec3 v)
+{
+	if (instanceFormat == 0)
+	{
+		uint base = instance * 16;
+		mat4 matrix;
+		for (uint i = 0; i < 16; i++)
+			matrix[i / 4][i % 4] = uintBitsToFloat(instanceWords[base + i]);
+		return vec3(matrix * vec4(v, 1.0f));
+	}
+	else if (instanceFormat == 1)
+	{
+		uint base = instance * 8;
+		vec3 position = uintBitsToFloat(uvec3(instanceWords[base], instanceWords[base + 1], instanceWords[base + 2]));
+		vec3 scale = vec3(unpackHalf2x16(instanceWords[base + 3]), unpackHalf2x16(instanceWords[base + 4]).x);
+		vec4 rotation = vec4(unpackSnorm2x16(instanceWords[base + 5]), unpackSnorm2x16(instanceWords[base + 6]));
+		return position + rotate(normalize(rotation), scale * v);
+	}
+	else
+	{
+		uint base = instance * 4;
+		vec3 position = mix(boundsMin, boundsMax, vec3(unpackUnorm2x16(instanceWords[base]), unpackUnorm2x16(instanceWords[base + 1]).x));
+		float scale = unpackHalf2x16(instanceWords[base + 1] >> 16).x;
+		vec4 rotation = vec4(unpackSnorm2x16(instanceWords[base + 2]), unpackSnorm2x16(instanceWords[base + 3]));
+		return position + rotate(normalize(rotation), scale * v);
+	}
+}
+
+void main()
+{
+	// calculates current position
+	crntPos = transformInstance(gl_InstanceID, aPos);
+	// Assigns the normal from the Vertex Data to "Normal"
+	Normal = aNormal;
+	// Assigns the colors from the Vertex Data to "color"
+	color = aColor;
+	// Assigns the texture coordinates from the Vertex Data to "texCoord"
+	texCoord = mat2(0.0, -1.0, 1.0, 0.0) * aTex;
+	
+	// Outputs the positions/coordinates of all vertices
+	gl_Position = camMatrix * vec4(crntPos, 1.0);
+}
\ No newline at end of file
@@ -62,6 +62,29 @@ Shader::Shader(const char* vertexFile, const char* fragmentFile)
 
 }
 
+// Constructor that build a Shader Program with a single compute shader
+Shader::Shader(const char* computeFile)
+{
+	// Read computeFile and store the string
+	std::string computeCode = get_file_contents(computeFile);
+	const char* computeSource = computeCode.c_str();
+
+	// Create Compute Shader Object, attach the source and compile it
+	GLuint computeShader = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(computeShader, 1, &computeSource, NULL);
+	glCompileShader(computeShader);
+	compileErrors(computeShader, "COMPUTE");
+
+	// Create Shader Program Object and link the compute shader into it
+	ID = glCreateProgram();
+	glAttachShader(ID, computeShader);
+	glLinkProgram(ID);
+	compileErrors(ID, "PROGRAM");
+
+	// Delete the now useless Compute Shader object
+	glDeleteShader(computeShader);
+}
+
 // Activates the Shader Program
 void Shader::Activate()
 {
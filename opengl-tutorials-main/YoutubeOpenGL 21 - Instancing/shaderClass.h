@@ -17,6 +17,8 @@ public:
 	GLuint ID;
 	// Constructor that build the Shader Program from 2 different shaders
 	Shader(const char* vertexFile, const char* fragmentFile);
+	// Constructor that build a Shader Program with a single compute shader
+	Shader(const char* computeFile);
 
 	// Activates the Shader Program
 	void Activate();
@@ -0,0 +1,230 @@
+#include"Animation.h"
+
+#include<algorithm>
+#include<cmath>
+
+// Four values at a time whenever the compiler is allowed to use SSE
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<xmmintrin.h>
+#define ANIMATION_SSE 1
+#else
+#define ANIMATION_SSE 0
+#endif
+
+// Copies the transformations of every node of a hierarchy, so nodes that aren't animated keep them
+void Pose::Read(TransformHierarchy& hierarchy)
+{
+	unsigned int count = hierarchy.Size();
+	// Rounded up to a multiple of 4 so blending never has to care about the last few nodes
+	unsigned int padded = (count + 3) & ~3u;
+	std::vector<float>* arrays[] = { &translationX, &translationY, &translationZ, &rotationX, &rotationY, &rotationZ, &rotationW, &scaleX, &scaleY, &scaleZ };
+	for (std::vector<float>* array : arrays)
+		array->assign(padded, 0.0f);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		glm::vec3 translation = hierarchy.Translation(i);
+		glm::quat rotation = hierarchy.Rotation(i);
+		glm::vec3 scale = hierarchy.Scale(i);
+		translationX[i] = translation.x;
+		translationY[i] = translation.y;
+		translationZ[i] = translation.z;
+		rotationX[i] = rotation.x;
+		rotationY[i] = rotation.y;
+		rotationZ[i] = rotation.z;
+		rotationW[i] = rotation.w;
+		scaleX[i] = scale.x;
+		scaleY[i] = scale.y;
+		scaleZ[i] = scale.z;
+	}
+}
+
+// Moves some of the nodes of a hierarchy to the pose
+void Pose::Write(TransformHierarchy& hierarchy, const std::vector<unsigned int>& nodes)
+{
+	for (unsigned int node : nodes)
+	{
+		hierarchy.Set
+		(
+			node,
+			glm::vec3(translationX[node], translationY[node], translationZ[node]),
+			glm::quat(rotationW[node], rotationX[node], rotationY[node], rotationZ[node]),
+			glm::vec3(scaleX[node], scaleY[node], scaleZ[node])
+		);
+	}
+}
+
+unsigned int Pose::Size()
+{
+	return (unsigned int)translationX.size();
+}
+
+// Interpolates four values from a towards b, the lanes marked as rotations take the shorter way around
+// and get normalized again (nlerp), aw and bw are only read for rotations
+static void interpolate
+(
+	float* ax, float* ay, float* az, float* aw,
+	const float* bx, const float* by, const float* bz, const float* bw,
+	const float* factors, float weight, unsigned int first, const float* rotationLanes
+)
+{
+#if ANIMATION_SSE
+	__m128 zero = _mm_setzero_ps();
+	__m128 t = factors != NULL ? _mm_loadu_ps(factors + first) : _mm_set1_ps(weight);
+	__m128 x = _mm_loadu_ps(ax + first), y = _mm_loadu_ps(ay + first), z = _mm_loadu_ps(az + first);
+	__m128 tx = _mm_loadu_ps(bx + first), ty = _mm_loadu_ps(by + first), tz = _mm_loadu_ps(bz + first);
+	if (rotationLanes == NULL)
+	{
+		_mm_storeu_ps(ax + first, _mm_add_ps(x, _mm_mul_ps(_mm_sub_ps(tx, x), t)));
+		_mm_storeu_ps(ay + first, _mm_add_ps(y, _mm_mul_ps(_mm_sub_ps(ty, y), t)));
+		_mm_storeu_ps(az + first, _mm_add_ps(z, _mm_mul_ps(_mm_sub_ps(tz, z), t)));
+		return;
+	}
+	__m128 rotation = _mm_cmpneq_ps(_mm_loadu_ps(rotationLanes), zero);
+	__m128 w = _mm_and_ps(_mm_loadu_ps(aw + first), rotation);
+	__m128 tw = _mm_and_ps(_mm_loadu_ps(bw + first), rotation);
+	// q and -q are the same rotation, flip the target where the two are more than half a turn apart
+	__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, tx), _mm_mul_ps(y, ty)), _mm_add_ps(_mm_mul_ps(z, tz), _mm_mul_ps(w, tw)));
+	__m128 sign = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(dot, zero), rotation), _mm_set1_ps(-0.0f));
+	x = _mm_add_ps(x, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(tx, sign), x), t));
+	y = _mm_add_ps(y, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(ty, sign), y), t));
+	z = _mm_add_ps(z, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(tz, sign), z), t));
+	w = _mm_add_ps(w, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(tw, sign), w), t));
+	__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w))));
+	// Lanes that aren't rotations keep a scale of 1, and padding lanes that are all zero don't turn into NaNs
+	__m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(length, _mm_set1_ps(1e-20f)));
+	scale = _mm_or_ps(_mm_and_ps(rotation, scale), _mm_andnot_ps(rotation, _mm_set1_ps(1.0f)));
+	_mm_storeu_ps(ax + first, _mm_mul_ps(x, scale));
+	_mm_storeu_ps(ay + first, _mm_mul_ps(y, scale));
+	_mm_storeu_ps(az + first, _mm_mul_ps(z, scale));
+	_mm_storeu_ps(aw + first, _mm_or_ps(_mm_and_ps(rotation, _mm_mul_ps(w, scale)), _mm_andnot_ps(rotation, _mm_loadu_ps(aw + first))));
+#else
+	for (unsigned int i = first; i < first + 4; i++)
+	{
+		float t = factors != NULL ? factors[i] : weight;
+		bool rotation = rotationLanes != NULL && rotationLanes[i - first] != 0.0f;
+		float sign = 1.0f;
+		if (rotation && ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i] + aw[i] * bw[i] < 0.0f)
+			sign = -1.0f;
+		ax[i] += (bx[i] * sign - ax[i]) * t;
+		ay[i] += (by[i] * sign - ay[i]) * t;
+		az[i] += (bz[i] * sign - az[i]) * t;
+		if (rotation)
+		{
+			aw[i] += (bw[i] * sign - aw[i]) * t;
+			float scale = 1.0f / std::max(std::sqrt(ax[i] * ax[i] + ay[i] * ay[i] + az[i] * az[i] + aw[i] * aw[i]), 1e-20f);
+			ax[i] *= scale;
+			ay[i] *= scale;
+			az[i] *= scale;
+			aw[i] *= scale;
+		}
+	}
+#endif
+}
+
+// Moves this pose towards another one, weight 0 keeps this pose and 1 gives the other one
+void Pose::Blend(const Pose& other, float weight)
+{
+	static const float rotationLanes[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (unsigned int first = 0; first < translationX.size(); first += 4)
+	{
+		interpolate(&translationX[0], &translationY[0], &translationZ[0], NULL, &other.translationX[0], &other.translationY[0], &other.translationZ[0], NULL, NULL, weight, first, NULL);
+		interpolate(&rotationX[0], &rotationY[0], &rotationZ[0], &rotationW[0], &other.rotationX[0], &other.rotationY[0], &other.rotationZ[0], &other.rotationW[0], NULL, weight, first, rotationLanes);
+		interpolate(&scaleX[0], &scaleY[0], &scaleZ[0], NULL, &other.scaleX[0], &other.scaleY[0], &other.scaleZ[0], NULL, NULL, weight, first, NULL);
+	}
+}
+
+// Samples every channel at a time (wrapped around the duration) into a pose
+void AnimationClip::Sample(float time, Pose& pose, Sampler& sampler) const
+{
+	unsigned int count = (unsigned int)channels.size();
+	unsigned int padded = (count + 3) & ~3u;
+	if (sampler.cursors.size() != count)
+	{
+		sampler.cursors.assign(count, 0);
+		std::vector<float>* arrays[] = { &sampler.fromX, &sampler.fromY, &sampler.fromZ, &sampler.fromW, &sampler.toX, &sampler.toY, &sampler.toZ, &sampler.toW, &sampler.factors, &sampler.rotations };
+		for (std::vector<float>* array : arrays)
+			array->assign(padded, 0.0f);
+	}
+	if (duration > 0.0f)
+	{
+		time = std::fmod(time, duration);
+		if (time < 0.0f)
+			time += duration;
+	}
+
+	// Finding the keys depends on the channel, so that part goes one channel at a time
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const Channel& channel = channels[i];
+		unsigned int keys = (unsigned int)channel.times.size();
+		unsigned int& cursor = sampler.cursors[i];
+		if (cursor >= keys || channel.times[cursor] > time)
+			cursor = 0;
+		while (cursor + 1 < keys && channel.times[cursor + 1] <= time)
+			cursor++;
+		unsigned int next = std::min(cursor + 1, keys - 1);
+		float span = channel.times[next] - channel.times[cursor];
+		float factor = span > 0.0f ? (time - channel.times[cursor]) / span : 0.0f;
+		const glm::vec4& from = channel.values[cursor];
+		const glm::vec4& to = channel.values[next];
+		sampler.fromX[i] = from.x;
+		sampler.fromY[i] = from.y;
+		sampler.fromZ[i] = from.z;
+		sampler.fromW[i] = from.w;
+		sampler.toX[i] = to.x;
+		sampler.toY[i] = to.y;
+		sampler.toZ[i] = to.z;
+		sampler.toW[i] = to.w;
+		sampler.factors[i] = channel.step ? 0.0f : glm::clamp(factor, 0.0f, 1.0f);
+		sampler.rotations[i] = channel.path == ROTATION ? 1.0f : 0.0f;
+	}
+
+	// Interpolating is the same for every channel, so it goes four channels at a time
+	for (unsigned int first = 0; first < padded; first += 4)
+		interpolate(&sampler.fromX[0], &sampler.fromY[0], &sampler.fromZ[0], &sampler.fromW[0], &sampler.toX[0], &sampler.toY[0], &sampler.toZ[0], &sampler.toW[0], &sampler.factors[0], 0.0f, first, &sampler.rotations[first]);
+
+	// Hand the values to the nodes
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int node = channels[i].node;
+		switch (channels[i].path)
+		{
+		case TRANSLATION:
+			pose.translationX[node] = sampler.fromX[i];
+			pose.translationY[node] = sampler.fromY[i];
+			pose.translationZ[node] = sampler.fromZ[i];
+			break;
+		case ROTATION:
+			pose.rotationX[node] = sampler.fromX[i];
+			pose.rotationY[node] = sampler.fromY[i];
+			pose.rotationZ[node] = sampler.fromZ[i];
+			pose.rotationW[node] = sampler.fromW[i];
+			break;
+		case SCALE:
+			pose.scaleX[node] = sampler.fromX[i];
+			pose.scaleY[node] = sampler.fromY[i];
+			pose.scaleZ[node] = sampler.fromZ[i];
+			break;
+		}
+	}
+}
+
+// Every node that at least one channel moves
+std::vector<unsigned int> AnimationClip::Nodes() const
+{
+	std::vector<unsigned int> nodes;
+	for (unsigned int i = 0; i < channels.size(); i++)
+		nodes.push_back(channels[i].node);
+	std::sort(nodes.begin(), nodes.end());
+	nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+	return nodes;
+}
+
+// Matrix of every joint that moves a vertex from where it was bound to where the joint is now
+void Skin::Palette(TransformHierarchy& hierarchy, std::vector<glm::mat4>& palette) const
+{
+	unsigned int count = std::min((unsigned int)joints.size(), maxJoints);
+	palette.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+		palette[i] = hierarchy.World(joints[i]) * inverseBindMatrices[i];
+}
\ No newline at end of file
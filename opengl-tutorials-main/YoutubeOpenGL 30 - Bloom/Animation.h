@@ -0,0 +1,77 @@
+#ifndef ANIMATION_CLASS_H
+#define ANIMATION_CLASS_H
+
+#include<string>
+
+#include"TransformHierarchy.h"
+
+// Translation, rotation and scale of every node of a hierarchy, stored as a structure of arrays so that sampling and
+// blending handle four values with one instruction
+class Pose
+{
+public:
+	std::vector<float> translationX, translationY, translationZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+
+	// Copies the transformations of every node of a hierarchy, so nodes that aren't animated keep them
+	void Read(TransformHierarchy& hierarchy);
+	// Moves some of the nodes of a hierarchy to the pose
+	void Write(TransformHierarchy& hierarchy, const std::vector<unsigned int>& nodes);
+	// Moves this pose towards another one, weight 0 keeps this pose and 1 gives the other one
+	void Blend(const Pose& other, float weight);
+	unsigned int Size();
+};
+
+// Keyframes of a glTF animation, every channel moves one part of the transformation of one node
+class AnimationClip
+{
+public:
+	enum Path { TRANSLATION, ROTATION, SCALE };
+	struct Channel
+	{
+		unsigned int node;
+		Path path;
+		// Step channels jump from key to key instead of interpolating
+		bool step;
+		std::vector<float> times;
+		// Rotations use all four components (x, y, z, w), translations and scales the first three
+		std::vector<glm::vec4> values;
+	};
+	// Memory a sampler reuses between calls, one per thread (or per character) that samples
+	struct Sampler
+	{
+		// Key every channel was at the last time, searching starts there since time mostly moves forward a little
+		std::vector<unsigned int> cursors;
+		// Both keys and how far between them every channel is, as a structure of arrays
+		std::vector<float> fromX, fromY, fromZ, fromW;
+		std::vector<float> toX, toY, toZ, toW;
+		std::vector<float> factors;
+		// 1 for the channels that are rotations, they get interpolated along the shorter way and normalized
+		std::vector<float> rotations;
+	};
+
+	std::string name;
+	float duration = 0.0f;
+	std::vector<Channel> channels;
+
+	// Samples every channel at a time (wrapped around the duration) into a pose
+	void Sample(float time, Pose& pose, Sampler& sampler) const;
+	// Every node that at least one channel moves
+	std::vector<unsigned int> Nodes() const;
+};
+
+// Joints a skinned mesh is bound to and the matrices that bring its vertices into the space of each joint
+class Skin
+{
+public:
+	// Most joints a skin can have, the palette has to fit into the uniform block of the skinning shader
+	static constexpr unsigned int maxJoints = 128;
+
+	std::vector<unsigned int> joints;
+	std::vector<glm::mat4> inverseBindMatrices;
+
+	// Matrix of every joint that moves a vertex from where it was bound to where the joint is now
+	void Palette(TransformHierarchy& hierarchy, std::vector<glm::mat4>& palette) const;
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include"Animator.h"
+
+#include<chrono>
+
+// Adds a character that plays the animations of a model and returns its index
+unsigned int Animator::Add(Model& model, glm::mat4 matrix)
+{
+	unsigned int index = Add(model.Transforms(), model.Animations(), model.Skins(), matrix);
+	characters[index].model = &model;
+	return index;
+}
+
+// Adds a character made of nodes, clips and skins that don't belong to a model
+unsigned int Animator::Add(const TransformHierarchy& transforms, const std::vector<AnimationClip>& clips, const std::vector<Skin>& skins, glm::mat4 matrix)
+{
+	characters.emplace_back();
+	Character& character = characters.back();
+	character.clips = &clips;
+	character.skins = &skins;
+	character.matrix = matrix;
+	character.transforms = transforms;
+	// Nodes that no clip touches keep the transformation they had in the file
+	character.pose.Read(character.transforms);
+	character.blendPose = character.pose;
+	for (unsigned int i = 0; i < clips.size(); i++)
+	{
+		std::vector<unsigned int> nodes = clips[i].Nodes();
+		character.nodes.insert(character.nodes.end(), nodes.begin(), nodes.end());
+	}
+	std::sort(character.nodes.begin(), character.nodes.end());
+	character.nodes.erase(std::unique(character.nodes.begin(), character.nodes.end()), character.nodes.end());
+	character.palettes.resize(skins.size());
+	character.jointBuffers.assign(skins.size(), 0);
+	return (unsigned int)characters.size() - 1;
+}
+
+// Moves every character forward in time and builds its joint palettes
+void Animator::Update(float deltaTime)
+{
+	if (!pool || pool->Threads() != std::max(threads, 1u))
+		pool = std::make_unique<WorkerPool>(std::max(threads, 1u));
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	stats.characters = (unsigned int)characters.size();
+
+	// Characters don't share anything they write to, so every thread just takes a block of them
+	unsigned int count = (unsigned int)characters.size();
+	unsigned int blocks = std::max(1u, std::min(threads, count));
+	unsigned int size = (count + blocks - 1) / std::max(blocks, 1u);
+	pool->Run(blocks, [this, count, size, deltaTime](unsigned int block)
+	{
+		animate(std::min(count, block * size), std::min(count, (block + 1) * size), deltaTime);
+	});
+
+	stats.joints = 0;
+	for (unsigned int i = 0; i < count; i++)
+		for (unsigned int j = 0; j < characters[i].palettes.size(); j++)
+			stats.joints += (unsigned int)characters[i].palettes[j].size();
+	stats.updateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Samples, blends and builds the palettes of the characters from first up to (but not including) last
+void Animator::animate(unsigned int first, unsigned int last, float deltaTime)
+{
+	for (unsigned int i = first; i < last; i++)
+	{
+		Character& character = characters[i];
+		const std::vector<AnimationClip>& clips = *character.clips;
+		if (character.clip < clips.size())
+		{
+			character.time += deltaTime * character.speed;
+			clips[character.clip].Sample(character.time, character.pose, character.sampler);
+			if (character.blendWeight > 0.0f && character.blendClip < clips.size())
+			{
+				character.blendTime += deltaTime * character.speed;
+				clips[character.blendClip].Sample(character.blendTime, character.blendPose, character.blendSampler);
+				character.pose.Blend(character.blendPose, character.blendWeight);
+			}
+			character.pose.Write(character.transforms, character.nodes);
+		}
+		character.transforms.Update();
+		for (unsigned int j = 0; j < character.skins->size(); j++)
+			(*character.skins)[j].Palette(character.transforms, character.palettes[j]);
+	}
+}
+
+// Copies the joint palettes into their uniform buffers
+void Animator::Upload()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < characters.size(); i++)
+	{
+		Character& character = characters[i];
+		for (unsigned int j = 0; j < character.palettes.size(); j++)
+		{
+			// The shader always declares the largest palette, so every buffer has room for it
+			if (character.jointBuffers[j] == 0)
+			{
+				glGenBuffers(1, &character.jointBuffers[j]);
+				StateCache::BindBuffer(GL_UNIFORM_BUFFER, character.jointBuffers[j]);
+				glBufferData(GL_UNIFORM_BUFFER, Skin::maxJoints * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+			}
+			StateCache::BindBuffer(GL_UNIFORM_BUFFER, character.jointBuffers[j]);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, character.palettes[j].size() * sizeof(glm::mat4), character.palettes[j].data());
+		}
+	}
+	stats.uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Draws every character that has a model, skinned meshes with the skinning shader (see skinned.vert)
+void Animator::Draw(Shader& shader, Shader& skinnedShader, Camera& camera)
+{
+	// The ID uniform is looked up once per call instead of once per character
+	Shader* programs[] = { &shader, &skinnedShader };
+	GLint objectIDLocations[] = { glGetUniformLocation(shader.ID, "objectID"), glGetUniformLocation(skinnedShader.ID, "objectID") };
+	for (unsigned int i = 0; i < characters.size(); i++)
+	{
+		Character& character = characters[i];
+		if (character.model == NULL)
+			continue;
+		for (unsigned int j = 0; j < 2; j++)
+		{
+			programs[j]->Activate();
+			glUniform1ui(objectIDLocations[j], character.objectID);
+		}
+		character.model->DrawAnimated(shader, skinnedShader, camera, character.transforms, character.jointBuffers, character.matrix);
+	}
+}
+
+Animator::Stats Animator::GetStats()
+{
+	return stats;
+}
+
+// Deletes the uniform buffers
+void Animator::Delete()
+{
+	for (unsigned int i = 0; i < characters.size(); i++)
+	{
+		for (unsigned int j = 0; j < characters[i].jointBuffers.size(); j++)
+		{
+			if (characters[i].jointBuffers[j] == 0)
+				continue;
+			StateCache::ForgetBuffer(characters[i].jointBuffers[j]);
+			glDeleteBuffers(1, &characters[i].jointBuffers[j]);
+			characters[i].jointBuffers[j] = 0;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef ANIMATOR_CLASS_H
+#define ANIMATOR_CLASS_H
+
+#include<memory>
+#include"Model.h"
+#include"WorkerPool.h"
+
+// Plays the animations of many characters at once. Sampling, blending, updating the transforms and building the
+// joint palettes happen on several threads, one block of characters each, uploading and drawing happen afterwards
+// on the thread that owns the OpenGL context.
+class Animator
+{
+public:
+	// A copy of a model's nodes that plays its own animations, the model's meshes are shared
+	struct Character
+	{
+		// Model that gets drawn (NULL for characters that are only animated, like in benchmarks)
+		Model* model = NULL;
+		const std::vector<AnimationClip>* clips = NULL;
+		const std::vector<Skin>* skins = NULL;
+		glm::mat4 matrix = glm::mat4(1.0f);
+		// What the character writes into the ID buffer (0 can't be picked)
+		unsigned int objectID = 0;
+
+		// Clip that is playing and how far along it is
+		unsigned int clip = 0;
+		float time = 0.0f;
+		float speed = 1.0f;
+		// Second clip that gets blended over the first one, a weight of 0 turns it off
+		unsigned int blendClip = 0;
+		float blendTime = 0.0f;
+		float blendWeight = 0.0f;
+
+		TransformHierarchy transforms;
+		Pose pose;
+		Pose blendPose;
+		AnimationClip::Sampler sampler;
+		AnimationClip::Sampler blendSampler;
+		// Nodes any of the clips moves, only those get written back to the transforms
+		std::vector<unsigned int> nodes;
+		// Joint matrices of every skin and the uniform buffers they get uploaded to
+		std::vector<std::vector<glm::mat4>> palettes;
+		std::vector<GLuint> jointBuffers;
+	};
+	// What the last update cost
+	struct Stats
+	{
+		unsigned int characters = 0;
+		unsigned int joints = 0;
+		double updateMs = 0.0;
+		double uploadMs = 0.0;
+	};
+
+	// Threads the characters get split between
+	unsigned int threads = 4;
+	std::vector<Character> characters;
+
+	// Adds a character that plays the animations of a model and returns its index
+	unsigned int Add(Model& model, glm::mat4 matrix = glm::mat4(1.0f));
+	// Adds a character made of nodes, clips and skins that don't belong to a model (it can't be drawn, the clips and skins have to outlive it)
+	unsigned int Add(const TransformHierarchy& transforms, const std::vector<AnimationClip>& clips, const std::vector<Skin>& skins, glm::mat4 matrix = glm::mat4(1.0f));
+
+	// Moves every character forward in time and builds its joint palettes
+	void Update(float deltaTime);
+	// Copies the joint palettes into their uniform buffers
+	void Upload();
+	// Draws every character that has a model, skinned meshes with the skinning shader (see skinned.vert)
+	void Draw(Shader& shader, Shader& skinnedShader, Camera& camera);
+	Stats GetStats();
+	// Deletes the uniform buffers
+	void Delete();
+
+private:
+	Stats stats;
+	// Workers the blocks of characters run on, started on the first update and again whenever threads changes
+	std::unique_ptr<WorkerPool> pool;
+
+	// Samples, blends and builds the palettes of the characters from first up to (but not including) last
+	void animate(unsigned int first, unsigned int last, float deltaTime);
+};
+#endif
\ No newline at end of file
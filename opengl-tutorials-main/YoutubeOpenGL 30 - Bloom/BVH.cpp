@@ -0,0 +1,421 @@
+#include"BVH.h"
+
+#include<chrono>
+#include<algorithm>
+
+// Half of the surface area of a box, which is all the SAH needs to compare boxes
+static float half_area(const AABB& box)
+{
+	if (box.Empty())
+		return 0.0f;
+	glm::vec3 size = box.max - box.min;
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+// Grows a box so that it contains another box
+static void grow(AABB& box, const AABB& other)
+{
+	box.min = glm::min(box.min, other.min);
+	box.max = glm::max(box.max, other.max);
+}
+
+// Where a box with the given center and extents is compared to the frustum: outside (-1), partly inside (0) or inside (1)
+static int classify_frustum(const Frustum& frustum, glm::vec3 center, glm::vec3 extents)
+{
+	int result = 1;
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		glm::vec3 normal = glm::vec3(frustum.planes[i]);
+		float distance = glm::dot(normal, center) + frustum.planes[i].w;
+		float radius = glm::dot(glm::abs(normal), extents);
+		if (distance + radius < 0.0f)
+			return -1;
+		if (distance - radius < 0.0f)
+			result = 0;
+	}
+	return result;
+}
+
+// Adds an object with a world space box and returns its handle (it only becomes part of the tree with the next Build)
+unsigned int BVH::Insert(const AABB& box)
+{
+	unsigned int object;
+	if (!freeObjects.empty())
+	{
+		object = freeObjects.back();
+		freeObjects.pop_back();
+		boxes[object] = box;
+		leaves[object] = none;
+	}
+	else
+	{
+		object = (unsigned int)boxes.size();
+		boxes.push_back(box);
+		leaves.push_back(none);
+	}
+	stats.objects++;
+	return object;
+}
+
+// Moves an object, the nodes above it get fixed by the next Refit
+void BVH::Update(unsigned int object, const AABB& box)
+{
+	boxes[object] = box;
+	if (leaves[object] != none)
+		dirty.push_back(leaves[object]);
+}
+
+// Takes an object out, its handle may be given out again by Insert
+void BVH::Remove(unsigned int object)
+{
+	if (leaves[object] != none)
+		dirty.push_back(leaves[object]);
+	boxes[object] = AABB();
+	leaves[object] = none;
+	freeObjects.push_back(object);
+	stats.objects--;
+}
+
+// Box of an object
+const AABB& BVH::Bounds(unsigned int object)
+{
+	return boxes[object];
+}
+
+// Builds the tree from scratch over every object
+void BVH::Build()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	nodes.clear();
+	order.clear();
+	dirty.clear();
+	stats.depth = 0;
+
+	// Removed objects are empty boxes, everything else goes into the tree
+	for (unsigned int i = 0; i < boxes.size(); i++)
+	{
+		leaves[i] = none;
+		if (!boxes[i].Empty())
+			order.push_back(i);
+	}
+	if (!order.empty())
+	{
+		nodes.push_back(Node{ AABB(), 0, (unsigned int)order.size(), none });
+		nodes[0].box = nodeBounds(0);
+
+		// Split with a stack instead of recursion so lopsided trees can't run out of stack
+		std::vector<Task> tasks;
+		tasks.push_back(Task{ 0, 1 });
+		while (!tasks.empty())
+		{
+			Task task = tasks.back();
+			tasks.pop_back();
+			stats.depth = std::max(stats.depth, task.depth);
+			if (nodes[task.node].count > maxLeafSize && split(task.node))
+			{
+				tasks.push_back(Task{ nodes[task.node].first, task.depth + 1 });
+				tasks.push_back(Task{ nodes[task.node].first + 1, task.depth + 1 });
+				continue;
+			}
+			// The node stays a leaf, so its objects have to know where they ended up
+			for (unsigned int i = 0; i < nodes[task.node].count; i++)
+				leaves[order[nodes[task.node].first + i]] = task.node;
+		}
+	}
+
+	stats.nodes = (unsigned int)nodes.size();
+	stats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Splits a node along the best of the binned SAH planes, returns false if keeping it as a leaf is cheaper
+bool BVH::split(unsigned int node)
+{
+	unsigned int first = nodes[node].first;
+	unsigned int count = nodes[node].count;
+
+	// The planes are placed between the centers, so the bins span the box around the centers
+	AABB centers;
+	for (unsigned int i = 0; i < count; i++)
+		centers.Add(boxes[order[first + i]].Center());
+
+	float bestCost = half_area(nodes[node].box) * count;
+	int bestAxis = -1;
+	unsigned int bestSplit = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centers.max[axis] - centers.min[axis];
+		if (extent <= 0.0f)
+			continue;
+		float scale = binCount / extent;
+
+		// Drop every object into the bin its center falls into
+		AABB binBoxes[binCount];
+		unsigned int binCounts[binCount] = {};
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const AABB& box = boxes[order[first + i]];
+			unsigned int bin = std::min(binCount - 1, (unsigned int)((box.Center()[axis] - centers.min[axis]) * scale));
+			grow(binBoxes[bin], box);
+			binCounts[bin]++;
+		}
+
+		// Sweep from both sides so every plane between two bins knows the boxes and counts on either side of it
+		float leftAreas[binCount - 1];
+		unsigned int leftCounts[binCount - 1];
+		AABB left;
+		unsigned int leftCount = 0;
+		for (unsigned int i = 0; i < binCount - 1; i++)
+		{
+			grow(left, binBoxes[i]);
+			leftCount += binCounts[i];
+			leftAreas[i] = half_area(left);
+			leftCounts[i] = leftCount;
+		}
+		AABB right;
+		unsigned int rightCount = 0;
+		for (unsigned int i = binCount - 1; i > 0; i--)
+		{
+			grow(right, binBoxes[i]);
+			rightCount += binCounts[i];
+			float cost = leftAreas[i - 1] * leftCounts[i - 1] + half_area(right) * rightCount;
+			if (leftCounts[i - 1] > 0 && rightCount > 0 && cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+	if (bestAxis == -1)
+		return false;
+
+	// Everything in the bins before the plane goes to the left child
+	float scale = binCount / (centers.max[bestAxis] - centers.min[bestAxis]);
+	float minimum = centers.min[bestAxis];
+	unsigned int* middle = std::partition(&order[first], &order[first] + count, [&](unsigned int object)
+	{
+		unsigned int bin = std::min(binCount - 1, (unsigned int)((boxes[object].Center()[bestAxis] - minimum) * scale));
+		return bin < bestSplit;
+	});
+	unsigned int leftCount = (unsigned int)(middle - &order[first]);
+
+	unsigned int children = (unsigned int)nodes.size();
+	nodes.push_back(Node{ AABB(), first, leftCount, node });
+	nodes.push_back(Node{ AABB(), first + leftCount, count - leftCount, node });
+	nodes[children].box = nodeBounds(children);
+	nodes[children + 1].box = nodeBounds(children + 1);
+	nodes[node].first = children;
+	nodes[node].count = 0;
+	return true;
+}
+
+// Box around the objects of a leaf or the children of an inner node
+AABB BVH::nodeBounds(unsigned int node)
+{
+	AABB box;
+	const Node& current = nodes[node];
+	if (current.count == 0)
+	{
+		grow(box, nodes[current.first].box);
+		grow(box, nodes[current.first + 1].box);
+		return box;
+	}
+	for (unsigned int i = 0; i < current.count; i++)
+	{
+		unsigned int object = order[current.first + i];
+		// Objects that were removed or whose handle got reused don't belong to the leaf anymore
+		if (leaves[object] == node || leaves[object] == none)
+			grow(box, boxes[object]);
+	}
+	return box;
+}
+
+// Fixes the boxes of the nodes above the objects that moved since the last Build or Refit
+void BVH::Refit()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < dirty.size(); i++)
+	{
+		// Walk up until a node's box doesn't change anymore, everything above it is still right
+		unsigned int node = dirty[i];
+		while (node != none)
+		{
+			AABB box = nodeBounds(node);
+			if (box.min == nodes[node].box.min && box.max == nodes[node].box.max)
+				break;
+			nodes[node].box = box;
+			node = nodes[node].parent;
+		}
+	}
+	dirty.clear();
+	stats.refitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Adds every object below a node, used once a node is known to be completely inside
+void BVH::collect(unsigned int node, std::vector<unsigned int>& objects)
+{
+	size_t bottom = stack.size();
+	stack.push_back(node);
+	while (stack.size() > bottom)
+	{
+		const Node& current = nodes[stack.back()];
+		unsigned int index = stack.back();
+		stack.pop_back();
+		stats.visited++;
+		if (current.count == 0)
+		{
+			stack.push_back(current.first);
+			stack.push_back(current.first + 1);
+			continue;
+		}
+		for (unsigned int i = 0; i < current.count; i++)
+		{
+			unsigned int object = order[current.first + i];
+			if (leaves[object] == index)
+				objects.push_back(object);
+		}
+	}
+}
+
+// Goes down the tree with a test that tells if a box is outside (-1), partly inside (0) or completely inside (1)
+template<typename Classify>
+void BVH::query(Classify classify, std::vector<unsigned int>& objects)
+{
+	stats.visited = 0;
+	if (nodes.empty())
+		return;
+	stack.clear();
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		unsigned int index = stack.back();
+		stack.pop_back();
+		stats.visited++;
+		const Node& current = nodes[index];
+		int result = classify(current.box);
+		if (result < 0)
+			continue;
+		// Nothing below a node that is completely inside needs to be tested anymore
+		if (result > 0)
+		{
+			collect(index, objects);
+			continue;
+		}
+		if (current.count == 0)
+		{
+			stack.push_back(current.first);
+			stack.push_back(current.first + 1);
+			continue;
+		}
+		for (unsigned int i = 0; i < current.count; i++)
+		{
+			unsigned int object = order[current.first + i];
+			if (leaves[object] == index && classify(boxes[object]) >= 0)
+				objects.push_back(object);
+		}
+	}
+}
+
+// Objects whose boxes are at least partly inside of a frustum
+void BVH::Query(const Frustum& frustum, std::vector<unsigned int>& objects)
+{
+	query([&](const AABB& box)
+	{
+		return classify_frustum(frustum, box.Center(), box.Extents());
+	}, objects);
+}
+
+// Objects whose boxes overlap a box
+void BVH::Query(const AABB& area, std::vector<unsigned int>& objects)
+{
+	query([&](const AABB& box)
+	{
+		if (glm::any(glm::lessThan(box.max, area.min)) || glm::any(glm::greaterThan(box.min, area.max)))
+			return -1;
+		if (glm::all(glm::greaterThanEqual(box.min, area.min)) && glm::all(glm::lessThanEqual(box.max, area.max)))
+			return 1;
+		return 0;
+	}, objects);
+}
+
+// Objects that can cast a shadow into a frustum, which are the ones whose boxes touch it once they are swept
+// along the direction the light travels in for the given distance
+void BVH::QueryShadowCasters(const Frustum& frustum, glm::vec3 lightDirection, float distance, std::vector<unsigned int>& objects)
+{
+	glm::vec3 sweep = glm::normalize(lightDirection) * distance;
+	query([&](const AABB& box)
+	{
+		// The swept box covers the box at both ends of the sweep and everything in between
+		AABB swept = box;
+		swept.min = glm::min(box.min, box.min + sweep);
+		swept.max = glm::max(box.max, box.max + sweep);
+		return classify_frustum(frustum, swept.Center(), swept.Extents());
+	}, objects);
+}
+
+// Closest object whose box a ray hits and how far along the ray it is, returns false when the ray hits nothing
+bool BVH::Raycast(glm::vec3 origin, glm::vec3 direction, unsigned int& object, float& distance)
+{
+	stats.visited = 0;
+	object = none;
+	distance = FLT_MAX;
+	if (nodes.empty())
+		return false;
+
+	// Slab test, returns where the ray enters the box or FLT_MAX if it misses it or the box is further than the closest hit
+	glm::vec3 inverse = 1.0f / direction;
+	auto enter = [&](const AABB& box)
+	{
+		glm::vec3 t0 = (box.min - origin) * inverse;
+		glm::vec3 t1 = (box.max - origin) * inverse;
+		glm::vec3 near = glm::min(t0, t1);
+		glm::vec3 far = glm::max(t0, t1);
+		float tNear = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+		float tFar = std::min(std::min(far.x, far.y), far.z);
+		return tNear <= tFar && tNear < distance ? tNear : FLT_MAX;
+	};
+
+	stack.clear();
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		unsigned int index = stack.back();
+		stack.pop_back();
+		stats.visited++;
+		const Node& current = nodes[index];
+		// The closest hit may have gotten closer since the node was pushed
+		if (enter(current.box) == FLT_MAX)
+			continue;
+		if (current.count == 0)
+		{
+			// Visit the closer child first so the hit it finds lets the other one get skipped
+			float left = enter(nodes[current.first].box);
+			float right = enter(nodes[current.first + 1].box);
+			unsigned int closer = left <= right ? current.first : current.first + 1;
+			unsigned int further = left <= right ? current.first + 1 : current.first;
+			if (std::max(left, right) != FLT_MAX)
+				stack.push_back(further);
+			if (std::min(left, right) != FLT_MAX)
+				stack.push_back(closer);
+			continue;
+		}
+		for (unsigned int i = 0; i < current.count; i++)
+		{
+			unsigned int candidate = order[current.first + i];
+			if (leaves[candidate] != index)
+				continue;
+			float t = enter(boxes[candidate]);
+			if (t < distance)
+			{
+				distance = t;
+				object = candidate;
+			}
+		}
+	}
+	return object != none;
+}
+
+BVH::Stats BVH::GetStats()
+{
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#ifndef BVH_CLASS_H
+#define BVH_CLASS_H
+
+#include<vector>
+
+#include"Frustum.h"
+
+// Bounding volume hierarchy over world space boxes, built with a binned surface area heuristic and refitted when
+// objects move, so visibility and picking queries only have to look at the parts of the scene that can match.
+// The objects are just handles, whoever inserts them keeps track of what they stand for.
+class BVH
+{
+public:
+	// What the tree looks like and what the last build, refit and query cost
+	struct Stats
+	{
+		unsigned int objects = 0;
+		unsigned int nodes = 0;
+		unsigned int depth = 0;
+		double buildMs = 0.0;
+		double refitMs = 0.0;
+		// Nodes the last query had to look at
+		unsigned int visited = 0;
+	};
+
+	// Most objects a leaf holds before the build tries to split it
+	unsigned int maxLeafSize = 4;
+
+	// Adds an object with a world space box and returns its handle (it only becomes part of the tree with the next Build)
+	unsigned int Insert(const AABB& box);
+	// Moves an object, the nodes above it get fixed by the next Refit
+	void Update(unsigned int object, const AABB& box);
+	// Takes an object out, its handle may be given out again by Insert
+	void Remove(unsigned int object);
+	// Box of an object
+	const AABB& Bounds(unsigned int object);
+
+	// Builds the tree from scratch over every object
+	void Build();
+	// Fixes the boxes of the nodes above the objects that moved since the last Build or Refit (the shape of the tree stays
+	// the same, so rebuild once objects moved far)
+	void Refit();
+
+	// Objects whose boxes are at least partly inside of a frustum
+	void Query(const Frustum& frustum, std::vector<unsigned int>& objects);
+	// Objects whose boxes overlap a box
+	void Query(const AABB& box, std::vector<unsigned int>& objects);
+	// Objects that can cast a shadow into a frustum, which are the ones whose boxes touch it once they are swept
+	// along the direction the light travels in for the given distance
+	void QueryShadowCasters(const Frustum& frustum, glm::vec3 lightDirection, float distance, std::vector<unsigned int>& objects);
+	// Closest object whose box a ray hits and how far along the ray it is, returns false when the ray hits nothing
+	bool Raycast(glm::vec3 origin, glm::vec3 direction, unsigned int& object, float& distance);
+
+	Stats GetStats();
+
+private:
+	struct Node
+	{
+		AABB box;
+		// Leaves hold count objects starting at first in order, inner nodes have their children at first and first + 1
+		unsigned int first;
+		unsigned int count;
+		unsigned int parent;
+	};
+	// Range of the objects of a node the build still has to split
+	struct Task
+	{
+		unsigned int node;
+		unsigned int depth;
+	};
+	static constexpr unsigned int none = 0xFFFFFFFF;
+	static constexpr unsigned int binCount = 16;
+
+	std::vector<Node> nodes;
+	// Objects in the order the leaves hold them
+	std::vector<unsigned int> order;
+	std::vector<AABB> boxes;
+	// Leaf every object is in, none for objects that were inserted or removed since the last build
+	std::vector<unsigned int> leaves;
+	std::vector<unsigned int> freeObjects;
+	// Leaves whose objects moved since the last Refit
+	std::vector<unsigned int> dirty;
+	// Nodes that still have to be visited by a query, kept around to reuse the memory
+	std::vector<unsigned int> stack;
+	Stats stats;
+
+	// Splits a node along the best of the binned SAH planes, returns false if keeping it as a leaf is cheaper
+	bool split(unsigned int node);
+	// Box around the objects of a leaf or the children of an inner node
+	AABB nodeBounds(unsigned int node);
+	// Adds every object below a node, used once a node is known to be completely inside
+	void collect(unsigned int node, std::vector<unsigned int>& objects);
+	// Goes down the tree with a test that tells if a box is outside (-1), partly inside (0) or completely inside (1)
+	template<typename Classify>
+	void query(Classify classify, std::vector<unsigned int>& objects);
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,751 @@
+#include"Benchmarks.h"
+#include"Animator.h"
+
+#include<functional>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include<windows.h>
+#include<psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include<unistd.h>
+#endif
+
+// Define this to count every heap allocation, the memory report then prints how many each model needed
+#ifdef COUNT_ALLOCATIONS
+#include<new>
+#include<cstdlib>
+size_t allocationCount = 0;
+
+void* operator new(size_t size)
+{
+	allocationCount++;
+	if (void* memory = std::malloc(size == 0 ? 1 : size))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+#endif
+
+// Average milliseconds a frame took, the CPU time stops before waiting for the GPU and the frame time after it
+struct FrameTimes
+{
+	double cpuMs = 0.0;
+	double frameMs = 0.0;
+};
+
+// Calls frame with every frame number and times it, waiting for the GPU after each one so that every frame
+// is measured the same way instead of the driver queueing up a few of them
+static FrameTimes time_frames(unsigned int frames, const std::function<void(unsigned int)>& frame)
+{
+	FrameTimes times;
+	for (unsigned int i = 0; i < frames; i++)
+	{
+		double start = glfwGetTime();
+		frame(i);
+		times.cpuMs += (glfwGetTime() - start) * 1000.0;
+		glFinish();
+		times.frameMs += (glfwGetTime() - start) * 1000.0;
+	}
+	times.cpuMs /= frames;
+	times.frameMs /= frames;
+	return times;
+}
+
+// Remembers where the camera was and puts it back once the benchmark that moves it around returns
+struct SavedCamera
+{
+	Camera& camera;
+	glm::vec3 position;
+	glm::vec3 orientation;
+
+	SavedCamera(Camera& camera) : camera(camera), position(camera.Position), orientation(camera.Orientation) {}
+	~SavedCamera()
+	{
+		camera.Position = position;
+		camera.Orientation = orientation;
+	}
+};
+
+// Looks around from in front of the wall of the occlusion benchmarks so it hides more or less of the planes
+static void look_around(Camera& camera, unsigned int frame, unsigned int frames)
+{
+	float angle = 0.5f * glm::sin(6.2831853f * frame / frames);
+	camera.Position = glm::vec3(0.0f, 0.0f, 2.0f);
+	camera.Orientation = glm::vec3(glm::sin(angle), 0.0f, -glm::cos(angle));
+	camera.updateMatrix(45.0f, 0.1f, 100.0f);
+}
+
+// Physical memory the process is using right now in bytes
+static size_t resident_memory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.WorkingSetSize;
+	return 0;
+#else
+	// The second number of statm is the resident set in pages
+	long pages = 0;
+	long resident = 0;
+	std::ifstream statm("/proc/self/statm");
+	statm >> pages >> resident;
+	return (size_t)resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Loads every model, printing how much the RSS grew and where the model's memory went
+static void report_model_memory(std::string resourceDir, std::vector<std::string> files)
+{
+	std::vector<Model*> models;
+	size_t startRSS = resident_memory();
+	for (unsigned int i = 0; i < files.size(); i++)
+	{
+		size_t before = resident_memory();
+#ifdef COUNT_ALLOCATIONS
+		size_t allocationsBefore = allocationCount;
+#endif
+		Model* model = new Model((resourceDir + files[i]).c_str());
+#ifdef COUNT_ALLOCATIONS
+		std::cout << files[i] << ": " << allocationCount - allocationsBefore << " allocations" << std::endl;
+#endif
+		Model::MemoryReport report = model->Memory();
+		std::cout << files[i] << ": RSS +" << ((double)resident_memory() - before) / (1024.0 * 1024.0) << "MB, CPU "
+			<< (report.cpuGeometry + report.cpuFile + report.cpuJSON) / 1024.0 << "KB kept, " << report.released / 1024.0 << "KB released, GPU "
+			<< report.gpuGeometry / 1024.0 << "KB geometry + " << report.gpuTextures / (1024.0 * 1024.0) << "MB textures" << std::endl;
+		models.push_back(model);
+	}
+	std::cout << "All models: RSS +" << ((double)resident_memory() - startRSS) / (1024.0 * 1024.0) << "MB" << std::endl;
+	// The models only had to be loaded to be measured
+	for (unsigned int i = 0; i < models.size(); i++)
+		delete models[i];
+}
+
+// Submits copies of a mesh to the render queue for a few frames and prints the draw calls and CPU time per frame
+static void benchmark_instancing(RenderQueue& queue, Mesh& mesh, Shader& shader, Camera& camera)
+{
+	const unsigned int counts[] = { 1, 10, 100, 1000, 10000 };
+	const unsigned int frames = 30;
+	bool instancing = queue.instancing;
+
+	std::cout << "Copies | instancing | draw calls | CPU ms/frame (submit + execute)" << std::endl;
+	for (unsigned int count : counts)
+	{
+		// Lay the copies out on a grid in front of the camera
+		std::vector<glm::mat4> matrices;
+		for (unsigned int i = 0; i < count; i++)
+			matrices.push_back(glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 100) * 2.0f - 100.0f, (float)(i / 100) * 2.0f - 100.0f, -50.0f)));
+
+		for (unsigned int mode = 0; mode < 2; mode++)
+		{
+			queue.instancing = mode == 1;
+			FrameTimes times = time_frames(frames, [&](unsigned int)
+			{
+				queue.Begin(camera);
+				for (unsigned int i = 0; i < count; i++)
+					queue.Submit(mesh, shader, matrices[i]);
+				queue.Execute();
+			});
+			std::cout << count << " | " << (queue.instancing ? "on" : "off") << " | " << queue.LastStats().draws << " | " << times.cpuMs << std::endl;
+		}
+	}
+	queue.instancing = instancing;
+}
+
+// Makes a thousand meshes and draws them for a few frames with every combination of DSA and shared VAO the context has
+static void benchmark_dsa(std::vector<Vertex>& vertices, std::vector<GLuint>& indices, Shader& shader, Camera& camera)
+{
+	const unsigned int count = 1000;
+	const unsigned int frames = 30;
+	bool directStateAccess = StateCache::directStateAccess;
+	// Every mesh gets buffers and a VAO of its own so the setup cost is the one of the wrappers and not of the heap
+	BufferHeap* heap = Mesh::heap;
+	VAOCache* vaoCache = Mesh::vaoCache;
+	Mesh::heap = NULL;
+	Mesh::vaoCache = NULL;
+	std::vector<std::shared_ptr<Texture>> noTextures;
+
+	std::cout << "DSA | VAO | setup ms | CPU ms/frame | VAO switches/frame" << std::endl;
+	for (unsigned int dsa = 0; dsa < 2; dsa++)
+	{
+		StateCache::directStateAccess = dsa == 1;
+		if (dsa == 1 && !StateCache::DSA())
+		{
+			std::cout << "DSA needs OpenGL 4.5, skipped" << std::endl;
+			break;
+		}
+
+		// Setup is everything from creating the objects until the driver is done with them
+		glFinish();
+		std::vector<Mesh> meshes;
+		VAOCache cache;
+		double setupMs = time_frames(1, [&](unsigned int)
+		{
+			meshes.reserve(count);
+			for (unsigned int i = 0; i < count; i++)
+				meshes.emplace_back(vertices, indices, noTextures);
+			cache.Get(Mesh::Format());
+		}).frameMs;
+
+		for (unsigned int shared = 0; shared < 2 && (shared == 0 || VAOCache::Supported()); shared++)
+		{
+			Mesh::vaoCache = shared == 1 ? &cache : NULL;
+			// Only counted when STATE_CACHE_STATS is defined
+			unsigned int switches = 0;
+			FrameTimes times = time_frames(frames, [&](unsigned int)
+			{
+				shader.Activate();
+				camera.Matrix(shader, "camMatrix");
+				for (unsigned int i = 0; i < count; i++)
+					meshes[i].DrawGeometry(shader, glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 32) - 16.0f, (float)(i / 32) - 16.0f, -40.0f)));
+				StateCache::EndFrame();
+				switches += StateCache::LastFrame().vertexArrays;
+			});
+			std::cout << (dsa == 1 ? "on" : "off") << " | " << (shared == 1 ? "shared" : "per mesh") << " | " << setupMs << " | "
+				<< times.cpuMs << " | " << switches / frames << std::endl;
+		}
+		Mesh::vaoCache = NULL;
+	}
+	StateCache::directStateAccess = directStateAccess;
+	Mesh::heap = heap;
+	Mesh::vaoCache = vaoCache;
+}
+
+// Flies the camera through a grid of map models and prints how much got culled and how long the frames took
+static void benchmark_culling(RenderQueue& queue, Shader& shader, Camera& camera, std::string resourceDir)
+{
+	const int gridSize = 16;
+	const float spacing = 20.0f;
+	const unsigned int frames = 300;
+	Model map((resourceDir + "YoutubeOpenGL 13 - Model Loading/models/map/scene.gltf").c_str());
+	bool enabled = Frustum::enabled;
+	SavedCamera saved(camera);
+
+	std::cout << "Culling | models | culled % | CPU ms/frame (cull + sort + submit) | frame ms" << std::endl;
+	for (unsigned int mode = 0; mode < 2; mode++)
+	{
+		Frustum::enabled = mode == 1;
+		double culled = 0.0;
+		double cpuMs = 0.0;
+		FrameTimes times = time_frames(frames, [&](unsigned int frame)
+		{
+			// Fly diagonally over the grid while slowly turning around
+			float t = (float)frame / frames;
+			float extent = gridSize * spacing * 0.5f;
+			camera.Position = glm::vec3(-extent + 2.0f * extent * t, 5.0f, -extent + 2.0f * extent * t);
+			camera.Orientation = glm::vec3(glm::sin(t * 6.2831853f), -0.1f, -glm::cos(t * 6.2831853f));
+			camera.updateMatrix(45.0f, 0.1f, 1000.0f);
+
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			queue.Begin(camera);
+			for (int x = 0; x < gridSize; x++)
+				for (int z = 0; z < gridSize; z++)
+					map.Submit(queue, shader, glm::translate(glm::mat4(1.0f), glm::vec3((x - gridSize / 2) * spacing, 0.0f, (z - gridSize / 2) * spacing)));
+			queue.Execute();
+
+			RenderQueue::Stats stats = queue.LastStats();
+			culled += stats.submitted > 0 ? 100.0 * stats.culled / stats.submitted : 0.0;
+			cpuMs += stats.cullMs + stats.sortMs + stats.submitMs;
+		});
+		std::cout << (Frustum::enabled ? "on" : "off") << " | " << gridSize * gridSize << " | " << culled / frames << " | "
+			<< cpuMs / frames << " | " << times.frameMs << std::endl;
+	}
+	Frustum::enabled = enabled;
+}
+
+// Draws planes scattered behind a wall with and without the occlusion buffer and prints what it hid and what it cost
+static void benchmark_occlusion(RenderQueue& queue, Mesh& mesh, Shader& shader, Camera& camera)
+{
+	const unsigned int count = 10000;
+	const unsigned int frames = 300;
+	OcclusionBuffer occlusion;
+	OcclusionBuffer::Occluder wall = mesh.GetOccluder();
+	glm::mat4 wallMatrix = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -20.0f)), glm::vec3(30.0f));
+	std::vector<glm::mat4> matrices;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		glm::vec3 position = glm::vec3(rand() % 100 - 50, rand() % 100 - 50, -25.0f - (float)(rand() % 75));
+		matrices.push_back(glm::translate(glm::mat4(1.0f), position));
+	}
+	OcclusionBuffer* previous = queue.occlusion;
+	SavedCamera saved(camera);
+
+	std::cout << "Occlusion | occluded % | raster ms | cull ms | frame ms" << std::endl;
+	for (unsigned int mode = 0; mode < 2; mode++)
+	{
+		queue.occlusion = mode == 1 ? &occlusion : NULL;
+		double occluded = 0.0;
+		double rasterMs = 0.0;
+		double cullMs = 0.0;
+		FrameTimes times = time_frames(frames, [&](unsigned int frame)
+		{
+			look_around(camera, frame, frames);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			if (queue.occlusion != NULL)
+			{
+				occlusion.Begin(camera.cameraMatrix);
+				occlusion.Add(wall, wallMatrix);
+				occlusion.Rasterize();
+				rasterMs += occlusion.GetStats().rasterMs;
+			}
+			queue.Begin(camera);
+			queue.Submit(mesh, shader, wallMatrix);
+			for (unsigned int i = 0; i < count; i++)
+				queue.Submit(mesh, shader, matrices[i]);
+			queue.Execute();
+
+			RenderQueue::Stats stats = queue.LastStats();
+			occluded += 100.0 * stats.occluded / stats.submitted;
+			cullMs += stats.cullMs;
+		});
+		std::cout << (mode == 1 ? "on" : "off") << " | " << occluded / frames << " | " << rasterMs / frames << " | "
+			<< cullMs / frames << " | " << times.frameMs << std::endl;
+	}
+	queue.occlusion = previous;
+}
+
+// Builds transform hierarchies that look like a scene of small models and times updating them while some nodes move
+static void benchmark_transforms()
+{
+	const unsigned int counts[] = { 1000, 10000, 100000, 1000000 };
+	const float moving[] = { 0.01f, 0.1f, 1.0f };
+	const unsigned int frames = 30;
+	std::cout << "Transforms | nodes | moving % | locals | worlds | update ms | nodes/ms" << std::endl;
+	for (unsigned int count : counts)
+	{
+		// Every node hangs off one of the few nodes before it, which gives short chains like the nodes of a model
+		TransformHierarchy hierarchy;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int parent = i % 64 == 0 ? TransformHierarchy::none : i - 1 - rand() % std::min(i % 64, 8u);
+			hierarchy.Add(parent, glm::vec3(rand() % 10, rand() % 10, rand() % 10));
+		}
+		hierarchy.Update();
+
+		for (float fraction : moving)
+		{
+			unsigned int step = (unsigned int)(1.0f / fraction);
+			double updateMs = 0.0;
+			TransformHierarchy::Stats stats;
+			for (unsigned int frame = 0; frame < frames; frame++)
+			{
+				glm::quat rotation = glm::angleAxis(0.01f * frame, glm::vec3(0.0f, 1.0f, 0.0f));
+				for (unsigned int i = frame % step; i < count; i += step)
+					hierarchy.SetRotation(i, rotation);
+				hierarchy.Update();
+				stats = hierarchy.GetStats();
+				updateMs += stats.updateMs;
+			}
+			updateMs /= frames;
+			std::cout << count << " | " << fraction * 100.0f << " | " << stats.locals << " | " << stats.worlds << " | " << updateMs << " | "
+				<< (updateMs > 0.0 ? stats.worlds / updateMs : 0.0) << std::endl;
+		}
+	}
+}
+
+// Makes a chain of joints that swings back and forth in two slightly different ways, like a tail or a tentacle
+static void animation_rig(TransformHierarchy& rig, std::vector<AnimationClip>& clips, std::vector<Skin>& skins, unsigned int joints)
+{
+	Skin skin;
+	for (unsigned int i = 0; i < joints; i++)
+	{
+		skin.joints.push_back(rig.Add(i == 0 ? TransformHierarchy::none : i - 1, glm::vec3(0.0f, 0.1f, 0.0f)));
+		skin.inverseBindMatrices.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.1f * (i + 1), 0.0f)));
+	}
+	skins.push_back(skin);
+	for (unsigned int c = 0; c < 2; c++)
+	{
+		AnimationClip clip;
+		clip.name = c == 0 ? "swing" : "wave";
+		clip.duration = 1.0f;
+		for (unsigned int i = 0; i < joints; i++)
+		{
+			AnimationClip::Channel channel;
+			channel.node = skin.joints[i];
+			channel.path = AnimationClip::ROTATION;
+			channel.step = false;
+			// 30 keys a second like most exported clips
+			for (unsigned int k = 0; k <= 30; k++)
+			{
+				float time = k / 30.0f;
+				glm::quat rotation = glm::angleAxis(0.2f * sinf(6.2831853f * time + i * (c + 1) * 0.3f), glm::vec3(c, 0.0f, 1.0f - c));
+				channel.times.push_back(time);
+				channel.values.push_back(glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w));
+			}
+			clip.channels.push_back(channel);
+		}
+		clips.push_back(clip);
+	}
+}
+
+// Plays a blend of two clips on more and more characters and prints how many of them 2ms of CPU time animates
+static void benchmark_animation()
+{
+	const unsigned int counts[] = { 1, 10, 100, 1000, 10000 };
+	const unsigned int threadCounts[] = { 1, 4 };
+	const unsigned int frames = 30;
+	const double budgetMs = 2.0;
+	TransformHierarchy rig;
+	std::vector<AnimationClip> clips;
+	std::vector<Skin> skins;
+	animation_rig(rig, clips, skins, 64);
+
+	std::cout << "Animation | characters | threads | joints | update ms | us per character" << std::endl;
+	for (unsigned int threads : threadCounts)
+	{
+		double bestPerCharacter = 0.0;
+		for (unsigned int count : counts)
+		{
+			Animator animator;
+			animator.threads = threads;
+			for (unsigned int i = 0; i < count; i++)
+			{
+				unsigned int character = animator.Add(rig, clips, skins);
+				animator.characters[character].time = 0.01f * i;
+				animator.characters[character].blendClip = 1;
+				animator.characters[character].blendWeight = 0.3f;
+			}
+			double updateMs = 0.0;
+			for (unsigned int frame = 0; frame < frames; frame++)
+			{
+				animator.Update(1.0f / 60.0f);
+				updateMs += animator.GetStats().updateMs;
+			}
+			updateMs /= frames;
+			bestPerCharacter = updateMs / count;
+			std::cout << count << " | " << threads << " | " << animator.GetStats().joints << " | " << updateMs << " | " << bestPerCharacter * 1000.0 << std::endl;
+		}
+		// The largest run spreads waking the workers over the most characters, so it predicts the budget best
+		std::cout << "About " << (unsigned int)(budgetMs / bestPerCharacter) << " characters fit into " << budgetMs << "ms on " << threads << " thread(s)" << std::endl;
+	}
+}
+
+// Projects points 1 to 1e7 units away from the center of the world the way the GPU would, once with float world matrices
+// and once relative to the camera, and prints how many pixels off both are and what placing objects around the camera costs
+static void benchmark_large_world()
+{
+	const double distances[] = { 1e2, 1e3, 1e4, 1e5, 1e6, 1e7 };
+	const unsigned int objects = 100000;
+	const int width = 1920;
+	const int height = 1080;
+	std::cout << "Large world | distance | float error px | relative error px" << std::endl;
+	for (double distance : distances)
+	{
+		double floatError = 0.0;
+		double relativeError = 0.0;
+		for (unsigned int i = 0; i < 1000; i++)
+		{
+			// A camera that moves a little every frame and a vertex of an object a few metres in front of it
+			glm::dvec3 cameraWorld = glm::dvec3(distance, 0.0, distance) + glm::dvec3(0.001 * i, 0.0, 0.0);
+			glm::dmat4 world = glm::translate(glm::dmat4(1.0), cameraWorld + glm::dvec3(0.3, 0.2, -5.0));
+			glm::dvec4 vertex = glm::dvec4(0.5, 0.5, 0.0, 1.0);
+
+			// What it should be, everything in double precision
+			glm::dmat4 view = glm::lookAt(cameraWorld, cameraWorld + glm::dvec3(0.0, 0.0, -1.0), glm::dvec3(0.0, 1.0, 0.0));
+			glm::dmat4 projection = glm::perspective(glm::radians(45.0), (double)width / height, 0.1, 100.0);
+			glm::dvec4 clip = projection * view * world * vertex;
+			glm::dvec2 expected = glm::dvec2(clip) / clip.w;
+
+			// Everything in floats relative to the center of the world, like the scene draws without an origin
+			Camera absolute(width, height, glm::vec3(cameraWorld));
+			absolute.updateMatrix(45.0f, 0.1f, 100.0f);
+			glm::vec4 absoluteClip = absolute.cameraMatrix * glm::mat4(world) * glm::vec4(vertex);
+			// The origin at the camera, so only the difference between the two gets turned into floats
+			Camera relative(width, height, glm::vec3(0.0f, 0.0f, 0.0f));
+			relative.Origin = cameraWorld;
+			relative.updateMatrix(45.0f, 0.1f, 100.0f);
+			glm::vec4 relativeClip = relative.cameraMatrix * relative.Relative(world) * glm::vec4(vertex);
+
+			glm::dvec2 pixels = glm::dvec2(width, height) * 0.5;
+			floatError = std::max(floatError, glm::length((glm::dvec2(absoluteClip) / (double)absoluteClip.w - expected) * pixels));
+			relativeError = std::max(relativeError, glm::length((glm::dvec2(relativeClip) / (double)relativeClip.w - expected) * pixels));
+		}
+		std::cout << distance << " | " << floatError << " | " << relativeError << std::endl;
+	}
+
+	// Placing objects around the origin only happens when the origin moves, the matrices the frames upload stay floats
+	std::vector<glm::dmat4> worlds;
+	for (unsigned int i = 0; i < objects; i++)
+		worlds.push_back(glm::translate(glm::dmat4(1.0), glm::dvec3(1e6 + rand() % 1000, rand() % 1000, rand() % 1000)));
+	std::vector<glm::mat4> matrices(objects);
+	Camera camera(width, height, glm::vec3(0.0f, 0.0f, 0.0f));
+	camera.Origin = glm::dvec3(1e6, 0.0, 0.0);
+	double start = glfwGetTime();
+	for (unsigned int i = 0; i < objects; i++)
+		matrices[i] = camera.Relative(worlds[i]);
+	double rebaseMs = (glfwGetTime() - start) * 1000.0;
+	std::cout << "Placing " << objects << " objects around a new origin took " << rebaseMs << "ms (" << rebaseMs * 1e6 / objects
+		<< "ns per object, " << matrices[rand() % objects][3].x << ")" << std::endl;
+}
+
+// Draws parallax mapped planes with and without the ID attachment and prints what it cost, then picks a pixel every frame
+// and prints how long the results took to come back and what asking for them cost compared to reading the pixel right away
+static void benchmark_picking(RenderQueue& queue, Mesh& mesh, Shader& shader, Camera& camera, ObjectPicker& picker)
+{
+	const unsigned int count = 1000;
+	const unsigned int frames = 300;
+	std::vector<glm::mat4> matrices;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		glm::vec3 position = glm::vec3(rand() % 40 - 20, rand() % 40 - 20, -5.0f - (float)(rand() % 50));
+		matrices.push_back(glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(3.0f)));
+	}
+	camera.updateMatrix(45.0f, 0.1f, 100.0f);
+	// Every plane gets its own ID, counted from 1 so the background stays 0
+	auto drawScene = [&]()
+	{
+		queue.Begin(camera);
+		for (unsigned int i = 0; i < count; i++)
+			queue.Submit(mesh, shader, matrices[i], false, 0, i + 1);
+		queue.Execute();
+	};
+
+	std::cout << "Picking | attachments | frame ms" << std::endl;
+	unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+	for (unsigned int buffers = 2; buffers <= 3; buffers++)
+	{
+		glDrawBuffers(buffers, attachments);
+		FrameTimes times = time_frames(frames, [&](unsigned int)
+		{
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			if (buffers == 3)
+				picker.Clear();
+			drawScene();
+		});
+		std::cout << buffers << " | " << times.frameMs << std::endl;
+	}
+	std::cout << "The ID attachment takes up " << picker.Bytes() / (1024.0 * 1024.0) << "MB" << std::endl;
+
+	// Ask for the pixel under a cursor that sweeps across the screen and collect whatever came back without waiting
+	unsigned int results = 0;
+	unsigned int hits = 0;
+	double latencyFrames = 0.0;
+	double latencyMs = 0.0;
+	double requestMs = 0.0;
+	for (unsigned int frame = 0; frame < frames; frame++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		picker.Clear();
+		drawScene();
+		double start = glfwGetTime();
+		picker.Request(camera.width * (frame + 0.5) / frames, camera.height / 2.0);
+		ObjectPicker::Result result;
+		while (picker.Poll(result))
+		{
+			results++;
+			hits += result.object != 0;
+			latencyFrames += result.frames;
+			latencyMs += result.latencyMs;
+		}
+		requestMs += (glfwGetTime() - start) * 1000.0;
+		// Stands in for the swap, the results are meant to be a frame old
+		glFlush();
+		picker.EndFrame();
+	}
+	// The same pixel read straight into memory, which waits until the GPU finished drawing the frame
+	double readMs = 0.0;
+	for (unsigned int frame = 0; frame < frames; frame++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		picker.Clear();
+		drawScene();
+		double start = glfwGetTime();
+		GLuint ids[2];
+		glReadBuffer(GL_COLOR_ATTACHMENT2);
+		glReadPixels(camera.width / 2, camera.height / 2, 1, 1, GL_RG_INTEGER, GL_UNSIGNED_INT, ids);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		readMs += (glfwGetTime() - start) * 1000.0;
+	}
+	std::cout << results << " picks (" << hits << " hit a plane) came back after " << latencyFrames / std::max(results, 1u) << " frames / "
+		<< latencyMs / std::max(results, 1u) << "ms, asking cost " << requestMs / frames << "ms per frame, reading right away "
+		<< readMs / frames << "ms" << std::endl;
+}
+
+// Builds BVHs over growing numbers of random boxes and prints what building, refitting and querying them cost
+static void benchmark_bvh(Camera& camera)
+{
+	const unsigned int counts[] = { 10000, 100000, 1000000 };
+	const unsigned int queries = 100;
+	SavedCamera saved(camera);
+	std::cout << "BVH | objects | nodes | depth | build ms | refit ms (10% moved) | frustum query ms (linear ms) | visible | ray ms" << std::endl;
+	for (unsigned int count : counts)
+	{
+		// Spread the boxes over a volume that grows with their count so the density stays the same
+		float extent = 10.0f * std::cbrt((float)count);
+		std::vector<AABB> boxes(count);
+		BVH bvh;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			glm::vec3 center = glm::vec3(rand(), rand(), rand()) / (float)RAND_MAX * 2.0f * extent - extent;
+			boxes[i].Add(center - 0.5f);
+			boxes[i].Add(center + 0.5f);
+			bvh.Insert(boxes[i]);
+		}
+		bvh.Build();
+
+		// Move every tenth box a little like a scene where only some objects are animated
+		for (unsigned int i = 0; i < count; i += 10)
+		{
+			glm::vec3 offset = glm::vec3(rand(), rand(), rand()) / (float)RAND_MAX - 0.5f;
+			boxes[i].min += offset;
+			boxes[i].max += offset;
+			bvh.Update(i, boxes[i]);
+		}
+		bvh.Refit();
+
+		// Look around from the middle and compare the tree to testing every box
+		std::vector<unsigned int> visible;
+		std::vector<unsigned char> linearVisible;
+		BoxBatch batch;
+		for (unsigned int i = 0; i < count; i++)
+			batch.Add(boxes[i], glm::mat4(1.0f));
+		double queryMs = 0.0;
+		double linearMs = 0.0;
+		double rayMs = 0.0;
+		size_t found = 0;
+		for (unsigned int i = 0; i < queries; i++)
+		{
+			float angle = 6.2831853f * i / queries;
+			camera.Position = glm::vec3(0.0f);
+			camera.Orientation = glm::vec3(glm::sin(angle), 0.0f, -glm::cos(angle));
+			camera.updateMatrix(45.0f, 0.1f, extent);
+
+			double start = glfwGetTime();
+			visible.clear();
+			bvh.Query(camera.frustum, visible);
+			queryMs += (glfwGetTime() - start) * 1000.0;
+			found += visible.size();
+
+			start = glfwGetTime();
+			camera.frustum.Test(batch, linearVisible);
+			linearMs += (glfwGetTime() - start) * 1000.0;
+
+			start = glfwGetTime();
+			unsigned int object;
+			float distance;
+			bvh.Raycast(camera.Position, camera.Orientation, object, distance);
+			rayMs += (glfwGetTime() - start) * 1000.0;
+		}
+		BVH::Stats stats = bvh.GetStats();
+		std::cout << count << " | " << stats.nodes << " | " << stats.depth << " | " << stats.buildMs << " | " << stats.refitMs << " | "
+			<< queryMs / queries << " (" << linearMs / queries << ") | " << found / queries << " | " << rayMs / queries << std::endl;
+	}
+}
+
+// Draws parallax mapped planes behind a wall with and without conditional rendering and prints the GPU time they took
+static void benchmark_occlusion_queries(OcclusionQueries& queries, Mesh& mesh, Shader& shader, Camera& camera)
+{
+	const unsigned int count = 1000;
+	const unsigned int frames = 300;
+	glm::mat4 wallMatrix = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -20.0f)), glm::vec3(30.0f));
+	std::vector<glm::mat4> matrices;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		glm::vec3 position = glm::vec3(rand() % 100 - 50, rand() % 100 - 50, -25.0f - (float)(rand() % 75));
+		matrices.push_back(glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(3.0f)));
+	}
+	bool enabled = OcclusionQueries::enabled;
+	bool countHidden = queries.countHidden;
+	queries.countHidden = true;
+	SavedCamera saved(camera);
+
+	std::cout << "Occlusion queries | hidden % | GPU ms | frame ms" << std::endl;
+	for (unsigned int mode = 0; mode < 2; mode++)
+	{
+		OcclusionQueries::enabled = mode == 1;
+		double hidden = 0.0;
+		double gpuMs = 0.0;
+		FrameTimes times = time_frames(frames, [&](unsigned int frame)
+		{
+			look_around(camera, frame, frames);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			// The wall goes first so the queries have something to be hidden behind
+			mesh.Draw(shader, camera, wallMatrix);
+			queries.Begin(camera);
+			for (unsigned int i = 0; i < count; i++)
+				queries.Draw(i, mesh, shader, matrices[i]);
+			queries.End();
+
+			OcclusionQueries::Stats stats = queries.LastStats();
+			hidden += stats.draws > 0 ? 100.0 * stats.hidden / stats.draws : 0.0;
+			gpuMs += stats.gpuMs;
+		});
+		std::cout << (mode == 1 ? "on" : "off") << " | " << hidden / frames << " | " << gpuMs / frames << " | " << times.frameMs << std::endl;
+	}
+	OcclusionQueries::enabled = enabled;
+	queries.countHidden = countHidden;
+}
+
+// Runs every benchmark that is turned on
+void Benchmarks::Run(GLuint framebuffer, RenderQueue& queue, Mesh& plane, std::vector<Vertex>& vertices, std::vector<GLuint>& indices,
+	Shader& shader, Camera& camera, ObjectPicker& picker, OcclusionQueries& queries, std::string resourceDir)
+{
+	if (memoryReport)
+	{
+		report_model_memory(resourceDir,
+		{
+			"YoutubeOpenGL 13 - Model Loading/models/grindstone/scene.gltf",
+			"YoutubeOpenGL 19 - Cubemaps & Skyboxes/models/airplane/scene.gltf",
+			"YoutubeOpenGL 21 - Instancing/models/asteroid/scene.gltf",
+			"YoutubeOpenGL 21 - Instancing/models/jupiter/scene.gltf",
+			"YoutubeOpenGL 14 - Depth Buffer/models/ground/scene.gltf"
+		});
+	}
+
+	// The benchmarks that draw do it into the framebuffer of the scene, seen from where the camera starts
+	auto drawTarget = [&]()
+	{
+		StateCache::BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		StateCache::Enable(GL_DEPTH_TEST);
+		camera.updateMatrix(45.0f, 0.1f, 100.0f);
+	};
+
+	if (instancing)
+	{
+		drawTarget();
+		benchmark_instancing(queue, plane, shader, camera);
+	}
+	if (dsa)
+	{
+		drawTarget();
+		benchmark_dsa(vertices, indices, shader, camera);
+	}
+	if (culling)
+	{
+		drawTarget();
+		benchmark_culling(queue, shader, camera, resourceDir);
+	}
+	if (occlusion)
+	{
+		drawTarget();
+		benchmark_occlusion(queue, plane, shader, camera);
+	}
+	if (transforms)
+		benchmark_transforms();
+	if (animation)
+		benchmark_animation();
+	if (largeWorld)
+		benchmark_large_world();
+	if (picking)
+	{
+		drawTarget();
+		benchmark_picking(queue, plane, shader, camera, picker);
+	}
+	if (bvh)
+		benchmark_bvh(camera);
+	if (occlusionQueries && OcclusionQueries::Supported())
+	{
+		drawTarget();
+		benchmark_occlusion_queries(queries, plane, shader, camera);
+	}
+}
\ No newline at end of file
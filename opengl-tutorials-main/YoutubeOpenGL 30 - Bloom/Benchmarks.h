@@ -0,0 +1,42 @@
+#ifndef BENCHMARKS_CLASS_H
+#define BENCHMARKS_CLASS_H
+
+#include"Model.h"
+#include"OcclusionQueries.h"
+#include"ObjectPicker.h"
+
+// Measurements of the engine features that print a table to the console before the main loop starts. Every benchmark
+// builds a scene of its own, compares a feature turned on and off and puts the settings and the camera back afterwards.
+// They are all off by default so the demo starts right away.
+class Benchmarks
+{
+public:
+	// Loads the biggest models of the Resources folder and prints how much memory each one holds and what it did to the RSS
+	bool memoryReport = false;
+	// Draws 1 up to 10000 copies of the plane with and without automatic instancing and prints what it cost
+	bool instancing = false;
+	// Times making and drawing meshes with and without Direct State Access, and with one VAO per mesh or one shared VAO
+	bool dsa = false;
+	// Flies through a grid of copies of the map model with and without frustum culling and prints what was culled and the frame times
+	bool culling = false;
+	// Hides 10000 planes behind a big wall and prints how many the occlusion buffer dropped and what that saved
+	bool occlusion = false;
+	// Draws 1000 parallax mapped planes behind a wall with and without occlusion queries and prints the GPU time of both
+	bool occlusionQueries = false;
+	// Animates part of a transform hierarchy of 1k to 1M nodes every frame and prints how many nodes one millisecond updates
+	bool transforms = false;
+	// Times building, refitting and querying a BVH over 10k, 100k and 1M random boxes against testing every box
+	bool bvh = false;
+	// Plays the animations of 1 up to 10000 characters with a 64 joint skeleton on 1 and 4 threads and prints how many fit into 2ms
+	bool animation = false;
+	// Compares drawing far from the center of the world with float matrices and relative to the camera and times the rebasing
+	bool largeWorld = false;
+	// Times drawing with and without the ID attachment and how long picks take to come back
+	bool picking = false;
+
+	// Runs every benchmark that is turned on, the ones that draw do it into the framebuffer with the plane (made from
+	// the vertices and indices) and the shader of the scene
+	void Run(GLuint framebuffer, RenderQueue& queue, Mesh& plane, std::vector<Vertex>& vertices, std::vector<GLuint>& indices,
+		Shader& shader, Camera& camera, ObjectPicker& picker, OcclusionQueries& queries, std::string resourceDir);
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,442 @@
+#include"BufferHeap.h"
+
+#include<chrono>
+#include<algorithm>
+#include<stdexcept>
+#include<string>
+
+// Index of the highest set bit
+static unsigned int highest_bit(GLsizeiptr value)
+{
+	unsigned int bit = 0;
+	while (value >>= 1)
+		bit++;
+	return bit;
+}
+
+// Index of the lowest set bit (value can't be 0)
+static unsigned int lowest_bit(unsigned int value)
+{
+	unsigned int bit = 0;
+	while ((value & 1) == 0)
+	{
+		value >>= 1;
+		bit++;
+	}
+	return bit;
+}
+
+// Prepares a heap that makes blocks of blockSize bytes (bigger allocations get a block of their own)
+BufferHeap::BufferHeap(GLsizeiptr blockSize)
+{
+	BufferHeap::blockSize = (blockSize + granularity - 1) / granularity;
+	for (unsigned int i = 0; i < firstLevelCount; i++)
+		for (unsigned int j = 0; j < secondLevelCount; j++)
+			freeLists[i][j] = -1;
+}
+
+// Reserves size bytes and returns the handle of the range
+unsigned int BufferHeap::Allocate(GLsizeiptr size)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	GLsizeiptr granules = std::max((size + granularity - 1) / granularity, (GLsizeiptr)1);
+
+	// The free range of a new block is used right away, a block of its own for a big allocation doesn't have to fill
+	// a whole size class, so searching the classes could miss it
+	int found = findFree(granules);
+	if (found == -1)
+		found = addBlock(std::max(granules, blockSize));
+	if (found == -1)
+		throw std::runtime_error("BufferHeap couldn't find room for " + std::to_string(size) + " bytes");
+	unsigned int range = (unsigned int)found;
+	removeFree(range);
+
+	// Put whatever is left over back as a free range right behind the new one
+	if (ranges[range].size > granules)
+	{
+		unsigned int rest = newRange();
+		ranges[rest].block = ranges[range].block;
+		ranges[rest].offset = ranges[range].offset + granules;
+		ranges[rest].size = ranges[range].size - granules;
+		ranges[rest].free = true;
+		ranges[rest].previous = range;
+		ranges[rest].next = ranges[range].next;
+		if (ranges[rest].next != -1)
+			ranges[ranges[rest].next].previous = rest;
+		ranges[range].next = rest;
+		ranges[range].size = granules;
+		insertFree(rest);
+	}
+	ranges[range].free = false;
+	ranges[range].requested = size;
+
+	stats.allocations++;
+	stats.requested += size;
+	stats.allocated += granules * granularity;
+	stats.allocateCalls++;
+	stats.allocateMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return range;
+}
+
+// Reserves a range and copies data into it
+unsigned int BufferHeap::Upload(const void* data, GLsizeiptr size)
+{
+	unsigned int allocation = Allocate(size);
+	if (StateCache::DSA())
+		glNamedBufferSubData(Buffer(allocation), Offset(allocation), size, data);
+	else
+	{
+		// The copy target is used so the element buffer of whatever VAO is bound doesn't get replaced
+		StateCache::BindBuffer(GL_COPY_WRITE_BUFFER, Buffer(allocation));
+		glBufferSubData(GL_COPY_WRITE_BUFFER, Offset(allocation), size, data);
+	}
+	return allocation;
+}
+
+// Gives a range back, it gets reused once the GPU has finished the current frame
+void BufferHeap::Free(unsigned int allocation)
+{
+	stats.allocations--;
+	stats.requested -= ranges[allocation].requested;
+	stats.allocated -= ranges[allocation].size * granularity;
+	freedThisFrame.push_back(allocation);
+}
+
+// Buffer object and offset a range currently lives at
+GLuint BufferHeap::Buffer(unsigned int allocation)
+{
+	return blocks[ranges[allocation].block].ID;
+}
+
+GLintptr BufferHeap::Offset(unsigned int allocation)
+{
+	return ranges[allocation].offset * granularity;
+}
+
+// Fences the ranges freed this frame and reuses the ones whose fence has passed (call once per frame)
+void BufferHeap::EndFrame()
+{
+	if (!freedThisFrame.empty())
+	{
+		retired.push_back(Retired{ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), freedThisFrame });
+		freedThisFrame.clear();
+	}
+
+	// Frames finish in order, so stop at the first one the GPU is still working on
+	unsigned int done = 0;
+	while (done < retired.size())
+	{
+		GLenum result = glClientWaitSync(retired[done].fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(retired[done].fence);
+		for (unsigned int i = 0; i < retired[done].ranges.size(); i++)
+			release(retired[done].ranges[i]);
+		done++;
+	}
+	retired.erase(retired.begin(), retired.begin() + done);
+}
+
+// How scattered the free space is, 0 when it is all in one piece and close to 1 when it is in many small ones
+float BufferHeap::Fragmentation()
+{
+	GLsizeiptr total = 0;
+	GLsizeiptr largest = 0;
+	for (unsigned int i = 0; i < ranges.size(); i++)
+	{
+		if (ranges[i].free && ranges[i].size > 0)
+		{
+			total += ranges[i].size;
+			largest = std::max(largest, ranges[i].size);
+		}
+	}
+	return total == 0 ? 0.0f : 1.0f - (float)largest / total;
+}
+
+// Copies every live range into new blocks without gaps and deletes the old blocks
+void BufferHeap::Compact()
+{
+	// The old blocks are deleted below and OpenGL keeps them alive until the GPU is done with them,
+	// so ranges that are still waiting on a fence can simply be dropped
+	for (unsigned int i = 0; i < retired.size(); i++)
+	{
+		glDeleteSync(retired[i].fence);
+		for (unsigned int j = 0; j < retired[i].ranges.size(); j++)
+			ranges[retired[i].ranges[j]].free = true;
+	}
+	for (unsigned int i = 0; i < freedThisFrame.size(); i++)
+		ranges[freedThisFrame[i]].free = true;
+	retired.clear();
+	freedThisFrame.clear();
+
+	// Collect the live ranges in the order they sit in memory, everything else becomes an unused slot
+	std::vector<unsigned int> live;
+	unusedRanges.clear();
+	for (unsigned int i = 0; i < ranges.size(); i++)
+	{
+		if (!ranges[i].free)
+		{
+			live.push_back(i);
+		}
+		else
+		{
+			ranges[i].size = 0;
+			unusedRanges.push_back(i);
+		}
+	}
+	std::sort(live.begin(), live.end(), [this](unsigned int a, unsigned int b)
+	{
+		if (ranges[a].block != ranges[b].block)
+			return ranges[a].block < ranges[b].block;
+		return ranges[a].offset < ranges[b].offset;
+	});
+
+	std::vector<Block> oldBlocks = blocks;
+	blocks.clear();
+	for (unsigned int i = 0; i < firstLevelCount; i++)
+	{
+		secondLevelBitmaps[i] = 0;
+		for (unsigned int j = 0; j < secondLevelCount; j++)
+			freeLists[i][j] = -1;
+	}
+	firstLevelBitmap = 0;
+
+	// Place the live ranges right after each other, the handles stay the same so nobody has to reallocate
+	GLsizeiptr cursor = 0;
+	int last = -1;
+	for (unsigned int i = 0; i < live.size(); i++)
+	{
+		if (blocks.empty() || cursor + ranges[live[i]].size > blocks.back().size)
+		{
+			finishBlock(cursor, last);
+			createBlock(std::max(ranges[live[i]].size, blockSize));
+			cursor = 0;
+			last = -1;
+		}
+		// Taken after finishing the block since that can add a range slot
+		Range& range = ranges[live[i]];
+
+		if (StateCache::DSA())
+			glCopyNamedBufferSubData(oldBlocks[range.block].ID, blocks.back().ID, range.offset * granularity, cursor * granularity, range.size * granularity);
+		else
+		{
+			StateCache::BindBuffer(GL_COPY_READ_BUFFER, oldBlocks[range.block].ID);
+			StateCache::BindBuffer(GL_COPY_WRITE_BUFFER, blocks.back().ID);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.offset * granularity, cursor * granularity, range.size * granularity);
+		}
+
+		range.block = (unsigned int)blocks.size() - 1;
+		range.offset = cursor;
+		range.previous = last;
+		range.next = -1;
+		if (last != -1)
+			ranges[last].next = live[i];
+		last = live[i];
+		cursor += range.size;
+	}
+	finishBlock(cursor, last);
+
+	for (unsigned int i = 0; i < oldBlocks.size(); i++)
+	{
+		StateCache::ForgetBuffer(oldBlocks[i].ID);
+		glDeleteBuffers(1, &oldBlocks[i].ID);
+	}
+	stats.compactions++;
+	generation++;
+}
+
+// Stats of the heap right now
+BufferHeap::Stats BufferHeap::GetStats()
+{
+	Stats current = stats;
+	current.bufferObjects = (unsigned int)blocks.size();
+	current.reserved = 0;
+	for (unsigned int i = 0; i < blocks.size(); i++)
+		current.reserved += blocks[i].size * granularity;
+	return current;
+}
+
+BufferHeap::~BufferHeap()
+{
+	Delete();
+}
+
+// Deletes every block (the destructor does this too, calling it earlier is fine)
+void BufferHeap::Delete()
+{
+	for (unsigned int i = 0; i < retired.size(); i++)
+		glDeleteSync(retired[i].fence);
+	retired.clear();
+	for (unsigned int i = 0; i < blocks.size(); i++)
+	{
+		StateCache::ForgetBuffer(blocks[i].ID);
+		glDeleteBuffers(1, &blocks[i].ID);
+	}
+	blocks.clear();
+}
+
+// Size class of a number of granules
+void BufferHeap::mapping(GLsizeiptr granules, unsigned int& firstLevel, unsigned int& secondLevel)
+{
+	// Small sizes get a class each, bigger ones share a class with the sizes close to them
+	if (granules < secondLevelCount)
+	{
+		firstLevel = 0;
+		secondLevel = (unsigned int)granules;
+		return;
+	}
+	unsigned int bit = highest_bit(granules);
+	firstLevel = bit - secondLevelLog2 + 1;
+	secondLevel = (unsigned int)(granules >> (bit - secondLevelLog2)) ^ secondLevelCount;
+}
+
+// Makes a new block and puts all of it into the free lists, returns the free range that covers it
+int BufferHeap::addBlock(GLsizeiptr granules)
+{
+	createBlock(granules);
+	return finishBlock(0, -1);
+}
+
+// Makes a new empty buffer object for a block
+void BufferHeap::createBlock(GLsizeiptr granules)
+{
+	Block block;
+	block.size = granules;
+	// Immutable storage lets the driver place the block once, older contexts get a normal buffer
+	if (StateCache::DSA())
+	{
+		glCreateBuffers(1, &block.ID);
+		glNamedBufferStorage(block.ID, granules * granularity, NULL, GL_DYNAMIC_STORAGE_BIT);
+		blocks.push_back(block);
+		return;
+	}
+	glGenBuffers(1, &block.ID);
+	StateCache::BindBuffer(GL_COPY_WRITE_BUFFER, block.ID);
+	if (GLAD_GL_VERSION_4_4)
+		glBufferStorage(GL_COPY_WRITE_BUFFER, granules * granularity, NULL, GL_DYNAMIC_STORAGE_BIT);
+	else
+		glBufferData(GL_COPY_WRITE_BUFFER, granules * granularity, NULL, GL_STATIC_DRAW);
+	blocks.push_back(block);
+}
+
+// Turns everything of the last block behind used granules into a free range that follows the range last
+int BufferHeap::finishBlock(GLsizeiptr used, int last)
+{
+	if (blocks.empty() || used >= blocks.back().size)
+		return -1;
+	unsigned int range = newRange();
+	ranges[range].block = (unsigned int)blocks.size() - 1;
+	ranges[range].offset = used;
+	ranges[range].size = blocks.back().size - used;
+	ranges[range].free = true;
+	ranges[range].previous = last;
+	ranges[range].next = -1;
+	if (last != -1)
+		ranges[last].next = range;
+	insertFree(range);
+	return (int)range;
+}
+
+// Finds a free range of at least a number of granules, -1 if there is none
+int BufferHeap::findFree(GLsizeiptr granules)
+{
+	// Round up to the next class so every range in the class found is big enough
+	if (granules >= secondLevelCount)
+		granules += ((GLsizeiptr)1 << (highest_bit(granules) - secondLevelLog2)) - 1;
+	unsigned int firstLevel, secondLevel;
+	mapping(granules, firstLevel, secondLevel);
+	if (firstLevel >= firstLevelCount)
+		return -1;
+
+	// Look for a class of the same power of two that is at least as big, then for any bigger power of two
+	unsigned int secondLevelMap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+	if (secondLevelMap == 0)
+	{
+		unsigned int firstLevelMap = firstLevel + 1 < firstLevelCount ? firstLevelBitmap & (~0u << (firstLevel + 1)) : 0;
+		if (firstLevelMap == 0)
+			return -1;
+		firstLevel = lowest_bit(firstLevelMap);
+		secondLevelMap = secondLevelBitmaps[firstLevel];
+	}
+	return freeLists[firstLevel][lowest_bit(secondLevelMap)];
+}
+
+void BufferHeap::insertFree(unsigned int range)
+{
+	unsigned int firstLevel, secondLevel;
+	mapping(ranges[range].size, firstLevel, secondLevel);
+	int head = freeLists[firstLevel][secondLevel];
+	ranges[range].previousFree = -1;
+	ranges[range].nextFree = head;
+	if (head != -1)
+		ranges[head].previousFree = range;
+	freeLists[firstLevel][secondLevel] = range;
+	firstLevelBitmap |= 1u << firstLevel;
+	secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void BufferHeap::removeFree(unsigned int range)
+{
+	unsigned int firstLevel, secondLevel;
+	mapping(ranges[range].size, firstLevel, secondLevel);
+	int previous = ranges[range].previousFree;
+	int next = ranges[range].nextFree;
+	if (previous != -1)
+		ranges[previous].nextFree = next;
+	else
+		freeLists[firstLevel][secondLevel] = next;
+	if (next != -1)
+		ranges[next].previousFree = previous;
+
+	// Clear the bits of lists that just became empty
+	if (freeLists[firstLevel][secondLevel] == -1)
+	{
+		secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+		if (secondLevelBitmaps[firstLevel] == 0)
+			firstLevelBitmap &= ~(1u << firstLevel);
+	}
+}
+
+// Gets an unused range slot
+unsigned int BufferHeap::newRange()
+{
+	if (!unusedRanges.empty())
+	{
+		unsigned int range = unusedRanges.back();
+		unusedRanges.pop_back();
+		return range;
+	}
+	ranges.push_back(Range());
+	return (unsigned int)ranges.size() - 1;
+}
+
+// Marks a range as free and merges it with its free neighbours
+void BufferHeap::release(unsigned int range)
+{
+	ranges[range].free = true;
+
+	int next = ranges[range].next;
+	if (next != -1 && ranges[next].free)
+	{
+		removeFree(next);
+		ranges[range].size += ranges[next].size;
+		ranges[range].next = ranges[next].next;
+		if (ranges[range].next != -1)
+			ranges[ranges[range].next].previous = range;
+		ranges[next].size = 0;
+		unusedRanges.push_back(next);
+	}
+	int previous = ranges[range].previous;
+	if (previous != -1 && ranges[previous].free)
+	{
+		removeFree(previous);
+		ranges[previous].size += ranges[range].size;
+		ranges[previous].next = ranges[range].next;
+		if (ranges[previous].next != -1)
+			ranges[ranges[previous].next].previous = previous;
+		ranges[range].size = 0;
+		unusedRanges.push_back(range);
+		range = previous;
+	}
+	insertFree(range);
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#ifndef BUFFER_HEAP_CLASS_H
+#define BUFFER_HEAP_CLASS_H
+
+#include<glad/glad.h>
+#include<vector>
+#include<cstddef>
+
+#include"StateCache.h"
+
+// Hands out ranges of a few large buffer objects instead of making a buffer object per mesh.
+// Free ranges are found with a two level segregated fit (TLSF): the first level splits sizes by powers of two,
+// the second splits every power of two into 16 classes, and bitmaps tell which classes have a free range.
+// Freed ranges only become reusable once the GPU is done with the frames that could still read them, and
+// Compact copies the live ranges into fresh tightly packed blocks, after which ranges have new offsets.
+class BufferHeap
+{
+public:
+	// What the heap holds and what it cost to get there
+	struct Stats
+	{
+		unsigned int bufferObjects = 0;
+		unsigned int allocations = 0;
+		// Bytes that were asked for, bytes handed out after rounding up and bytes of all the blocks together
+		GLsizeiptr requested = 0;
+		GLsizeiptr allocated = 0;
+		GLsizeiptr reserved = 0;
+		// Calls to Allocate and the CPU time they took altogether
+		unsigned int allocateCalls = 0;
+		double allocateMs = 0.0;
+		unsigned int compactions = 0;
+	};
+
+	// Every range starts at a multiple of this, which satisfies vertex, index and uniform buffer offsets
+	static const GLsizeiptr granularity = 256;
+	// Goes up every time Compact moved the ranges, anything holding offsets has to fetch them again
+	unsigned int generation = 0;
+
+	// Prepares a heap that makes blocks of blockSize bytes (bigger allocations get a block of their own)
+	BufferHeap(GLsizeiptr blockSize = 16 * 1024 * 1024);
+	// The heap owns its blocks, so it can't be copied and deletes them with the object
+	BufferHeap(const BufferHeap&) = delete;
+	BufferHeap& operator=(const BufferHeap&) = delete;
+	~BufferHeap();
+
+	// Reserves size bytes and returns the handle of the range
+	unsigned int Allocate(GLsizeiptr size);
+	// Reserves a range and copies data into it
+	unsigned int Upload(const void* data, GLsizeiptr size);
+	// Gives a range back, it gets reused once the GPU has finished the current frame
+	void Free(unsigned int allocation);
+	// Buffer object and offset a range currently lives at
+	GLuint Buffer(unsigned int allocation);
+	GLintptr Offset(unsigned int allocation);
+
+	// Fences the ranges freed this frame and reuses the ones whose fence has passed (call once per frame)
+	void EndFrame();
+	// How scattered the free space is, 0 when it is all in one piece and close to 1 when it is in many small ones
+	float Fragmentation();
+	// Copies every live range into new blocks without gaps and deletes the old blocks
+	void Compact();
+	// Stats of the heap right now
+	Stats GetStats();
+
+	// Deletes every block (the destructor does this too, calling it earlier is fine)
+	void Delete();
+
+private:
+	static const unsigned int secondLevelLog2 = 4;
+	static const unsigned int secondLevelCount = 1 << secondLevelLog2;
+	static const unsigned int firstLevelCount = 32;
+
+	// A piece of a block, either handed out or free. Sizes and offsets are counted in granules
+	struct Range
+	{
+		unsigned int block;
+		GLsizeiptr offset;
+		GLsizeiptr size;
+		GLsizeiptr requested;
+		bool free;
+		// Neighbours inside the block and inside the free list (-1 for none)
+		int previous;
+		int next;
+		int previousFree;
+		int nextFree;
+	};
+	struct Block
+	{
+		GLuint ID;
+		GLsizeiptr size;
+	};
+	// Ranges freed during a frame and the fence that tells when the GPU is done with that frame
+	struct Retired
+	{
+		GLsync fence;
+		std::vector<unsigned int> ranges;
+	};
+
+	GLsizeiptr blockSize;
+	std::vector<Block> blocks;
+	std::vector<Range> ranges;
+	// Range slots that aren't used by anything and can be recycled
+	std::vector<unsigned int> unusedRanges;
+
+	// Heads of the free lists of every size class and bitmaps of the lists that aren't empty
+	int freeLists[firstLevelCount][secondLevelCount];
+	unsigned int firstLevelBitmap = 0;
+	unsigned int secondLevelBitmaps[firstLevelCount] = { 0 };
+
+	std::vector<unsigned int> freedThisFrame;
+	std::vector<Retired> retired;
+	Stats stats;
+
+	// Size class of a number of granules
+	static void mapping(GLsizeiptr granules, unsigned int& firstLevel, unsigned int& secondLevel);
+	// Makes a new block and puts all of it into the free lists, returns the free range that covers it
+	int addBlock(GLsizeiptr granules);
+	// Makes a new empty buffer object for a block
+	void createBlock(GLsizeiptr granules);
+	// Turns everything of the last block behind used granules into a free range that follows the range last,
+	// returns that range (-1 if the block is full)
+	int finishBlock(GLsizeiptr used, int last);
+	// Finds a free range of at least a number of granules, -1 if there is none
+	int findFree(GLsizeiptr granules);
+	void insertFree(unsigned int range);
+	void removeFree(unsigned int range);
+	// Gets an unused range slot
+	unsigned int newRange();
+	// Marks a range as free and merges it with its free neighbours
+	void release(unsigned int range);
+};
+#endif
\ No newline at end of file
@@ -7,21 +7,26 @@ Camera::Camera(int width, int height, glm::vec3 position)
 	Camera::width = width;
 	Camera::height = height;
 	Position = position;
+	previousPosition = position;
 }
 
-void Camera::updateMatrix(float FOVdeg, float nearPlane, float farPlane)
+void Camera::updateMatrix(float FOVdeg, float nearPlane, float farPlane, float alpha)
 {
+	// Frames between two steps show the camera part of the way, which hides that the steps are fewer than the frames
+	glm::vec3 viewPosition = glm::mix(previousPosition, Position, alpha);
+
 	// Initializes matrices since otherwise they will be the null matrix
 	glm::mat4 view = glm::mat4(1.0f);
 	glm::mat4 projection = glm::mat4(1.0f);
 
 	// Makes camera look in the right direction from the right position
-	view = glm::lookAt(Position, Position + Orientation, Up);
+	view = glm::lookAt(viewPosition, viewPosition + Orientation, Up);
 	// Adds perspective to the scene
 	projection = glm::perspective(glm::radians(FOVdeg), (float)width / height, nearPlane, farPlane);
 
 	// Sets new camera matrix
 	cameraMatrix = projection * view;
+	frustum.Update(cameraMatrix);
 }
 
 void Camera::Matrix(Shader& shader, const char* uniform)
@@ -34,42 +39,37 @@ void Camera::Matrix(Shader& shader, const char* uniform)
 
 void Camera::Inputs(GLFWwindow* window)
 {
-	// Handles key inputs
+	// Handles key inputs, the movement itself happens in Step so it doesn't depend on how often this gets called
+	moveInput = glm::vec3(0.0f, 0.0f, 0.0f);
+	glm::vec3 right = glm::normalize(glm::cross(Orientation, Up));
 	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
 	{
-		Position += speed * Orientation;
+		moveInput += Orientation;
 	}
 	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
 	{
-		Position += speed * -glm::normalize(glm::cross(Orientation, Up));
+		moveInput += -right;
 	}
 	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
 	{
-		Position += speed * -Orientation;
+		moveInput += -Orientation;
 	}
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
 	{
-		Position += speed * glm::normalize(glm::cross(Orientation, Up));
+		moveInput += right;
 	}
 	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
 	{
-		Position += speed * Up;
+		moveInput += Up;
 	}
 	if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
 	{
-		Position += speed * -Up;
-	}
-	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
-	{
-		speed = 0.4f;
-	}
-	else if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_RELEASE)
-	{
-		speed = 0.1f;
+		moveInput += -Up;
 	}
+	fast = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
 
 
-	// Handles mouse inputs
+	// Handles mouse inputs (the cursor moved by the same amount however many frames it took, so these don't need a step)
 	if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
 	{
 		// Hides mouse cursor
@@ -115,4 +115,44 @@ void Camera::Inputs(GLFWwindow* window)
 		// Makes sure the next time the camera looks around it doesn't jump
 		firstClick = true;
 	}
+}
+
+// Moves the camera by the keys that were held for one fixed step of deltaTime seconds
+void Camera::Step(float deltaTime)
+{
+	previousPosition = Position;
+	Position += moveInput * (fast ? fastSpeed : speed) * deltaTime;
+}
+
+// Position of the camera in the world
+glm::dvec3 Camera::WorldPosition()
+{
+	return Origin + glm::dvec3(Position);
+}
+
+// Moves the origin to the camera once it got further than rebaseDistance away
+bool Camera::Rebase()
+{
+	if (glm::length(Position) <= rebaseDistance || Position == glm::vec3(0.0f, 0.0f, 0.0f))
+		return false;
+	// The step being interpolated moves along, so the view doesn't jump
+	previousPosition -= Position;
+	Origin += glm::dvec3(Position);
+	Position = glm::vec3(0.0f, 0.0f, 0.0f);
+	return true;
+}
+
+// Brings a world matrix into the space of the origin
+glm::mat4 Camera::Relative(const glm::dmat4& world)
+{
+	// Same as translating by -Origin first, but only the translation column changes
+	glm::dmat4 relative = world;
+	relative[3] -= glm::dvec4(Origin * world[3].w, 0.0);
+	return glm::mat4(relative);
+}
+
+// Brings a world point into the space of the origin
+glm::vec3 Camera::Relative(const glm::dvec3& point)
+{
+	return glm::vec3(point - Origin);
 }
\ No newline at end of file
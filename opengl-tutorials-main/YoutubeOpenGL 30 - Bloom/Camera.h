@@ -10,15 +10,25 @@
 #include<glm/gtx/vector_angle.hpp>
 
 #include"shaderClass.h"
+#include"Frustum.h"
 
 class Camera
 {
 public:
 	// Stores the main vectors of the camera
 	glm::vec3 Position;
+	// Where the camera was before the last step, the view is placed between this and Position
+	glm::vec3 previousPosition;
+	// Point of the world everything gets drawn relative to, in double precision so the world can be far bigger than what
+	// floats place precisely (Position is relative to it as well and Rebase keeps it small)
+	glm::dvec3 Origin = glm::dvec3(0.0, 0.0, 0.0);
+	// How far the camera may get from the origin before the origin moves to it (0 moves it every step the camera moves)
+	float rebaseDistance = 256.0f;
 	glm::vec3 Orientation = glm::vec3(0.0f, 0.0f, -1.0f);
 	glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	glm::mat4 cameraMatrix = glm::mat4(1.0f);
+	// Planes of cameraMatrix, updated along with it
+	Frustum frustum;
 
 	// Prevents the camera from jumping around when first clicking left click
 	bool firstClick = true;
@@ -27,18 +37,34 @@ public:
 	int width;
 	int height;
 
-	// Adjust the speed of the camera and it's sensitivity when looking around
-	float speed = 0.1f;
+	// Adjust the speed of the camera (in units per second, fast is while shift is held) and it's sensitivity when looking around
+	float speed = 6.0f;
+	float fastSpeed = 24.0f;
 	float sensitivity = 100.0f;
+	// Direction the keys push the camera in (not normalized) and if shift is held, read by Inputs and used by Step
+	glm::vec3 moveInput = glm::vec3(0.0f, 0.0f, 0.0f);
+	bool fast = false;
 
 	// Camera constructor to set up initial values
 	Camera(int width, int height, glm::vec3 position);
 
-	// Updates the camera matrix to the Vertex Shader
-	void updateMatrix(float FOVdeg, float nearPlane, float farPlane);
+	// Updates the camera matrix to the Vertex Shader, alpha places the view between the last two steps (1 is Position)
+	void updateMatrix(float FOVdeg, float nearPlane, float farPlane, float alpha = 1.0f);
 	// Exports the camera matrix to a shader
 	void Matrix(Shader& shader, const char* uniform);
-	// Handles camera inputs
+	// Handles camera inputs, looking around happens right away but moving waits for Step
 	void Inputs(GLFWwindow* window);
+	// Moves the camera by the keys that were held for one fixed step of deltaTime seconds
+	void Step(float deltaTime);
+
+	// Position of the camera in the world
+	glm::dvec3 WorldPosition();
+	// Moves the origin to the camera once it got further than rebaseDistance away, returns true if it did,
+	// in which case everything that was placed relative to the old origin has to be placed again
+	bool Rebase();
+	// Brings a world matrix or point into the space of the origin, the subtraction happens in double precision
+	// so only the small difference ever has to fit into a float
+	glm::mat4 Relative(const glm::dmat4& world);
+	glm::vec3 Relative(const glm::dvec3& point);
 };
 #endif
\ No newline at end of file
@@ -1,27 +1,106 @@
 #include"EBO.h"
 
-// Constructor that generates a Elements Buffer Object and links it to indices
-EBO::EBO(std::vector<GLuint>& indices)
+#include<utility>
+
+unsigned int EBO::alive = 0;
+
+// Constructor that generates a Elements Buffer Object and fills it with indices (bind it while the VAO is bound)
+EBO::EBO(std::vector<GLuint>& indices, BufferHeap* heap)
+{
+	EBO::heap = heap;
+	if (heap != NULL)
+	{
+		allocation = heap->Upload(indices.data(), indices.size() * sizeof(GLuint));
+		ID = heap->Buffer(allocation);
+		offset = heap->Offset(allocation);
+		generation = heap->generation;
+		alive++;
+		return;
+	}
+	if (StateCache::DSA())
+	{
+		// Filled by name, so nothing has to be bound
+		glCreateBuffers(1, &ID);
+		glNamedBufferData(ID, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+	}
+	else
+	{
+		glGenBuffers(1, &ID);
+		// Filled through the copy target so the element buffer of whatever VAO is bound doesn't get replaced
+		StateCache::BindBuffer(GL_COPY_WRITE_BUFFER, ID);
+		glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+	}
+	alive++;
+}
+
+// Makes an empty EBO that owns nothing, something can be moved into it later
+EBO::EBO()
+{
+}
+
+EBO::EBO(EBO&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+EBO& EBO::operator=(EBO&& other) noexcept
+{
+	if (this != &other)
+	{
+		Delete();
+		ID = other.ID;
+		offset = other.offset;
+		heap = other.heap;
+		allocation = other.allocation;
+		generation = other.generation;
+		other.ID = 0;
+		other.heap = NULL;
+	}
+	return *this;
+}
+
+EBO::~EBO()
+{
+	Delete();
+}
+
+// Tells if the heap moved the indices since the last call and updates ID and offset if it did
+bool EBO::Moved()
 {
-	glGenBuffers(1, &ID);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+	if (heap == NULL || generation == heap->generation)
+		return false;
+	ID = heap->Buffer(allocation);
+	offset = heap->Offset(allocation);
+	generation = heap->generation;
+	return true;
 }
 
 // Binds the EBO
 void EBO::Bind()
 {
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
+	StateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
 }
 
 // Unbinds the EBO
 void EBO::Unbind()
 {
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	StateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-// Deletes the EBO
+// Deletes the EBO (the destructor does this too, calling it earlier is fine)
 void EBO::Delete()
 {
-	glDeleteBuffers(1, &ID);
+	if (ID == 0)
+		return;
+	// The block is shared with other ranges, so only the range goes back
+	if (heap != NULL)
+		heap->Free(allocation);
+	else
+	{
+		StateCache::ForgetBuffer(ID);
+		glDeleteBuffers(1, &ID);
+	}
+	ID = 0;
+	heap = NULL;
+	alive--;
 }
\ No newline at end of file
@@ -4,20 +4,44 @@
 #include<glad/glad.h>
 #include<vector>
 
+#include"StateCache.h"
+#include"BufferHeap.h"
+
 class EBO
 {
 public:
-	// ID reference of Elements Buffer Object
-	GLuint ID;
-	// Constructor that generates a Elements Buffer Object and links it to indices
-	EBO(std::vector<GLuint>& indices);
+	// ID reference of Elements Buffer Object (0 for an empty EBO)
+	GLuint ID = 0;
+	// Number of EBOs that own a buffer or heap range that wasn't deleted yet (anything left at exit is a leak)
+	static unsigned int alive;
+	// Where the indices start in the buffer (only ever non zero when they live in a heap)
+	GLintptr offset = 0;
+	// Constructor that generates a Elements Buffer Object and fills it with indices (bind it while the VAO is bound),
+	// with a heap the indices get a range of one of its blocks instead of a buffer of their own
+	EBO(std::vector<GLuint>& indices, BufferHeap* heap = NULL);
+	// Makes an empty EBO that owns nothing, something can be moved into it later
+	EBO();
+	// A EBO owns its buffer (or heap range), so it can only be moved and gets deleted with the object
+	EBO(const EBO&) = delete;
+	EBO& operator=(const EBO&) = delete;
+	EBO(EBO&& other) noexcept;
+	EBO& operator=(EBO&& other) noexcept;
+	~EBO();
+
+	// Tells if the heap moved the indices since the last call and updates ID and offset if it did
+	bool Moved();
 
 	// Binds the EBO
 	void Bind();
 	// Unbinds the EBO
 	void Unbind();
-	// Deletes the EBO
+	// Deletes the EBO (the destructor does this too, calling it earlier is fine)
 	void Delete();
+
+private:
+	BufferHeap* heap = NULL;
+	unsigned int allocation = 0;
+	unsigned int generation = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include"FixedTimestep.h"
+
+#include<algorithm>
+
+FixedTimestep::FixedTimestep(double rate)
+{
+	step = 1.0 / rate;
+}
+
+// Adds the time since the last call and returns how many steps have to be simulated now
+unsigned int FixedTimestep::Advance(double time)
+{
+	// The first frame only starts the clock
+	if (lastTime < 0.0)
+		lastTime = time;
+	accumulator += std::max(time - lastTime, 0.0);
+	lastTime = time;
+
+	unsigned int steps = (unsigned int)(accumulator / step);
+	if (steps > maxSteps)
+	{
+		steps = maxSteps;
+		accumulator = 0.0;
+	}
+	else
+		accumulator -= steps * step;
+	count += steps;
+	return steps;
+}
+
+// How far into the next step the time is, between 0 and 1
+float FixedTimestep::Alpha()
+{
+	return (float)std::min(accumulator / step, 1.0);
+}
+
+// Steps taken since the last call, used for the title
+unsigned int FixedTimestep::TakeCount()
+{
+	unsigned int taken = count;
+	count = 0;
+	return taken;
+}
\ No newline at end of file
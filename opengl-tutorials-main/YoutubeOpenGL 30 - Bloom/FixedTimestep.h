@@ -0,0 +1,30 @@
+#ifndef FIXED_TIMESTEP_CLASS_H
+#define FIXED_TIMESTEP_CLASS_H
+
+// Turns the time that passed between frames into a whole number of fixed length steps, so whatever gets simulated
+// with them behaves the same at 30 FPS, at 144 FPS and without VSync. The time left over is handed out as how far
+// the next step already is (Alpha), which is what drawing uses to interpolate between the last two steps.
+class FixedTimestep
+{
+public:
+	// Length of a step in seconds
+	double step;
+	// Most steps a single frame can take, anything beyond that gets dropped so a long stall (like a breakpoint)
+	// can't make every following frame slower by trying to catch up
+	unsigned int maxSteps = 8;
+
+	FixedTimestep(double rate = 120.0);
+
+	// Adds the time since the last call and returns how many steps have to be simulated now
+	unsigned int Advance(double time);
+	// How far into the next step the time is, between 0 and 1
+	float Alpha();
+	// Steps taken since the last call, used for the title
+	unsigned int TakeCount();
+
+private:
+	double lastTime = -1.0;
+	double accumulator = 0.0;
+	unsigned int count = 0;
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include"Frustum.h"
+
+// Picks the widest instruction set the compiler was allowed to use
+#if defined(__AVX__)
+#include<immintrin.h>
+#define FRUSTUM_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<xmmintrin.h>
+#define FRUSTUM_WIDTH 4
+#else
+#define FRUSTUM_WIDTH 1
+#endif
+
+bool Frustum::enabled = true;
+
+// Grows the box so that it contains a point
+void AABB::Add(glm::vec3 point)
+{
+	min = glm::min(min, point);
+	max = glm::max(max, point);
+}
+
+bool AABB::Empty() const
+{
+	return min.x > max.x;
+}
+
+glm::vec3 AABB::Center() const
+{
+	return (min + max) * 0.5f;
+}
+
+// Half of the size of the box along every axis
+glm::vec3 AABB::Extents() const
+{
+	return (max - min) * 0.5f;
+}
+
+// Box around this box after it was moved, rotated and scaled by a matrix
+AABB AABB::Transform(const glm::mat4& matrix) const
+{
+	// The center moves with the matrix, the extents grow by how much each axis got rotated onto the others
+	glm::vec3 center = glm::vec3(matrix * glm::vec4(Center(), 1.0f));
+	glm::mat3 absolute = glm::mat3(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+	glm::vec3 extents = absolute * Extents();
+	AABB box;
+	box.min = center - extents;
+	box.max = center + extents;
+	return box;
+}
+
+// Moves a box to world space with a model matrix and adds it to the batch
+void BoxBatch::Add(const AABB& box, const glm::mat4& matrix)
+{
+	AABB world = box.Transform(matrix);
+	glm::vec3 center = world.Center();
+	glm::vec3 extents = world.Extents();
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	extentX.push_back(extents.x);
+	extentY.push_back(extents.y);
+	extentZ.push_back(extents.z);
+}
+
+// Removes every box
+void BoxBatch::Clear()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+}
+
+unsigned int BoxBatch::Size() const
+{
+	return (unsigned int)centerX.size();
+}
+
+// Makes a frustum that contains everything until Update is called
+Frustum::Frustum()
+{
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		absNormals[i] = glm::vec3(0.0f);
+	}
+}
+
+// Extracts the planes out of a camera matrix (projection * view)
+void Frustum::Update(const glm::mat4& cameraMatrix)
+{
+	// Gribb-Hartmann: every plane is the last row of the camera matrix plus or minus another row
+	glm::mat4 m = glm::transpose(cameraMatrix);
+	planes[0] = m[3] + m[0];
+	planes[1] = m[3] - m[0];
+	planes[2] = m[3] + m[1];
+	planes[3] = m[3] - m[1];
+	planes[4] = m[3] + m[2];
+	planes[5] = m[3] - m[2];
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+		absNormals[i] = glm::abs(glm::vec3(planes[i]));
+	}
+}
+
+// Tests the box with the given center and extents
+bool Frustum::test(glm::vec3 center, glm::vec3 extents) const
+{
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		// The box is outside once even its corner furthest along the normal is behind the plane
+		float distance = glm::dot(glm::vec3(planes[i]), center) + planes[i].w;
+		float radius = glm::dot(absNormals[i], extents);
+		if (distance + radius < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+// Tells if something is at least partly inside of the frustum
+bool Frustum::Test(const AABB& box) const
+{
+	return test(box.Center(), box.Extents());
+}
+
+bool Frustum::Test(const AABB& box, const glm::mat4& matrix) const
+{
+	return Test(box.Transform(matrix));
+}
+
+bool Frustum::Test(const BoundingSphere& sphere) const
+{
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		if (glm::dot(glm::vec3(planes[i]), sphere.center) + planes[i].w < -sphere.radius)
+			return false;
+	}
+	return true;
+}
+
+// Tests every box of a batch, visible gets a 1 for each box that is at least partly inside and a 0 for the others
+void Frustum::Test(const BoxBatch& boxes, std::vector<unsigned char>& visible) const
+{
+	unsigned int count = boxes.Size();
+	visible.resize(count);
+	unsigned int i = 0;
+
+#if FRUSTUM_WIDTH == 8
+	const __m256 zero = _mm256_setzero_ps();
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(&boxes.centerX[i]);
+		__m256 cy = _mm256_loadu_ps(&boxes.centerY[i]);
+		__m256 cz = _mm256_loadu_ps(&boxes.centerZ[i]);
+		__m256 ex = _mm256_loadu_ps(&boxes.extentX[i]);
+		__m256 ey = _mm256_loadu_ps(&boxes.extentY[i]);
+		__m256 ez = _mm256_loadu_ps(&boxes.extentZ[i]);
+		__m256 outside = zero;
+		for (unsigned int p = 0; p < 6; p++)
+		{
+			__m256 distance = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(planes[p].x)), _mm256_mul_ps(cy, _mm256_set1_ps(planes[p].y))),
+				_mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(planes[p].z)), _mm256_set1_ps(planes[p].w)));
+			__m256 radius = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(absNormals[p].x)), _mm256_mul_ps(ey, _mm256_set1_ps(absNormals[p].y))),
+				_mm256_mul_ps(ez, _mm256_set1_ps(absNormals[p].z)));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+		}
+		int mask = _mm256_movemask_ps(outside);
+		for (unsigned int lane = 0; lane < 8; lane++)
+			visible[i + lane] = ((mask >> lane) & 1) == 0;
+	}
+#elif FRUSTUM_WIDTH == 4
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+		__m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+		__m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+		__m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+		__m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+		__m128 outside = zero;
+		for (unsigned int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes[p].x)), _mm_mul_ps(cy, _mm_set1_ps(planes[p].y))),
+				_mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes[p].z)), _mm_set1_ps(planes[p].w)));
+			__m128 radius = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(absNormals[p].x)), _mm_mul_ps(ey, _mm_set1_ps(absNormals[p].y))),
+				_mm_mul_ps(ez, _mm_set1_ps(absNormals[p].z)));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+		}
+		int mask = _mm_movemask_ps(outside);
+		for (unsigned int lane = 0; lane < 4; lane++)
+			visible[i + lane] = ((mask >> lane) & 1) == 0;
+	}
+#endif
+
+	// Whatever doesn't fill a whole group gets tested one box at a time
+	for (; i < count; i++)
+	{
+		glm::vec3 center = glm::vec3(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+		glm::vec3 extents = glm::vec3(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+		visible[i] = test(center, extents);
+	}
+}
+
+// Number of boxes the batch test handles with one instruction (8 with AVX, 4 with SSE, 1 without either)
+unsigned int Frustum::Width()
+{
+	return FRUSTUM_WIDTH;
+}
\ No newline at end of file
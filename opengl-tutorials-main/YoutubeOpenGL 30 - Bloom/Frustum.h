@@ -0,0 +1,76 @@
+#ifndef FRUSTUM_CLASS_H
+#define FRUSTUM_CLASS_H
+
+#include<glm/glm.hpp>
+#include<vector>
+#include<cfloat>
+
+// Axis aligned box, empty (min above max) until a point gets added to it
+struct AABB
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	// Grows the box so that it contains a point
+	void Add(glm::vec3 point);
+	bool Empty() const;
+	glm::vec3 Center() const;
+	// Half of the size of the box along every axis
+	glm::vec3 Extents() const;
+	// Box around this box after it was moved, rotated and scaled by a matrix
+	AABB Transform(const glm::mat4& matrix) const;
+};
+
+// Sphere around the same things as an AABB, cheaper to test but looser for long thin meshes
+struct BoundingSphere
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+};
+
+// World space boxes stored as a structure of arrays so that the frustum can test several of them with one instruction
+class BoxBatch
+{
+public:
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+
+	// Moves a box to world space with a model matrix and adds it to the batch
+	void Add(const AABB& box, const glm::mat4& matrix);
+	// Removes every box
+	void Clear();
+	unsigned int Size() const;
+};
+
+// The six planes of the camera's view volume, used to skip everything the camera can't see
+class Frustum
+{
+public:
+	// Turn this off to draw everything, even what is outside of the frustum
+	static bool enabled;
+
+	// Planes as (normal, distance) with the normals pointing inside and normalized
+	glm::vec4 planes[6];
+
+	// Makes a frustum that contains everything until Update is called
+	Frustum();
+	// Extracts the planes out of a camera matrix (projection * view)
+	void Update(const glm::mat4& cameraMatrix);
+
+	// Tells if something is at least partly inside of the frustum
+	bool Test(const AABB& box) const;
+	bool Test(const AABB& box, const glm::mat4& matrix) const;
+	bool Test(const BoundingSphere& sphere) const;
+	// Tests every box of a batch, visible gets a 1 for each box that is at least partly inside and a 0 for the others
+	void Test(const BoxBatch& boxes, std::vector<unsigned char>& visible) const;
+
+	// Number of boxes the batch test handles with one instruction (8 with AVX, 4 with SSE, 1 without either)
+	static unsigned int Width();
+
+private:
+	// Absolute values of the plane normals, they turn the extents of a box into its radius along the normal
+	glm::vec3 absNormals[6];
+	// Tests the box with the given center and extents
+	bool test(glm::vec3 center, glm::vec3 extents) const;
+};
+#endif
\ No newline at end of file
@@ -4,7 +4,13 @@ namespace fs = std::filesystem;
 //------------------------------
 
 #include"Model.h"
-
+#include"ShaderReloader.h"
+#include"MeshPool.h"
+#include"OcclusionQueries.h"
+#include"Animator.h"
+#include"FixedTimestep.h"
+#include"ObjectPicker.h"
+#include"Benchmarks.h"
 
 const unsigned int width = 800;
 const unsigned int height = 800;
@@ -15,6 +21,24 @@ unsigned int samples = 8;
 // Controls the gamma function
 float gamma = 2.2f;
 
+// Extra planes scattered around to stress the render queue and multi draw path (set to 10000 for the 10k object benchmark)
+unsigned int benchmarkObjects = 0;
+// Put the vertices and indices of every mesh into a few shared buffers instead of two buffers per mesh
+bool useBufferHeap = true;
+// Draw every mesh with the one VAO of its vertex format and only switch the buffers between meshes (toggle with V)
+bool shareVAOs = true;
+// Skinned glTF file (relative to the Resources folder) to walk around the scene, nothing in Resources is animated so it is off
+const char* animatedModel = NULL;
+// Copies of the animated model, each one plays its clips at its own time
+unsigned int animatedCharacters = 16;
+// Turns VSync off so frames are drawn as fast as possible, the camera moves the same either way since it is simulated in fixed steps
+bool uncapped = false;
+// Steps per second the camera (and anything else that gets simulated) moves in
+double simulationRate = 120.0;
+// Moves the whole scene and the camera this far from the center of the world (like 1e6 for a scene a thousand kilometres out),
+// the camera relative drawing keeps it looking the same as at 0
+double worldOffset = 0.0;
+
 
 float rectangleVertices[] =
 {
@@ -44,6 +68,8 @@ std::vector<GLuint> indices =
 	0, 2, 3
 };
 
+void run_scene(GLFWwindow* window);
+
 int main()
 {
 	// Initialize GLFW
@@ -77,14 +103,41 @@ int main()
 	// In this case the viewport goes from x = 0, y = 0, to x = 800, y = 800
 	glViewport(0, 0, width, height);
 
+	// Every OpenGL object of the scene is owned by something inside of this, so they are all gone once it returns
+	run_scene(window);
+	// The buffers, textures and programs delete themselves, so anything still alive here was leaked
+	std::cout << "Still alive: " << VAO::alive << " VAOs, " << VBO::alive << " VBOs, " << EBO::alive << " EBOs, "
+		<< Texture::alive << " textures, " << Shader::alive << " shaders" << std::endl;
+
+	// Delete window before ending the program
+	glfwDestroyWindow(window);
+	// Terminate GLFW before ending the program
+	glfwTerminate();
+	return 0;
+}
+
+// Builds the scene and runs the main loop until the window gets closed
+void run_scene(GLFWwindow* window)
+{
+
 
 
 
 
-	// Generates shaders
+	// Generates shaders and measures how long it takes (SPIR-V gets used when the "shaders" target was built)
+	double shaderStart = glfwGetTime();
 	Shader shaderProgram("default.vert", "default.frag", "default.geom");
 	Shader framebufferProgram("framebuffer.vert", "framebuffer.frag");
 	Shader blurProgram("framebuffer.vert", "blur.frag");
+	// Multi draw indirect needs OpenGL 4.6, without it this is just another copy of the default shader
+	bool multiDrawSupported = MeshPool::Supported();
+	Shader multiDrawProgram(multiDrawSupported ? "multidraw.vert" : "default.vert", "default.frag", "default.geom");
+	// Same as the default shader but with the model matrix coming from an instanced attribute
+	Shader instancedProgram("instanced.vert", "default.frag", "default.geom");
+	// Same as the default shader but with the vertices moved by the joints of a skin
+	Shader skinnedProgram("skinned.vert", "default.frag", "default.geom");
+	glFinish();
+	std::cout << "Built shaders in " << (glfwGetTime() - shaderStart) * 1000.0 << "ms from " << (shaderProgram.spirv ? "SPIR-V" : "GLSL") << std::endl;
 
 	// Take care of all the light related things
 	glm::vec4 lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
@@ -93,6 +146,23 @@ int main()
 	shaderProgram.Activate();
 	glUniform4f(glGetUniformLocation(shaderProgram.ID, "lightColor"), lightColor.x, lightColor.y, lightColor.z, lightColor.w);
 	glUniform3f(glGetUniformLocation(shaderProgram.ID, "lightPos"), lightPos.x, lightPos.y, lightPos.z);
+	multiDrawProgram.Activate();
+	glUniform4f(glGetUniformLocation(multiDrawProgram.ID, "lightColor"), lightColor.x, lightColor.y, lightColor.z, lightColor.w);
+	glUniform3f(glGetUniformLocation(multiDrawProgram.ID, "lightPos"), lightPos.x, lightPos.y, lightPos.z);
+	glUniform1i(glGetUniformLocation(multiDrawProgram.ID, "normal0"), 1);
+	glUniform1i(glGetUniformLocation(multiDrawProgram.ID, "displacement0"), 2);
+	instancedProgram.Activate();
+	glUniform4f(glGetUniformLocation(instancedProgram.ID, "lightColor"), lightColor.x, lightColor.y, lightColor.z, lightColor.w);
+	glUniform3f(glGetUniformLocation(instancedProgram.ID, "lightPos"), lightPos.x, lightPos.y, lightPos.z);
+	glUniform1i(glGetUniformLocation(instancedProgram.ID, "normal0"), 1);
+	glUniform1i(glGetUniformLocation(instancedProgram.ID, "displacement0"), 2);
+	skinnedProgram.Activate();
+	glUniform4f(glGetUniformLocation(skinnedProgram.ID, "lightColor"), lightColor.x, lightColor.y, lightColor.z, lightColor.w);
+	glUniform3f(glGetUniformLocation(skinnedProgram.ID, "lightPos"), lightPos.x, lightPos.y, lightPos.z);
+	glUniform1i(glGetUniformLocation(skinnedProgram.ID, "normal0"), 1);
+	glUniform1i(glGetUniformLocation(skinnedProgram.ID, "displacement0"), 2);
+	// The joint palettes get bound to uniform buffer 0 right before each skinned mesh is drawn
+	glUniformBlockBinding(skinnedProgram.ID, glGetUniformBlockIndex(skinnedProgram.ID, "Joints"), 0);
 	framebufferProgram.Activate();
 	glUniform1i(glGetUniformLocation(framebufferProgram.ID, "screenTexture"), 0);
 	glUniform1i(glGetUniformLocation(framebufferProgram.ID, "bloomTexture"), 1);
@@ -100,6 +170,15 @@ int main()
 	blurProgram.Activate();
 	glUniform1i(glGetUniformLocation(blurProgram.ID, "screenTexture"), 0);
 
+	// Rebuilds the shaders in the background whenever one of their files gets saved
+	ShaderReloader shaderReloader(window);
+	shaderReloader.Watch(shaderProgram);
+	shaderReloader.Watch(framebufferProgram);
+	shaderReloader.Watch(blurProgram);
+	shaderReloader.Watch(multiDrawProgram);
+	shaderReloader.Watch(instancedProgram);
+	shaderReloader.Watch(skinnedProgram);
+
 
 	
 
@@ -119,6 +198,7 @@ int main()
 
 	// Creates camera object
 	Camera camera(width, height, glm::vec3(0.0f, 0.0f, 2.0f));
+	camera.Origin = glm::dvec3(worldOffset, 0.0, 0.0);
 
 
 	/*
@@ -150,8 +230,27 @@ int main()
 	// Keeps track of the amount of frames in timeDiff
 	unsigned int counter = 0;
 
-	// Use this to disable VSync (not advized)
-	//glfwSwapInterval(0);
+	// Remembers if C was held last frame so holding it only toggles the state cache once
+	bool cacheKeyDown = false;
+	// Draw the scene with multi draw indirect instead of the render queue (toggle with M)
+	bool useMultiDraw = false;
+	bool multiDrawKeyDown = false;
+	bool instancingKeyDown = false;
+	bool vaoKeyDown = false;
+	bool cullingKeyDown = false;
+	bool occlusionKeyDown = false;
+	// Draw the benchmark objects with occlusion queries and conditional rendering instead of the render queue (toggle with Q)
+	bool useOcclusionQueries = false;
+	bool queriesKeyDown = false;
+	bool pickButtonDown = false;
+	// Last thing the right mouse button picked
+	ObjectPicker::Result pick;
+	bool picked = false;
+
+	// Simulates the camera in steps of the same length however fast the frames come
+	FixedTimestep simulation(simulationRate);
+	if (uncapped)
+		glfwSwapInterval(0);
 
 
 	// Create Frame Buffer Object
@@ -181,9 +280,12 @@ int main()
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, bloomTexture, 0);
 
-	// Tell OpenGL we need to draw to both attachments
-	unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-	glDrawBuffers(2, attachments);
+	// Third attachment with the object and triangle of every pixel for picking with the right mouse button
+	ObjectPicker picker(width, height, 2);
+
+	// Tell OpenGL we need to draw to all three attachments
+	unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+	glDrawBuffers(3, attachments);
 
 	// Error checking framebuffer
 	auto fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
@@ -219,22 +321,132 @@ int main()
 	std::string normalPath = "/Resources/YoutubeOpenGL 30 - Bloom/textures/normal.png";
 	std::string displacementPath = "/Resources/YoutubeOpenGL 30 - Bloom/textures/displacement.png";
 
-	std::vector<Texture> textures =
+	std::vector<std::shared_ptr<Texture>> textures =
 	{
-		Texture((parentDir + diffusePath).c_str(), "diffuse", 0)
+		std::make_shared<Texture>((parentDir + diffusePath).c_str(), "diffuse", 0)
 	};
 
-	// Plane with the texture
+	// Shared buffers for the geometry of every mesh made from here on
+	BufferHeap bufferHeap;
+	if (useBufferHeap)
+		Mesh::heap = &bufferHeap;
+	// One VAO per vertex format for every mesh made from here on
+	VAOCache vaoCache;
+	shareVAOs = shareVAOs && VAOCache::Supported();
+	if (shareVAOs)
+		Mesh::vaoCache = &vaoCache;
+
+	// Plane with the texture, placed in the world in double precision and drawn relative to the origin of the camera
 	Mesh plane(vertices, indices, textures);
+	glm::dmat4 planeWorld = glm::translate(glm::dmat4(1.0), glm::dvec3(worldOffset, 0.0, 0.0));
+	glm::mat4 planeMatrix = camera.Relative(planeWorld);
+	glm::dvec3 lightWorld = glm::dvec3(worldOffset, 0.0, 0.0) + glm::dvec3(lightPos);
 	// Normal map for the plane
 	Texture normalMap((parentDir + normalPath).c_str(), "normal", 1);
 	Texture displacementMap((parentDir + displacementPath).c_str(), "displacement", 2);
 
+	// Sorts the draws of every frame by program, material, mesh and depth
+	RenderQueue renderQueue;
+	// Repeated draws of a mesh with the default shader get merged into instanced draws (toggle with I)
+	renderQueue.SetInstancedShader(shaderProgram, instancedProgram);
+	// A few different meshes and materials for the benchmark so the queue actually has something to sort
+	std::vector<std::shared_ptr<Texture>> benchmarkTextures =
+	{
+		std::make_shared<Texture>((parentDir + diffusePath).c_str(), "diffuse", 0)
+	};
+	std::vector<Mesh> benchmarkMeshes;
+	for (unsigned int i = 0; i < 8 && benchmarkObjects > 0; i++)
+		benchmarkMeshes.emplace_back(vertices, indices, i % 2 == 0 ? textures : benchmarkTextures);
+	// Random placement and mesh for every benchmark object, submitted in this unsorted order
+	// (the world matrices are the real placement, the float ones are relative to the origin and get remade when it moves)
+	std::vector<glm::dmat4> benchmarkWorlds;
+	std::vector<glm::mat4> benchmarkMatrices;
+	std::vector<unsigned int> benchmarkMeshIndices;
+	for (unsigned int i = 0; i < benchmarkObjects; i++)
+	{
+		glm::vec3 position = glm::vec3(rand() % 100 - 50, rand() % 100 - 50, -(float)(rand() % 100));
+		benchmarkWorlds.push_back(glm::translate(glm::dmat4(1.0), glm::dvec3(worldOffset, 0.0, 0.0) + glm::dvec3(position)));
+		benchmarkMatrices.push_back(camera.Relative(benchmarkWorlds.back()));
+		benchmarkMeshIndices.push_back(rand() % 8);
+	}
+	// The benchmark objects never move, so one build is enough and every frame only has to walk the tree
+	BVH sceneBVH;
+	for (unsigned int i = 0; i < benchmarkObjects; i++)
+		sceneBVH.Insert(benchmarkMeshes[benchmarkMeshIndices[i]].bounds.Transform(benchmarkMatrices[i]));
+	sceneBVH.Build();
+	// Benchmark objects the BVH found inside of the frustum this frame
+	std::vector<unsigned int> visibleObjects;
+	// The plane hides the benchmark objects behind it, the render queue drops them before sorting (toggle with O)
+	OcclusionBuffer occlusionBuffer;
+	OcclusionBuffer::Occluder planeOccluder = plane.GetOccluder();
+
+	// The same scene packed into shared buffers for the multi draw path, only on contexts that can draw it since adding
+	// reads every mesh back from the GPU and the copies are only freed again by Upload
+	MeshPool meshPool;
+	unsigned int planeHandle = 0;
+	std::vector<unsigned int> benchmarkHandles;
+	if (multiDrawSupported)
+	{
+		planeHandle = meshPool.Add(plane);
+		for (unsigned int i = 0; i < benchmarkMeshes.size(); i++)
+			benchmarkHandles.push_back(meshPool.Add(benchmarkMeshes[i]));
+		meshPool.Upload();
+	}
+
+	// Compare the buffer objects the meshes ended up in to the two per mesh they would need without the heap
+	if (useBufferHeap)
+	{
+		BufferHeap::Stats heapStats = bufferHeap.GetStats();
+		std::cout << "Buffer heap: " << heapStats.allocations << " ranges in " << heapStats.bufferObjects << " buffer objects (instead of "
+			<< heapStats.allocations << "), " << heapStats.requested / 1024.0 << "KB used, " << heapStats.allocated / 1024.0 << "KB allocated, "
+			<< heapStats.reserved / 1024.0 << "KB reserved, " << heapStats.allocateMs * 1000.0 / std::max(heapStats.allocateCalls, 1u) << "us per allocation" << std::endl;
+	}
 
 
+
+	// Everything above talked to OpenGL directly, so the cache can't trust what it knows
+	StateCache::Invalidate();
+
+	// Expensive meshes can skip their fragments while their box was hidden last frame
+	OcclusionQueries occlusionQueries;
+
+	// Prints what the engine features cost before the main loop starts (turn them on in Benchmarks.h)
+	Benchmarks benchmarks;
+	benchmarks.Run(postProcessingFBO, renderQueue, plane, vertices, indices, shaderProgram, camera, picker, occlusionQueries, parentDir + "/Resources/");
+
+	// Only hand the buffer over now, the benchmarks above never rasterize into it
+	renderQueue.occlusion = &occlusionBuffer;
+
+	// Characters that play the animations of the animated model, spread out in a row and out of step with each other
+	Animator animator;
+	std::unique_ptr<Model> animatedScene;
+	std::vector<glm::dmat4> characterWorlds;
+	if (animatedModel != NULL)
+	{
+		animatedScene = std::make_unique<Model>((parentDir + "/Resources/" + animatedModel).c_str());
+		for (unsigned int i = 0; i < animatedCharacters && !animatedScene->Animations().empty(); i++)
+		{
+			characterWorlds.push_back(glm::translate(glm::dmat4(1.0), glm::dvec3(worldOffset + 2.0 * i, 0.0, -3.0)));
+			unsigned int character = animator.Add(*animatedScene, camera.Relative(characterWorlds.back()));
+			animator.characters[character].time = 0.37f * i;
+			animator.characters[character].objectID = benchmarkObjects + 2 + i;
+		}
+	}
+	double animationTime = glfwGetTime();
+
 	// Main while loop
 	while (!glfwWindowShouldClose(window))
 	{
+		// Swap in any shaders that were rebuilt since the last frame
+		shaderReloader.Update();
+		// Collect the picks the GPU finished since the last frame
+		while (picker.Poll(pick))
+		{
+			picked = true;
+			std::cout << "Picked object " << pick.object << ", triangle " << pick.primitive << " at " << pick.x << ", " << pick.y
+				<< " (" << pick.frames << " frames / " << pick.latencyMs << "ms later)" << std::endl;
+		}
+
 		// Updates counter and times
 		crntTime = glfwGetTime();
 		timeDiff = crntTime - prevTime;
@@ -245,31 +457,170 @@ int main()
 			// Creates new title
 			std::string FPS = std::to_string((1.0 / timeDiff) * counter);
 			std::string ms = std::to_string((timeDiff / counter) * 1000);
-			std::string newTitle = "YoutubeOpenGL - " + FPS + "FPS / " + ms + "ms";
+			std::string newTitle = "YoutubeOpenGL - " + FPS + "FPS / " + ms + "ms / " + std::to_string((unsigned int)(simulation.TakeCount() / timeDiff + 0.5)) + " steps/s";
+#ifdef STATE_CACHE_STATS
+			// Shows how many state changes reached the driver last frame and how many were skipped
+			StateCache::Stats stats = StateCache::LastFrame();
+			newTitle += " / " + std::to_string(stats.issued) + " GL calls (" + std::to_string(stats.elided) + " skipped, "
+				+ std::to_string(stats.vertexArrays) + " VAO switches)";
+#endif
+			if (useMultiDraw)
+			{
+				// Shows how many multi draw calls the draws were packed into and how long it took on the CPU
+				MeshPool::Stats poolStats = meshPool.LastStats();
+				newTitle += " / " + std::to_string(poolStats.draws) + " draws in " + std::to_string(poolStats.multiDraws) + " multi draws, "
+					+ std::to_string(poolStats.submitMs) + "ms submit, " + std::to_string(poolStats.culled) + " culled";
+			}
+			else
+			{
+				// Shows how much switching the render queue had to do and how long it took on the CPU
+				RenderQueue::Stats queueStats = renderQueue.LastStats();
+				newTitle += " / " + std::to_string(queueStats.submitted) + " submitted, " + std::to_string(queueStats.draws) + " draws ("
+					+ std::to_string(queueStats.instancedDraws) + " instanced), " + std::to_string(queueStats.programChanges) + " programs, "
+					+ std::to_string(queueStats.materialChanges) + " materials, " + std::to_string(queueStats.meshChanges) + " meshes, "
+					+ std::to_string(queueStats.sortMs) + "ms sort, " + std::to_string(queueStats.submitMs) + "ms submit, "
+					+ std::to_string(queueStats.culled) + " culled, " + std::to_string(queueStats.occluded) + " occluded in "
+					+ std::to_string(queueStats.cullMs) + "ms (+" + std::to_string(occlusionBuffer.GetStats().rasterMs) + "ms raster)";
+				if (useOcclusionQueries)
+				{
+					// Shows how many draws were conditional and what they cost the GPU
+					OcclusionQueries::Stats queryStats = occlusionQueries.LastStats();
+					newTitle += " / " + std::to_string(queryStats.draws) + " conditional draws in " + std::to_string(queryStats.gpuMs) + "ms GPU";
+				}
+			}
+			if (picked)
+			{
+				// Shows what is under the last pick (0 is the background, 1 the plane, then the benchmark objects and the characters)
+				newTitle += " / picked " + std::to_string(pick.object) + ":" + std::to_string(pick.primitive) + " after "
+					+ std::to_string(pick.frames) + " frames";
+			}
+			if (!animator.characters.empty())
+			{
+				// Shows what animating the characters cost on the CPU and what uploading their palettes took
+				Animator::Stats animationStats = animator.GetStats();
+				newTitle += " / " + std::to_string(animationStats.characters) + " characters, " + std::to_string(animationStats.joints) + " joints in "
+					+ std::to_string(animationStats.updateMs) + "ms (+" + std::to_string(animationStats.uploadMs) + "ms upload)";
+			}
 			glfwSetWindowTitle(window, newTitle.c_str());
 
 			// Resets times and counter
 			prevTime = crntTime;
 			counter = 0;
 
-			// Use this if you have disabled VSync
-			//camera.Inputs(window);
+			// Every now and then pack the heap again if freeing left its free space scattered
+			if (bufferHeap.Fragmentation() > 0.5f)
+				bufferHeap.Compact();
 		}
 
 
+		// Toggles the state cache with C to compare frame times with and without it
+		bool cacheKey = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+		if (cacheKey && !cacheKeyDown)
+		{
+			StateCache::enabled = !StateCache::enabled;
+			std::cout << "State cache " << (StateCache::enabled ? "on" : "off") << std::endl;
+		}
+		cacheKeyDown = cacheKey;
+		// Switches between multi draw indirect and the render queue with M
+		bool multiDrawKey = glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS;
+		if (multiDrawKey && !multiDrawKeyDown && multiDrawSupported)
+		{
+			useMultiDraw = !useMultiDraw;
+			std::cout << (useMultiDraw ? "Multi draw indirect" : "Render queue") << std::endl;
+		}
+		multiDrawKeyDown = multiDrawKey;
+		// Toggles merging repeated draws into instanced draws with I
+		bool instancingKey = glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS;
+		if (instancingKey && !instancingKeyDown)
+		{
+			renderQueue.instancing = !renderQueue.instancing;
+			std::cout << "Automatic instancing " << (renderQueue.instancing ? "on" : "off") << std::endl;
+		}
+		instancingKeyDown = instancingKey;
+		// Switches between one VAO per vertex format and one VAO per mesh with V
+		bool vaoKey = glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS;
+		if (vaoKey && !vaoKeyDown && VAOCache::Supported())
+		{
+			shareVAOs = !shareVAOs;
+			Mesh::vaoCache = shareVAOs ? &vaoCache : NULL;
+			std::cout << "Shared VAOs " << (shareVAOs ? "on" : "off") << std::endl;
+		}
+		vaoKeyDown = vaoKey;
+		// Toggles frustum culling with F
+		bool cullingKey = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+		if (cullingKey && !cullingKeyDown)
+		{
+			Frustum::enabled = !Frustum::enabled;
+			std::cout << "Frustum culling " << (Frustum::enabled ? "on" : "off") << std::endl;
+		}
+		cullingKeyDown = cullingKey;
+		// Toggles occlusion culling with O
+		bool occlusionKey = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+		if (occlusionKey && !occlusionKeyDown)
+		{
+			OcclusionBuffer::enabled = !OcclusionBuffer::enabled;
+			std::cout << "Occlusion culling " << (OcclusionBuffer::enabled ? "on" : "off") << std::endl;
+		}
+		occlusionKeyDown = occlusionKey;
+		// Switches the benchmark objects between the render queue and occlusion queries with Q
+		bool queriesKey = glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS;
+		if (queriesKey && !queriesKeyDown && OcclusionQueries::Supported())
+		{
+			useOcclusionQueries = !useOcclusionQueries;
+			std::cout << "Occlusion queries " << (useOcclusionQueries ? "on" : "off") << std::endl;
+		}
+		queriesKeyDown = queriesKey;
+
 		// Bind the custom framebuffer
-		glBindFramebuffer(GL_FRAMEBUFFER, postProcessingFBO);
+		StateCache::BindFramebuffer(GL_FRAMEBUFFER, postProcessingFBO);
 		// Specify the color of the background
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		// Clean the back buffer and depth buffer
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// The ID attachment needs a clear of its own
+		picker.Clear();
 		// Enable depth testing since it's disabled when drawing the framebuffer rectangle
-		glEnable(GL_DEPTH_TEST);
+		StateCache::Enable(GL_DEPTH_TEST);
 
-		// Handles camera inputs (delete this if you have disabled VSync)
+		// Handles camera inputs, then moves the camera by as many fixed steps as fit into the time that passed
 		camera.Inputs(window);
-		// Updates and exports the camera matrix to the Vertex Shader
-		camera.updateMatrix(45.0f, 0.1f, 100.0f);
+		unsigned int steps = simulation.Advance(glfwGetTime());
+		for (unsigned int i = 0; i < steps; i++)
+			camera.Step((float)simulation.step);
+		// Once the camera got far from the origin the origin moves to it and everything gets placed around it again
+		// from the world matrices, so the floats the GPU sees always stay small
+		if (camera.Rebase())
+		{
+			double rebaseStart = glfwGetTime();
+			planeMatrix = camera.Relative(planeWorld);
+			for (unsigned int i = 0; i < benchmarkObjects; i++)
+			{
+				benchmarkMatrices[i] = camera.Relative(benchmarkWorlds[i]);
+				sceneBVH.Update(i, benchmarkMeshes[benchmarkMeshIndices[i]].bounds.Transform(benchmarkMatrices[i]));
+			}
+			sceneBVH.Refit();
+			for (unsigned int i = 0; i < characterWorlds.size(); i++)
+				animator.characters[i].matrix = camera.Relative(characterWorlds[i]);
+			glm::vec3 light = camera.Relative(lightWorld);
+			Shader* litShaders[] = { &shaderProgram, &multiDrawProgram, &instancedProgram, &skinnedProgram };
+			for (Shader* program : litShaders)
+			{
+				program->Activate();
+				glUniform3f(glGetUniformLocation(program->ID, "lightPos"), light.x, light.y, light.z);
+			}
+			std::cout << "Moved the origin to " << camera.Origin.x << ", " << camera.Origin.y << ", " << camera.Origin.z << " in "
+				<< (glfwGetTime() - rebaseStart) * 1000.0 << "ms" << std::endl;
+		}
+		// Updates and exports the camera matrix to the Vertex Shader, placed between the last two steps
+		camera.updateMatrix(45.0f, 0.1f, 100.0f, simulation.Alpha());
+
+		// Let the BVH throw out whole groups of benchmark objects before anything gets submitted
+		visibleObjects.clear();
+		if (Frustum::enabled)
+			sceneBVH.Query(camera.frustum, visibleObjects);
+		else
+			for (unsigned int i = 0; i < benchmarkObjects; i++)
+				visibleObjects.push_back(i);
 
 
 		shaderProgram.Activate();
@@ -278,8 +629,66 @@ int main()
 		displacementMap.Bind();
 		glUniform1i(glGetUniformLocation(shaderProgram.ID, "displacement0"), 2);
 
-		// Draw the normal model
-		plane.Draw(shaderProgram, camera);
+		if (useMultiDraw)
+		{
+			// Draw the normal model (and the benchmark objects) with one call per material
+			meshPool.Begin();
+			meshPool.Submit(planeHandle, planeMatrix);
+			for (unsigned int object : visibleObjects)
+				meshPool.Submit(benchmarkHandles[benchmarkMeshIndices[object]], benchmarkMatrices[object]);
+			meshPool.Execute(multiDrawProgram, camera);
+		}
+		else
+		{
+			// The plane is the only occluder, rasterizing it every frame keeps the buffer in step with the camera
+			if (OcclusionBuffer::enabled)
+			{
+				occlusionBuffer.Begin(camera.cameraMatrix);
+				occlusionBuffer.Add(planeOccluder, planeMatrix);
+				occlusionBuffer.Rasterize();
+			}
+			// Draw the normal model (and the benchmark objects) through the render queue
+			renderQueue.Begin(camera);
+			renderQueue.Submit(plane, shaderProgram, planeMatrix, false, 0, 1);
+			for (unsigned int object : visibleObjects)
+			{
+				if (!useOcclusionQueries)
+					renderQueue.Submit(benchmarkMeshes[benchmarkMeshIndices[object]], shaderProgram, benchmarkMatrices[object], false, 0, object + 2);
+			}
+			renderQueue.Execute();
+
+			// The render queue drew the occluders, now the benchmark objects only get drawn where their boxes were visible
+			if (useOcclusionQueries)
+			{
+				// These draws don't set an ID, so they can't be picked
+				shaderProgram.Activate();
+				glUniform1ui(glGetUniformLocation(shaderProgram.ID, "objectID"), 0);
+				occlusionQueries.Begin(camera);
+				for (unsigned int object : visibleObjects)
+					occlusionQueries.Draw(object, benchmarkMeshes[benchmarkMeshIndices[object]], shaderProgram, benchmarkMatrices[object]);
+				occlusionQueries.End();
+			}
+		}
+
+		// Animate the characters by the time that really passed, the palettes are ready before anything gets drawn with them
+		double now = glfwGetTime();
+		if (!animator.characters.empty())
+		{
+			animator.Update((float)(now - animationTime));
+			animator.Upload();
+			animator.Draw(shaderProgram, skinnedProgram, camera);
+		}
+		animationTime = now;
+
+		// Copy the pixel under the cursor while the scene is still bound, it comes back in one of the next frames
+		bool pickButton = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+		if (pickButton && !pickButtonDown)
+		{
+			double cursorX, cursorY;
+			glfwGetCursorPos(window, &cursorX, &cursorY);
+			picker.Request(cursorX, cursorY);
+		}
+		pickButtonDown = pickButton;
 
 		// Bounce the image data around to blur multiple times
 		bool horizontal = true, first_iteration = true;
@@ -288,24 +697,24 @@ int main()
 		blurProgram.Activate();
 		for (unsigned int i = 0; i < amount; i++)
 		{
-			glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
+			StateCache::BindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
 			glUniform1i(glGetUniformLocation(blurProgram.ID, "horizontal"), horizontal);
 
 			// In the first bounc we want to get the data from the bloomTexture
 			if (first_iteration)
 			{
-				glBindTexture(GL_TEXTURE_2D, bloomTexture);
+				StateCache::BindTexture(0, bloomTexture);
 				first_iteration = false;
 			}
 			// Move the data between the pingPong textures
 			else
 			{
-				glBindTexture(GL_TEXTURE_2D, pingpongBuffer[!horizontal]);
+				StateCache::BindTexture(0, pingpongBuffer[!horizontal]);
 			}
 
-			// Render the image
-			glBindVertexArray(rectVAO);
-			glDisable(GL_DEPTH_TEST);
+			// Render the image (the cache skips rebinding the VAO and disabling depth after the first bounce)
+			StateCache::BindVertexArray(rectVAO);
+			StateCache::Disable(GL_DEPTH_TEST);
 			glDrawArrays(GL_TRIANGLES, 0, 6);
 
 			// Switch between vertical and horizontal blurring
@@ -314,20 +723,21 @@ int main()
 
 
 		// Bind the default framebuffer
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		StateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
 		// Draw the framebuffer rectangle
 		framebufferProgram.Activate();
-		glBindVertexArray(rectVAO);
-		glDisable(GL_DEPTH_TEST); // prevents framebuffer rectangle from being discarded
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, postProcessingTexture);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, pingpongBuffer[!horizontal]);
+		StateCache::BindVertexArray(rectVAO);
+		StateCache::Disable(GL_DEPTH_TEST); // prevents framebuffer rectangle from being discarded
+		StateCache::BindTexture(0, postProcessingTexture);
+		StateCache::BindTexture(1, pingpongBuffer[!horizontal]);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 
 
 		// Swap the back buffer with the front buffer
 		glfwSwapBuffers(window);
+		StateCache::EndFrame();
+		bufferHeap.EndFrame();
+		picker.EndFrame();
 		// Take care of all GLFW events
 		glfwPollEvents();
 	}
@@ -335,11 +745,14 @@ int main()
 
 
 	// Delete all the objects we've created
-	shaderProgram.Delete();
+	shaderReloader.Delete();
+	meshPool.Delete();
+	renderQueue.Delete();
+	occlusionQueries.Delete();
+	animator.Delete();
+	picker.Delete();
 	glDeleteFramebuffers(1, &postProcessingFBO);
-	// Delete window before ending the program
-	glfwDestroyWindow(window);
-	// Terminate GLFW before ending the program
-	glfwTerminate();
-	return 0;
+	// The meshes give their ranges back to the heap as they go out of scope, so it must not point at it anymore
+	Mesh::heap = NULL;
+	Mesh::vaoCache = NULL;
 }
\ No newline at end of file
@@ -1,25 +1,193 @@
 #include "Mesh.h"
 
-Mesh::Mesh(std::vector <Vertex>& vertices, std::vector <GLuint>& indices, std::vector <Texture>& textures)
+#include<algorithm>
+
+BufferHeap* Mesh::heap = NULL;
+VAOCache* Mesh::vaoCache = NULL;
+unsigned long long Mesh::nextSerial = 0;
+
+Mesh::Mesh(std::vector <Vertex>& vertices, std::vector <GLuint>& indices, std::vector <std::shared_ptr<Texture>>& textures, bool cpuAccess, const AABB* bounds) :
+	// Meshes that share the VAO of their format don't need one of their own
+	VAO(vaoCache != NULL ? ::VAO(0) : ::VAO()),
+	// Generates Vertex Buffer Object and Element Buffer Object and fills them with the vertices and indices
+	vertexBuffer(vertices, heap),
+	indexBuffer(indices, heap),
+	serial(nextSerial++)
 {
-	Mesh::vertices = vertices;
-	Mesh::indices = indices;
 	Mesh::textures = textures;
+	Mesh::vertexCount = (GLsizei)vertices.size();
+	Mesh::indexCount = (GLsizei)indices.size();
+	Mesh::cpuAccess = cpuAccess;
+	// Once uploaded the GPU has everything it needs, so only meshes that are read on the CPU keep a copy
+	if (cpuAccess)
+	{
+		Mesh::vertices = vertices;
+		Mesh::indices = indices;
+	}
 
-	VAO.Bind();
-	// Generates Vertex Buffer Object and links it to vertices
-	VBO VBO(vertices);
-	// Generates Element Buffer Object and links it to indices
-	EBO EBO(indices);
-	// Links VBO attributes such as coordinates and colors to VAO
-	VAO.LinkAttrib(VBO, 0, 3, GL_FLOAT, sizeof(Vertex), (void*)0);
-	VAO.LinkAttrib(VBO, 1, 3, GL_FLOAT, sizeof(Vertex), (void*)(3 * sizeof(float)));
-	VAO.LinkAttrib(VBO, 2, 3, GL_FLOAT, sizeof(Vertex), (void*)(6 * sizeof(float)));
-	VAO.LinkAttrib(VBO, 3, 2, GL_FLOAT, sizeof(Vertex), (void*)(9 * sizeof(float)));
-	// Unbind all to prevent accidentally modifying them
+	if (bounds != NULL)
+	{
+		// The corners are all that is known, so the sphere goes around the box
+		Mesh::bounds = *bounds;
+		sphere.center = Mesh::bounds.Center();
+		sphere.radius = glm::length(Mesh::bounds.Extents());
+	}
+	else
+	{
+		for (unsigned int i = 0; i < vertices.size(); i++)
+			Mesh::bounds.Add(vertices[i].position);
+		sphere.center = Mesh::bounds.Center();
+		for (unsigned int i = 0; i < vertices.size(); i++)
+			sphere.radius = std::max(sphere.radius, glm::length(vertices[i].position - sphere.center));
+	}
+
+	if (VAO.ID != 0)
+	{
+		linkAttributes();
+		// Unbind all to prevent accidentally modifying them
+		VAO.Unbind();
+		vertexBuffer.Unbind();
+	}
+}
+
+// Returns the vertices, reading them back from the GPU when the CPU copy was released
+std::vector <Vertex> Mesh::GetVertices()
+{
+	if (!vertices.empty() || vertexCount == 0)
+		return vertices;
+	// Asking uses up the move, so remember it for Bind
+	relink = vertexBuffer.Moved() || relink;
+	std::vector <Vertex> copy(vertexCount);
+	StateCache::BindBuffer(GL_COPY_READ_BUFFER, vertexBuffer.ID);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, vertexBuffer.offset, vertexCount * sizeof(Vertex), copy.data());
+	return copy;
+}
+
+// Returns the indices, reading them back from the GPU when the CPU copy was released
+std::vector <GLuint> Mesh::GetIndices()
+{
+	if (!indices.empty() || indexCount == 0)
+		return indices;
+	relink = indexBuffer.Moved() || relink;
+	std::vector <GLuint> copy(indexCount);
+	StateCache::BindBuffer(GL_COPY_READ_BUFFER, indexBuffer.ID);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, indexBuffer.offset, indexCount * sizeof(GLuint), copy.data());
+	return copy;
+}
+
+// Positions and indices of the mesh for rasterizing it into an occlusion buffer (make it once, it may read back from the GPU)
+OcclusionBuffer::Occluder Mesh::GetOccluder()
+{
+	OcclusionBuffer::Occluder occluder;
+	std::vector <Vertex> meshVertices = GetVertices();
+	for (unsigned int i = 0; i < meshVertices.size(); i++)
+		occluder.positions.push_back(meshVertices[i].position);
+	occluder.indices = GetIndices();
+	return occluder;
+}
+
+// Gives every vertex the joints that move it and their weights
+void Mesh::SetSkin(std::vector <SkinVertex>& skin)
+{
+	skinBuffer = VBO(skin, heap);
+	// The shared VAOs only know the layout of Vertex, so skinned meshes always get one of their own
+	if (VAO.ID == 0)
+		VAO = ::VAO();
+	linkAttributes();
 	VAO.Unbind();
-	VBO.Unbind();
-	EBO.Unbind();
+	skinBuffer.Unbind();
+}
+
+// Tells if the mesh has joints and weights and so has to be drawn with a skinning shader
+bool Mesh::Skinned()
+{
+	return skinBuffer.ID != 0;
+}
+
+// Drops the CPU copies of the vertices and indices, the GPU keeps its own
+void Mesh::ReleaseCPUCopy()
+{
+	// Swapping with an empty vector is the only way to be sure the memory is given back
+	std::vector <Vertex>().swap(vertices);
+	std::vector <GLuint>().swap(indices);
+	cpuAccess = false;
+}
+
+// Bytes of geometry held on the CPU
+size_t Mesh::CPUBytes()
+{
+	return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(GLuint);
+}
+
+// Bytes of geometry stored on the GPU
+size_t Mesh::GPUBytes()
+{
+	return vertexCount * sizeof(Vertex) + indexCount * sizeof(GLuint) + (Skinned() ? vertexCount * sizeof(SkinVertex) : 0);
+}
+
+// Binds the VAO, pointing it at the new place of the vertices and indices first if the heap moved them
+void Mesh::Bind()
+{
+	// Every buffer has to be asked so every one updates its offset
+	bool moved = relink;
+	relink = false;
+	moved = vertexBuffer.Moved() || moved;
+	moved = indexBuffer.Moved() || moved;
+	moved = skinBuffer.Moved() || moved;
+	// The shared VAO gets pointed at the buffers on every bind, so there is nothing to link again
+	if (vaoCache != NULL && !Skinned())
+	{
+		vaoCache->Bind(Format(), vertexBuffer, indexBuffer);
+		return;
+	}
+	// Meshes made while the VAOs were shared only get one of their own once they need it
+	if (VAO.ID == 0)
+	{
+		VAO = ::VAO();
+		moved = true;
+	}
+	if (moved)
+		linkAttributes();
+	VAO.Bind();
+}
+
+// Layout of Vertex, which is the format of every mesh
+const VertexFormat& Mesh::Format()
+{
+	static const VertexFormat format =
+	{
+		{
+			{ 0, 3, GL_FLOAT, 0 },
+			{ 1, 3, GL_FLOAT, 3 * sizeof(float) },
+			{ 2, 3, GL_FLOAT, 6 * sizeof(float) },
+			{ 3, 2, GL_FLOAT, 9 * sizeof(float) }
+		},
+		sizeof(Vertex)
+	};
+	return format;
+}
+
+// Links the vertex attributes and the indices to the VAO
+void Mesh::linkAttributes()
+{
+	// Direct State Access edits the VAO by name, the old way edits whatever is bound
+	if (!StateCache::DSA())
+		VAO.Bind();
+	// Links VBO attributes such as coordinates and colors to VAO, the offset is where the heap put the vertices
+	GLintptr offset = vertexBuffer.offset;
+	VAO.LinkAttrib(vertexBuffer, 0, 3, GL_FLOAT, sizeof(Vertex), (void*)offset);
+	VAO.LinkAttrib(vertexBuffer, 1, 3, GL_FLOAT, sizeof(Vertex), (void*)(offset + 3 * sizeof(float)));
+	VAO.LinkAttrib(vertexBuffer, 2, 3, GL_FLOAT, sizeof(Vertex), (void*)(offset + 6 * sizeof(float)));
+	VAO.LinkAttrib(vertexBuffer, 3, 2, GL_FLOAT, sizeof(Vertex), (void*)(offset + 9 * sizeof(float)));
+	// Joints and weights come from a buffer of their own (the locations in between are taken by the instance matrices)
+	if (Skinned())
+	{
+		GLintptr skinOffset = skinBuffer.offset;
+		VAO.LinkAttrib(skinBuffer, 8, 4, GL_FLOAT, sizeof(SkinVertex), (void*)skinOffset);
+		VAO.LinkAttrib(skinBuffer, 9, 4, GL_FLOAT, sizeof(SkinVertex), (void*)(skinOffset + 4 * sizeof(float)));
+	}
+	// The element buffer binding is part of the VAO
+	VAO.BindElementBuffer(indexBuffer);
 }
 
 
@@ -33,10 +201,25 @@ void Mesh::Draw
 	glm::vec3 scale
 )
 {
+	// Same transformations as the vertex shader applies
+	glm::mat4 world = matrix * glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+	if (Frustum::enabled && !camera.frustum.Test(bounds, world))
+		return;
+
 	// Bind shader to be able to access uniforms
 	shader.Activate();
-	VAO.Bind();
 
+	BindTextures(shader);
+	// Take care of the camera Matrix
+	glUniform3f(glGetUniformLocation(shader.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
+	camera.Matrix(shader, "camMatrix");
+
+	DrawGeometry(shader, matrix, translation, rotation, scale);
+}
+
+// Binds the textures of the mesh and points the shader's samplers at them (the material part of Draw)
+void Mesh::BindTextures(Shader& shader)
+{
 	// Keep track of how many of each type of textures we have
 	unsigned int numDiffuse = 0;
 	unsigned int numSpecular = 0;
@@ -44,7 +227,7 @@ void Mesh::Draw
 	for (unsigned int i = 0; i < textures.size(); i++)
 	{
 		std::string num;
-		std::string type = textures[i].type;
+		std::string type = textures[i]->type;
 		if (type == "diffuse")
 		{
 			num = std::to_string(numDiffuse++);
@@ -53,12 +236,22 @@ void Mesh::Draw
 		{
 			num = std::to_string(numSpecular++);
 		}
-		textures[i].texUnit(shader, (type + num).c_str(), i);
-		textures[i].Bind();
+		textures[i]->texUnit(shader, (type + num).c_str(), i);
+		textures[i]->Bind();
 	}
-	// Take care of the camera Matrix
-	glUniform3f(glGetUniformLocation(shader.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
-	camera.Matrix(shader, "camMatrix");
+}
+
+// Pushes the transformations and draws the mesh, assumes the shader is active and the camera is exported
+void Mesh::DrawGeometry
+(
+	Shader& shader,
+	glm::mat4 matrix,
+	glm::vec3 translation,
+	glm::quat rotation,
+	glm::vec3 scale
+)
+{
+	Bind();
 
 	// Initialize matrices
 	glm::mat4 trans = glm::mat4(1.0f);
@@ -77,5 +270,5 @@ void Mesh::Draw
 	glUniformMatrix4fv(glGetUniformLocation(shader.ID, "model"), 1, GL_FALSE, glm::value_ptr(matrix));
 
 	// Draw the actual mesh
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+	glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)indexBuffer.offset);
 }
\ No newline at end of file
@@ -2,25 +2,72 @@
 #define MESH_CLASS_H
 
 #include<string>
+#include<memory>
 
-#include"VAO.h"
+#include"VAOCache.h"
 #include"EBO.h"
 #include"Camera.h"
 #include"Texture.h"
+#include"OcclusionBuffer.h"
 
 class Mesh
 {
 public:
+	// CPU copies of the geometry, empty once they are released after the upload (see cpuAccess)
 	std::vector <Vertex> vertices;
 	std::vector <GLuint> indices;
-	std::vector <Texture> textures;
-	// Store VAO in public so it can be used in the Draw function
+	// Textures are shared between the meshes of a model and deleted with the last mesh that uses them
+	std::vector <std::shared_ptr<Texture>> textures;
+	// Size of the geometry, which stays known after the CPU copies are gone
+	GLsizei vertexCount;
+	GLsizei indexCount;
+	// Keeps the CPU copies for meshes that need them after the upload (like picking or physics)
+	bool cpuAccess;
+	// Box and sphere around the vertices in the space of the mesh, used to skip meshes the camera can't see
+	AABB bounds;
+	BoundingSphere sphere;
+	// Store VAO in public so it can be used in the Draw function (empty while the mesh uses the shared VAO of its format)
 	VAO VAO;
+	// Buffers (or heap ranges) the vertices and indices live in
+	VBO vertexBuffer;
+	EBO indexBuffer;
+	// Joints and weights of every vertex, empty unless the mesh is skinned
+	VBO skinBuffer;
+	// Number no other mesh made during the run gets, unlike the address of a mesh it isn't reused once the mesh is gone
+	// (it moves along with the mesh), so caches can use it as a key
+	unsigned long long serial;
 
-	// Initializes the mesh
-	Mesh(std::vector <Vertex>& vertices, std::vector <GLuint>& indices, std::vector <Texture>& textures);
+	// Meshes made while this is set keep their vertices and indices in the heap instead of in buffers of their own
+	static BufferHeap* heap;
+	// Meshes bound while this is set point the cached VAO of their format at their buffers instead of binding
+	// a VAO of their own (needs OpenGL 4.3, see VAOCache::Supported), the ones made while it is set never get one
+	static VAOCache* vaoCache;
+	// Layout of Vertex, which is the format of every mesh
+	static const VertexFormat& Format();
 
-	// Draws the mesh
+	// Initializes the mesh, the CPU copies of the vertices and indices are only kept with cpuAccess,
+	// the bounds are found by going over the vertices unless they are already known (like from a glTF accessor)
+	Mesh(std::vector <Vertex>& vertices, std::vector <GLuint>& indices, std::vector <std::shared_ptr<Texture>>& textures, bool cpuAccess = false, const AABB* bounds = NULL);
+
+	// Returns the vertices and indices, reading them back from the GPU when the CPU copies were released
+	std::vector <Vertex> GetVertices();
+	std::vector <GLuint> GetIndices();
+	// Positions and indices of the mesh for rasterizing it into an occlusion buffer (make it once, it may read back from the GPU)
+	OcclusionBuffer::Occluder GetOccluder();
+	// Gives every vertex the joints that move it and their weights (attributes 8 and 9, see skinned.vert)
+	void SetSkin(std::vector <SkinVertex>& skin);
+	// Tells if the mesh has joints and weights and so has to be drawn with a skinning shader
+	bool Skinned();
+	// Drops the CPU copies of the vertices and indices, the GPU keeps its own
+	void ReleaseCPUCopy();
+	// Bytes of geometry held on the CPU and on the GPU
+	size_t CPUBytes();
+	size_t GPUBytes();
+
+	// Binds the VAO, pointing it at the new place of the vertices and indices first if the heap moved them
+	void Bind();
+
+	// Draws the mesh unless it is outside of the camera's frustum
 	void Draw
 	(
 		Shader& shader, 
@@ -30,5 +77,26 @@ public:
 		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
 		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f)
 	);
+
+	// Binds the textures of the mesh and points the shader's samplers at them (the material part of Draw)
+	void BindTextures(Shader& shader);
+	// Pushes the transformations and draws the mesh, assumes the shader is active and the camera is exported
+	void DrawGeometry
+	(
+		Shader& shader,
+		glm::mat4 matrix = glm::mat4(1.0f),
+		glm::vec3 translation = glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f)
+	);
+
+private:
+	// Serial the next mesh gets
+	static unsigned long long nextSerial;
+	// Set when a read back noticed that the heap moved the buffers, so the next Bind still links them again
+	bool relink = false;
+
+	// Links the vertex attributes and the indices to the VAO
+	void linkAttributes();
 };
 #endif
\ No newline at end of file
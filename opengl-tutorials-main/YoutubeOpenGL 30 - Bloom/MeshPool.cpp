@@ -0,0 +1,183 @@
+#include"MeshPool.h"
+
+#include<chrono>
+
+// Tells if two meshes use the exact same textures
+static bool same_textures(Mesh& a, Mesh& b)
+{
+	if (a.textures.size() != b.textures.size())
+		return false;
+	for (unsigned int i = 0; i < a.textures.size(); i++)
+		if (a.textures[i]->ID != b.textures[i]->ID)
+			return false;
+	return true;
+}
+
+// Copies the geometry of a mesh into the pool and returns the handle used to submit it
+unsigned int MeshPool::Add(Mesh& mesh)
+{
+	Range range;
+	range.firstIndex = (GLuint)indices.size();
+	range.indexCount = (GLuint)mesh.indexCount;
+	range.baseVertex = (GLint)vertices.size();
+	range.bounds = mesh.bounds;
+
+	// Meshes with the same textures can go into the same multi draw call
+	range.material = (unsigned int)materials.size();
+	for (unsigned int i = 0; i < materials.size(); i++)
+	{
+		if (same_textures(*materials[i], mesh))
+		{
+			range.material = i;
+			break;
+		}
+	}
+	if (range.material == materials.size())
+		materials.push_back(&mesh);
+
+	// The indices stay relative to the mesh, baseVertex moves them to the right spot
+	// (meshes without CPU copies get read back from the GPU, which is fine since this only happens while loading)
+	std::vector<Vertex> meshVertices = mesh.GetVertices();
+	std::vector<GLuint> meshIndices = mesh.GetIndices();
+	vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+	indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+	ranges.push_back(range);
+	return (unsigned int)ranges.size() - 1;
+}
+
+// Creates the shared buffers out of everything that was added
+void MeshPool::Upload()
+{
+	VAO.Bind();
+	// Generates Vertex Buffer Object and links it to vertices
+	vertexBuffer = VBO(vertices);
+	// Generates Element Buffer Object and links it to indices
+	indexBuffer = EBO(indices);
+	indexBuffer.Bind();
+	// Same layout as every other Mesh
+	VAO.LinkAttrib(vertexBuffer, 0, 3, GL_FLOAT, sizeof(Vertex), (void*)0);
+	VAO.LinkAttrib(vertexBuffer, 1, 3, GL_FLOAT, sizeof(Vertex), (void*)(3 * sizeof(float)));
+	VAO.LinkAttrib(vertexBuffer, 2, 3, GL_FLOAT, sizeof(Vertex), (void*)(6 * sizeof(float)));
+	VAO.LinkAttrib(vertexBuffer, 3, 2, GL_FLOAT, sizeof(Vertex), (void*)(9 * sizeof(float)));
+	VAO.Unbind();
+	vertexBuffer.Unbind();
+	indexBuffer.Unbind();
+
+	// Buffers for the per draw matrices and the commands, they get refilled every frame
+	glGenBuffers(1, &parameterBuffer);
+	glGenBuffers(1, &commandBuffer);
+
+	// The GPU has its own copy now
+	vertices.clear();
+	vertices.shrink_to_fit();
+	indices.clear();
+	indices.shrink_to_fit();
+}
+
+// Empties the list of draws of this frame
+void MeshPool::Begin()
+{
+	submissions.clear();
+}
+
+// Queues a mesh of the pool to be drawn with a model matrix
+void MeshPool::Submit(unsigned int mesh, glm::mat4 matrix)
+{
+	submissions.push_back(Submission{ mesh, matrix });
+}
+
+// Draws everything that was submitted with as few calls as possible
+void MeshPool::Execute(Shader& shader, Camera& camera)
+{
+	stats = Stats();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Drop the draws the camera can't see before they take up a command
+	if (Frustum::enabled)
+	{
+		boxes.Clear();
+		for (unsigned int i = 0; i < submissions.size(); i++)
+			boxes.Add(ranges[submissions[i].mesh].bounds, submissions[i].matrix);
+		camera.frustum.Test(boxes, visible);
+		unsigned int kept = 0;
+		for (unsigned int i = 0; i < submissions.size(); i++)
+		{
+			if (visible[i])
+				submissions[kept++] = submissions[i];
+		}
+		stats.culled = (unsigned int)submissions.size() - kept;
+		submissions.resize(kept);
+	}
+
+	// Group the draws by material with a counting sort, every group becomes one multi draw call
+	std::vector<unsigned int> groupStart(materials.size() + 1, 0);
+	for (unsigned int i = 0; i < submissions.size(); i++)
+		groupStart[ranges[submissions[i].mesh].material + 1]++;
+	for (unsigned int i = 1; i < groupStart.size(); i++)
+		groupStart[i] += groupStart[i - 1];
+
+	parameters.resize(submissions.size());
+	commands.resize(submissions.size());
+	std::vector<unsigned int> next(groupStart.begin(), groupStart.end() - 1);
+	for (unsigned int i = 0; i < submissions.size(); i++)
+	{
+		Range& range = ranges[submissions[i].mesh];
+		unsigned int slot = next[range.material]++;
+		parameters[slot] = submissions[i].matrix;
+		commands[slot] = DrawElementsIndirectCommand{ range.indexCount, 1, range.firstIndex, range.baseVertex, 0 };
+	}
+
+	// Orphan and refill the buffers so the GPU can keep reading last frame's copy
+	StateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, parameterBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, parameters.size() * sizeof(glm::mat4), parameters.data(), GL_STREAM_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, parameterBuffer);
+	StateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+
+	shader.Activate();
+	glUniform3f(glGetUniformLocation(shader.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
+	camera.Matrix(shader, "camMatrix");
+	GLint drawOffset = glGetUniformLocation(shader.ID, "drawOffset");
+	VAO.Bind();
+
+	for (unsigned int i = 0; i < materials.size(); i++)
+	{
+		GLsizei count = groupStart[i + 1] - groupStart[i];
+		if (count == 0)
+			continue;
+		materials[i]->BindTextures(shader);
+		// gl_DrawID restarts at 0 for every call, so tell the shader where this group's matrices start
+		glUniform1ui(drawOffset, groupStart[i]);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(groupStart[i] * sizeof(DrawElementsIndirectCommand)), count, 0);
+		stats.draws += count;
+		stats.multiDraws++;
+	}
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	stats.submitMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Stats of the last call to Execute
+MeshPool::Stats MeshPool::LastStats()
+{
+	return stats;
+}
+
+// Deletes the shared buffers
+void MeshPool::Delete()
+{
+	VAO.Delete();
+	vertexBuffer.Delete();
+	indexBuffer.Delete();
+	GLuint buffers[2] = { parameterBuffer, commandBuffer };
+	for (unsigned int i = 0; i < 2; i++)
+		StateCache::ForgetBuffer(buffers[i]);
+	glDeleteBuffers(2, buffers);
+}
+
+// Tells if the current context can use the pool
+bool MeshPool::Supported()
+{
+	// gl_DrawID is core since 4.6, multi draw indirect since 4.3
+	return GLAD_GL_VERSION_4_6;
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef MESH_POOL_CLASS_H
+#define MESH_POOL_CLASS_H
+
+#include"Mesh.h"
+
+// Layout of the commands read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Packs many static meshes into one vertex buffer, one index buffer and one VAO so that a whole pass
+// can be drawn with one glMultiDrawElementsIndirect per material (needs OpenGL 4.6 and multidraw.vert)
+class MeshPool
+{
+public:
+	// What drawing the last pass cost
+	struct Stats
+	{
+		unsigned int draws = 0;
+		unsigned int multiDraws = 0;
+		// Submitted draws that were outside of the frustum
+		unsigned int culled = 0;
+		// CPU time spent building and submitting the commands
+		double submitMs = 0.0;
+	};
+
+	// Copies the geometry of a mesh into the pool and returns the handle used to submit it
+	unsigned int Add(Mesh& mesh);
+	// Creates the shared buffers out of everything that was added
+	void Upload();
+
+	// Empties the list of draws of this frame
+	void Begin();
+	// Queues a mesh of the pool to be drawn with a model matrix
+	void Submit(unsigned int mesh, glm::mat4 matrix = glm::mat4(1.0f));
+	// Draws everything that was submitted and is inside of the camera's frustum with as few calls as possible
+	void Execute(Shader& shader, Camera& camera);
+	// Stats of the last call to Execute
+	Stats LastStats();
+
+	// Deletes the shared buffers
+	void Delete();
+
+	// Tells if the current context can use the pool
+	static bool Supported();
+
+private:
+	// Where a mesh ended up inside the shared buffers
+	struct Range
+	{
+		GLuint firstIndex;
+		GLuint indexCount;
+		GLint baseVertex;
+		unsigned int material;
+		AABB bounds;
+	};
+	struct Submission
+	{
+		unsigned int mesh;
+		glm::mat4 matrix;
+	};
+
+	// Geometry waiting for Upload
+	std::vector<Vertex> vertices;
+	std::vector<GLuint> indices;
+	std::vector<Range> ranges;
+	// First mesh that used each material, used to bind its textures
+	std::vector<Mesh*> materials;
+
+	VAO VAO;
+	// Empty until Upload moves the shared buffers in
+	VBO vertexBuffer;
+	EBO indexBuffer;
+	GLuint parameterBuffer = 0;
+	GLuint commandBuffer = 0;
+
+	// Draws of this frame and the arrays that get built out of them
+	std::vector<Submission> submissions;
+	std::vector<glm::mat4> parameters;
+	std::vector<DrawElementsIndirectCommand> commands;
+	Stats stats;
+	// World space boxes of the submissions and which of them the camera can see
+	BoxBatch boxes;
+	std::vector<unsigned char> visible;
+};
+#endif
\ No newline at end of file
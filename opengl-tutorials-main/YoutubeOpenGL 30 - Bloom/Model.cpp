@@ -1,28 +1,173 @@
 #include"Model.h"
 
-Model::Model(const char* file)
+#include<glm/gtx/matrix_decompose.hpp>
+
+Model::Model(const char* file, bool cpuAccess)
 {
 	// Make a JSON object
 	std::string text = get_file_contents(file);
 	JSON = json::parse(text);
+	jsonBytes = text.size();
 
 	// Get the binary data
 	Model::file = file;
+	Model::cpuAccess = cpuAccess;
 	data = getData();
 
-	// Traverse all nodes
-	traverseNode(0);
+	// Traverse all nodes, starting at the roots of the scene (skinned files often have the skeleton next to the mesh instead of below it)
+	nodeTransforms.assign(JSON["nodes"].size(), TransformHierarchy::none);
+	if (JSON.find("scenes") != JSON.end())
+	{
+		json roots = JSON["scenes"][JSON.value("scene", 0)]["nodes"];
+		for (unsigned int i = 0; i < roots.size(); i++)
+			traverseNode(roots[i]);
+	}
+	else
+		traverseNode(0);
+	UpdateTransforms();
+	loadSkins();
+	loadAnimations();
+
+	// Everything was interpreted and uploaded, the raw file and the parsed JSON are just a second copy now
+	releasedBytes = data.capacity() + jsonBytes;
+	for (unsigned int i = 0; i < meshes.size() && !cpuAccess; i++)
+		releasedBytes += meshes[i].GPUBytes();
+	std::vector<unsigned char>().swap(data);
+	JSON = json();
+	jsonBytes = 0;
 }
 
 void Model::Draw(Shader& shader, Camera& camera)
 {
-	// Go over all meshes and draw each one
+	// Test all the meshes against the frustum at once
+	boxes.Clear();
+	for (unsigned int i = 0; i < meshes.size(); i++)
+		boxes.Add(meshes[i].bounds, matricesMeshes[i]);
+	camera.frustum.Test(boxes, visible);
+
+	// Bind shader to be able to access uniforms
+	shader.Activate();
+	// Take care of the camera Matrix
+	glUniform3f(glGetUniformLocation(shader.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
+	camera.Matrix(shader, "camMatrix");
+	// Go over all meshes and draw the ones the camera can see
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		if (Frustum::enabled && !visible[i])
+			continue;
+		meshes[i].BindTextures(shader);
+		meshes[i].DrawGeometry(shader, matricesMeshes[i]);
+	}
+}
+
+void Model::Submit(RenderQueue& queue, Shader& shader, glm::mat4 matrix, bool translucent)
+{
+	// Go over all meshes and queue each one, the queue decides the order they get drawn in
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		queue.Submit(meshes[i], shader, matrix * matricesMeshes[i], translucent);
+	}
+}
+
+// Adds every mesh to a BVH with the matrices its nodes gave it, placed in the world by a matrix
+void Model::Insert(BVH& bvh, glm::mat4 matrix)
+{
+	bvhObjects.clear();
+	for (unsigned int i = 0; i < meshes.size(); i++)
+		bvhObjects.push_back(bvh.Insert(meshes[i].bounds.Transform(matrix * matricesMeshes[i])));
+}
+
+// Moves the meshes that were added to a BVH to a new place (they get there with the next Refit)
+void Model::Move(BVH& bvh, glm::mat4 matrix)
+{
+	for (unsigned int i = 0; i < bvhObjects.size(); i++)
+		bvh.Update(bvhObjects[i], meshes[i].bounds.Transform(matrix * matricesMeshes[i]));
+}
+
+// Moves a node of the glTF file relative to its parent, the meshes below it follow once UpdateTransforms is called
+void Model::SetNodeTransform(unsigned int node, glm::vec3 translation, glm::quat rotation, glm::vec3 scale)
+{
+	if (node >= nodeTransforms.size() || nodeTransforms[node] == TransformHierarchy::none)
+		throw std::invalid_argument("Node " + std::to_string(node) + " is not part of the model's scene");
+	transforms.Set(nodeTransforms[node], translation, rotation, scale);
+}
+
+// Recomputes the matrices of the nodes that moved and of everything below them
+void Model::UpdateTransforms()
+{
+	transforms.Update();
+	for (unsigned int i = 0; i < meshTransforms.size(); i++)
+		matricesMeshes[i] = transforms.World(meshTransforms[i]);
+}
+
+// Draws the model posed by a copy of its nodes, skinned meshes with the skinning shader and the joint palettes of their skins
+void Model::DrawAnimated(Shader& shader, Shader& skinnedShader, Camera& camera, TransformHierarchy& pose, const std::vector<GLuint>& jointBuffers, glm::mat4 matrix)
+{
+	Shader* shaders[] = { &shader, &skinnedShader };
+	for (Shader* program : shaders)
+	{
+		program->Activate();
+		glUniform3f(glGetUniformLocation(program->ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
+		camera.Matrix(*program, "camMatrix");
+	}
 	for (unsigned int i = 0; i < meshes.size(); i++)
 	{
-		meshes[i].Mesh::Draw(shader, camera, matricesMeshes[i]);
+		if (meshSkins[i] >= 0 && meshes[i].Skinned() && (unsigned int)meshSkins[i] < jointBuffers.size())
+		{
+			// glTF ignores the node of a skinned mesh, the joints already bring the vertices where they belong
+			// (the joints can move the vertices anywhere, so the bind pose box means nothing and there is no frustum test)
+			skinnedShader.Activate();
+			StateCache::BindBuffer(GL_UNIFORM_BUFFER, jointBuffers[meshSkins[i]]);
+			glBindBufferBase(GL_UNIFORM_BUFFER, 0, jointBuffers[meshSkins[i]]);
+			meshes[i].BindTextures(skinnedShader);
+			meshes[i].DrawGeometry(skinnedShader, matrix);
+			continue;
+		}
+		glm::mat4 world = matrix * pose.World(meshTransforms[i]);
+		if (Frustum::enabled && !camera.frustum.Test(meshes[i].bounds, world))
+			continue;
+		shader.Activate();
+		meshes[i].BindTextures(shader);
+		meshes[i].DrawGeometry(shader, world);
 	}
 }
 
+// Animations of the glTF file
+const std::vector<AnimationClip>& Model::Animations()
+{
+	return animations;
+}
+
+// Skins of the glTF file
+const std::vector<Skin>& Model::Skins()
+{
+	return skins;
+}
+
+// Nodes of the glTF file, the joints of the skins and the channels of the animations point into it
+const TransformHierarchy& Model::Transforms()
+{
+	return transforms;
+}
+
+// Counts the memory the model holds right now
+Model::MemoryReport Model::Memory()
+{
+	MemoryReport report;
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		report.cpuGeometry += meshes[i].CPUBytes();
+		report.gpuGeometry += meshes[i].GPUBytes();
+	}
+	for (unsigned int i = 0; i < loadedTex.size(); i++)
+		report.gpuTextures += loadedTex[i]->bytes;
+	report.cpuFile = data.capacity();
+	// The parsed tree takes a few times the size of its text, the text is a lower bound
+	report.cpuJSON = jsonBytes;
+	report.released = releasedBytes;
+	return report;
+}
+
 void Model::loadMesh(unsigned int indMesh)
 {
 	// Get all accessor indices
@@ -31,8 +176,18 @@ void Model::loadMesh(unsigned int indMesh)
 	unsigned int texAccInd = JSON["meshes"][indMesh]["primitives"][0]["attributes"]["TEXCOORD_0"];
 	unsigned int indAccInd = JSON["meshes"][indMesh]["primitives"][0]["indices"];
 
+	// glTF requires the min and max of positions, but older exporters leave them out and the mesh has to find them itself
+	json posAccessor = JSON["accessors"][posAccInd];
+	AABB bounds;
+	bool hasBounds = posAccessor.find("min") != posAccessor.end() && posAccessor.find("max") != posAccessor.end();
+	if (hasBounds)
+	{
+		bounds.min = glm::vec3(posAccessor["min"][0].get<float>(), posAccessor["min"][1].get<float>(), posAccessor["min"][2].get<float>());
+		bounds.max = glm::vec3(posAccessor["max"][0].get<float>(), posAccessor["max"][1].get<float>(), posAccessor["max"][2].get<float>());
+	}
+
 	// Use accessor indices to get all vertices components
-	std::vector<float> posVec = getFloats(JSON["accessors"][posAccInd]);
+	std::vector<float> posVec = getFloats(posAccessor);
 	std::vector<glm::vec3> positions = groupFloatsVec3(posVec);
 	std::vector<float> normalVec = getFloats(JSON["accessors"][normalAccInd]);
 	std::vector<glm::vec3> normals = groupFloatsVec3(normalVec);
@@ -42,13 +197,119 @@ void Model::loadMesh(unsigned int indMesh)
 	// Combine all the vertex components and also get the indices and textures
 	std::vector<Vertex> vertices = assembleVertices(positions, normals, texUVs);
 	std::vector<GLuint> indices = getIndices(JSON["accessors"][indAccInd]);
-	std::vector<Texture> textures = getTextures();
+	std::vector<std::shared_ptr<Texture>> textures = getTextures();
 
 	// Combine the vertices, indices, and textures into a mesh
-	meshes.push_back(Mesh(vertices, indices, textures));
+	meshes.emplace_back(vertices, indices, textures, cpuAccess, hasBounds ? &bounds : NULL);
+
+	// Skinned meshes also get the joints that move every vertex and their weights
+	json attributes = JSON["meshes"][indMesh]["primitives"][0]["attributes"];
+	if (attributes.find("JOINTS_0") != attributes.end() && attributes.find("WEIGHTS_0") != attributes.end())
+	{
+		std::vector<glm::vec4> joints = groupFloatsVec4(getComponents(JSON["accessors"][(unsigned int)attributes["JOINTS_0"]], false));
+		std::vector<glm::vec4> weights = groupFloatsVec4(getComponents(JSON["accessors"][(unsigned int)attributes["WEIGHTS_0"]], true));
+		std::vector<SkinVertex> skin;
+		for (unsigned int i = 0; i < joints.size() && i < weights.size(); i++)
+		{
+			// Joints past the largest palette aren't uploaded, so they lose their weight and point at joint 0 instead of
+			// reading past the end of the uniform buffer
+			for (unsigned int j = 0; j < 4; j++)
+			{
+				if (joints[i][j] >= (float)Skin::maxJoints)
+				{
+					joints[i][j] = 0.0f;
+					weights[i][j] = 0.0f;
+				}
+			}
+			// Weights are supposed to add up to 1 but quantized ones rarely do exactly
+			float sum = weights[i].x + weights[i].y + weights[i].z + weights[i].w;
+			skin.push_back(SkinVertex{ joints[i], sum > 0.0f ? weights[i] / sum : glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) });
+		}
+		meshes.back().SetSkin(skin);
+	}
+}
+
+// Reads the skins, after the nodes so the joints can refer to them
+void Model::loadSkins()
+{
+	if (JSON.find("skins") == JSON.end())
+		return;
+	for (unsigned int i = 0; i < JSON["skins"].size(); i++)
+	{
+		json skinJSON = JSON["skins"][i];
+		Skin skin;
+		unsigned int count = (unsigned int)skinJSON["joints"].size();
+		if (count > Skin::maxJoints)
+			std::cout << "Skin " << i << " of " << file << " has " << count << " joints, only the first " << Skin::maxJoints << " move the mesh" << std::endl;
+		for (unsigned int j = 0; j < count; j++)
+		{
+			unsigned int joint = skinJSON["joints"][j];
+			if (nodeTransforms[joint] == TransformHierarchy::none)
+				throw std::invalid_argument("Joint " + std::to_string(joint) + " is not part of the model's scene");
+			skin.joints.push_back(nodeTransforms[joint]);
+		}
+		// Without the matrices the joints are bound where they are
+		skin.inverseBindMatrices.assign(count, glm::mat4(1.0f));
+		if (skinJSON.find("inverseBindMatrices") != skinJSON.end())
+		{
+			std::vector<float> matrices = getFloats(JSON["accessors"][(unsigned int)skinJSON["inverseBindMatrices"]]);
+			for (unsigned int j = 0; j < count && (j + 1) * 16 <= matrices.size(); j++)
+				skin.inverseBindMatrices[j] = glm::make_mat4(&matrices[j * 16]);
+		}
+		skins.push_back(skin);
+	}
+}
+
+// Reads the animations, after the nodes so the channels can refer to them
+void Model::loadAnimations()
+{
+	if (JSON.find("animations") == JSON.end())
+		return;
+	for (unsigned int i = 0; i < JSON["animations"].size(); i++)
+	{
+		json animationJSON = JSON["animations"][i];
+		AnimationClip clip;
+		clip.name = animationJSON.value("name", "animation" + std::to_string(i));
+		for (unsigned int j = 0; j < animationJSON["channels"].size(); j++)
+		{
+			json target = animationJSON["channels"][j]["target"];
+			std::string path = target["path"];
+			// Morph target weights aren't supported, and channels without a node don't move anything
+			if (path == "weights" || target.find("node") == target.end())
+				continue;
+			unsigned int node = target["node"];
+			if (nodeTransforms[node] == TransformHierarchy::none)
+				continue;
+
+			json sampler = animationJSON["samplers"][(unsigned int)animationJSON["channels"][j]["sampler"]];
+			json output = JSON["accessors"][(unsigned int)sampler["output"]];
+			AnimationClip::Channel channel;
+			channel.node = nodeTransforms[node];
+			channel.path = path == "translation" ? AnimationClip::TRANSLATION : path == "rotation" ? AnimationClip::ROTATION : AnimationClip::SCALE;
+			std::string interpolation = sampler.value("interpolation", "LINEAR");
+			channel.step = interpolation == "STEP";
+			channel.times = getFloats(JSON["accessors"][(unsigned int)sampler["input"]]);
+			std::vector<float> values = getComponents(output, output.value("normalized", false));
+
+			// Cubic splines store an in tangent, the value and an out tangent for every key, only the values are used
+			unsigned int components = channel.path == AnimationClip::ROTATION ? 4 : 3;
+			unsigned int stride = interpolation == "CUBICSPLINE" ? 3 : 1;
+			for (unsigned int k = 0; k < channel.times.size() && ((k + 1) * stride) * components <= values.size(); k++)
+			{
+				const float* value = &values[(k * stride + (stride == 3 ? 1 : 0)) * components];
+				channel.values.push_back(glm::vec4(value[0], value[1], value[2], components == 4 ? value[3] : 0.0f));
+			}
+			channel.times.resize(channel.values.size());
+			if (channel.times.empty())
+				continue;
+			clip.duration = std::max(clip.duration, channel.times.back());
+			clip.channels.push_back(channel);
+		}
+		animations.push_back(clip);
+	}
 }
 
-void Model::traverseNode(unsigned int nextNode, glm::mat4 matrix)
+void Model::traverseNode(unsigned int nextNode, unsigned int parent)
 {
 	// Current node
 	json node = JSON["nodes"][nextNode];
@@ -84,28 +345,20 @@ void Model::traverseNode(unsigned int nextNode, glm::mat4 matrix)
 			scaleValues[i] = (node["scale"][i]);
 		scale = glm::make_vec3(scaleValues);
 	}
-	// Get matrix if it exists
-	glm::mat4 matNode = glm::mat4(1.0f);
+	// Get matrix if it exists (glTF only allows it on nodes without a translation, rotation and scale)
 	if (node.find("matrix") != node.end())
 	{
 		float matValues[16];
 		for (unsigned int i = 0; i < node["matrix"].size(); i++)
 			matValues[i] = (node["matrix"][i]);
-		matNode = glm::make_mat4(matValues);
+		glm::vec3 skew;
+		glm::vec4 perspective;
+		glm::decompose(glm::make_mat4(matValues), scale, rotation, translation, skew, perspective);
 	}
 
-	// Initialize matrices
-	glm::mat4 trans = glm::mat4(1.0f);
-	glm::mat4 rot = glm::mat4(1.0f);
-	glm::mat4 sca = glm::mat4(1.0f);
-
-	// Use translation, rotation, and scale to change the initialized matrices
-	trans = glm::translate(trans, translation);
-	rot = glm::mat4_cast(rotation);
-	sca = glm::scale(sca, scale);
-
-	// Multiply all matrices together
-	glm::mat4 matNextNode = matrix * matNode * trans * rot * sca;
+	// The hierarchy multiplies the node with its parents whenever either of them moves
+	unsigned int transform = transforms.Add(parent, translation, rotation, scale);
+	nodeTransforms[nextNode] = transform;
 
 	// Check if the node contains a mesh and if it does load it
 	if (node.find("mesh") != node.end())
@@ -113,16 +366,18 @@ void Model::traverseNode(unsigned int nextNode, glm::mat4 matrix)
 		translationsMeshes.push_back(translation);
 		rotationsMeshes.push_back(rotation);
 		scalesMeshes.push_back(scale);
-		matricesMeshes.push_back(matNextNode);
+		matricesMeshes.push_back(glm::mat4(1.0f));
+		meshTransforms.push_back(transform);
+		meshSkins.push_back(node.value("skin", -1));
 
 		loadMesh(node["mesh"]);
 	}
 
-	// Check if the node has children, and if it does, apply this function to them with the matNextNode
+	// Check if the node has children, and if it does, apply this function to them below this node
 	if (node.find("children") != node.end())
 	{
 		for (unsigned int i = 0; i < node["children"].size(); i++)
-			traverseNode(node["children"][i], matNextNode);
+			traverseNode(node["children"][i], transform);
 	}
 }
 
@@ -162,7 +417,8 @@ std::vector<float> Model::getFloats(json accessor)
 	else if (type == "VEC2") numPerVert = 2;
 	else if (type == "VEC3") numPerVert = 3;
 	else if (type == "VEC4") numPerVert = 4;
-	else throw std::invalid_argument("Type is invalid (not SCALAR, VEC2, VEC3, or VEC4)");
+	else if (type == "MAT4") numPerVert = 16;
+	else throw std::invalid_argument("Type is invalid (not SCALAR, VEC2, VEC3, VEC4, or MAT4)");
 
 	// Go over all the bytes in the data at the correct place using the properties from above
 	unsigned int beginningOfData = byteOffset + accByteOffset;
@@ -228,9 +484,53 @@ std::vector<GLuint> Model::getIndices(json accessor)
 	return indices;
 }
 
-std::vector<Texture> Model::getTextures()
+std::vector<float> Model::getComponents(json accessor, bool normalized)
+{
+	unsigned int componentType = accessor["componentType"];
+	if (componentType == 5126)
+		return getFloats(accessor);
+
+	std::vector<float> values;
+
+	// Get properties from the accessor
+	unsigned int buffViewInd = accessor.value("bufferView", 0);
+	unsigned int count = accessor["count"];
+	unsigned int accByteOffset = accessor.value("byteOffset", 0);
+	std::string type = accessor["type"];
+	unsigned int numPerVert = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : 4;
+
+	// Get properties from the bufferView
+	json bufferView = JSON["bufferViews"][buffViewInd];
+	unsigned int byteOffset = bufferView.value("byteOffset", 0);
+
+	// Get the components with regards to their type: unsigned byte, unsigned short, byte or short,
+	// normalized ones are brought into 0 to 1 (or -1 to 1 when signed)
+	unsigned int beginningOfData = byteOffset + accByteOffset;
+	for (unsigned int i = 0; i < count * numPerVert; i++)
+	{
+		float value;
+		if (componentType == 5121)
+			value = normalized ? data[beginningOfData + i] / 255.0f : data[beginningOfData + i];
+		else if (componentType == 5120)
+			value = normalized ? std::max((signed char)data[beginningOfData + i] / 127.0f, -1.0f) : (signed char)data[beginningOfData + i];
+		else
+		{
+			unsigned short bits;
+			std::memcpy(&bits, &data[beginningOfData + i * 2], sizeof(unsigned short));
+			if (componentType == 5123)
+				value = normalized ? bits / 65535.0f : bits;
+			else
+				value = normalized ? std::max((short)bits / 32767.0f, -1.0f) : (short)bits;
+		}
+		values.push_back(value);
+	}
+
+	return values;
+}
+
+std::vector<std::shared_ptr<Texture>> Model::getTextures()
 {
-	std::vector<Texture> textures;
+	std::vector<std::shared_ptr<Texture>> textures;
 
 	std::string fileStr = std::string(file);
 	std::string fileDirectory = fileStr.substr(0, fileStr.find_last_of('/') + 1);
@@ -259,7 +559,7 @@ std::vector<Texture> Model::getTextures()
 			// Load diffuse texture
 			if (texPath.find("baseColor") != std::string::npos || texPath.find("diffuse") != std::string::npos)
 			{
-				Texture diffuse = Texture((fileDirectory + texPath).c_str(), "diffuse", loadedTex.size());
+				std::shared_ptr<Texture> diffuse = std::make_shared<Texture>((fileDirectory + texPath).c_str(), "diffuse", loadedTex.size());
 				textures.push_back(diffuse);
 				loadedTex.push_back(diffuse);
 				loadedTexName.push_back(texPath);
@@ -267,7 +567,7 @@ std::vector<Texture> Model::getTextures()
 			// Load specular texture
 			else if (texPath.find("metallicRoughness") != std::string::npos || texPath.find("specular") != std::string::npos)
 			{
-				Texture specular = Texture((fileDirectory + texPath).c_str(), "specular", loadedTex.size());
+				std::shared_ptr<Texture> specular = std::make_shared<Texture>((fileDirectory + texPath).c_str(), "specular", loadedTex.size());
 				textures.push_back(specular);
 				loadedTex.push_back(specular);
 				loadedTexName.push_back(texPath);
@@ -305,27 +605,28 @@ std::vector<Vertex> Model::assembleVertices
 std::vector<glm::vec2> Model::groupFloatsVec2(std::vector<float> floatVec)
 {
 	std::vector<glm::vec2> vectors;
-	for (int i = 0; i < floatVec.size(); i)
+	// The order arguments get evaluated in is unspecified, so every component is indexed on its own
+	for (size_t i = 0; i + 1 < floatVec.size(); i += 2)
 	{
-		vectors.push_back(glm::vec2(floatVec[i++], floatVec[i++]));
+		vectors.push_back(glm::vec2(floatVec[i], floatVec[i + 1]));
 	}
 	return vectors;
 }
 std::vector<glm::vec3> Model::groupFloatsVec3(std::vector<float> floatVec)
 {
 	std::vector<glm::vec3> vectors;
-	for (int i = 0; i < floatVec.size(); i)
+	for (size_t i = 0; i + 2 < floatVec.size(); i += 3)
 	{
-		vectors.push_back(glm::vec3(floatVec[i++], floatVec[i++], floatVec[i++]));
+		vectors.push_back(glm::vec3(floatVec[i], floatVec[i + 1], floatVec[i + 2]));
 	}
 	return vectors;
 }
 std::vector<glm::vec4> Model::groupFloatsVec4(std::vector<float> floatVec)
 {
 	std::vector<glm::vec4> vectors;
-	for (int i = 0; i < floatVec.size(); i)
+	for (size_t i = 0; i + 3 < floatVec.size(); i += 4)
 	{
-		vectors.push_back(glm::vec4(floatVec[i++], floatVec[i++], floatVec[i++], floatVec[i++]));
+		vectors.push_back(glm::vec4(floatVec[i], floatVec[i + 1], floatVec[i + 2], floatVec[i + 3]));
 	}
 	return vectors;
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include<json/json.h>
 #include"Mesh.h"
+#include"RenderQueue.h"
+#include"BVH.h"
+#include"Animation.h"
 
 using json = nlohmann::json;
 
@@ -10,16 +13,60 @@ using json = nlohmann::json;
 class Model
 {
 public:
-	// Loads in a model from a file and stores tha information in 'data', 'JSON', and 'file'
-	Model(const char* file);
+	// Bytes a model holds on the CPU and on the GPU
+	struct MemoryReport
+	{
+		// CPU copies of the geometry (only meshes loaded with cpuAccess keep these)
+		size_t cpuGeometry = 0;
+		// The binary file and the parsed JSON, both are released once the meshes are uploaded
+		size_t cpuFile = 0;
+		size_t cpuJSON = 0;
+		// What was given back after the upload
+		size_t released = 0;
+		size_t gpuGeometry = 0;
+		size_t gpuTextures = 0;
+	};
 
+	// Loads in a model from a file and stores tha information in 'data', 'JSON', and 'file',
+	// which get dropped (along with the CPU copies of the meshes unless cpuAccess is set) once everything is on the GPU
+	Model(const char* file, bool cpuAccess = false);
+
+	// Draws the meshes that are inside of the camera's frustum
 	void Draw(Shader& shader, Camera& camera);
+	// Adds all the meshes to a render queue instead of drawing them right away
+	void Submit(RenderQueue& queue, Shader& shader, glm::mat4 matrix = glm::mat4(1.0f), bool translucent = false);
+	// Adds every mesh to a BVH with the matrices its nodes gave it, placed in the world by a matrix
+	void Insert(BVH& bvh, glm::mat4 matrix = glm::mat4(1.0f));
+	// Moves the meshes that were added to a BVH to a new place (they get there with the next Refit)
+	void Move(BVH& bvh, glm::mat4 matrix);
+	// Moves a node of the glTF file relative to its parent, the meshes below it follow once UpdateTransforms is called
+	void SetNodeTransform(unsigned int node, glm::vec3 translation, glm::quat rotation, glm::vec3 scale);
+	// Recomputes the matrices of the nodes that moved and of everything below them
+	void UpdateTransforms();
+	// Draws the model posed by a copy of its nodes, skinned meshes with the skinning shader and the joint palettes of
+	// their skins (one uniform buffer per skin, see Animator), the other meshes follow the nodes they hang off
+	void DrawAnimated(Shader& shader, Shader& skinnedShader, Camera& camera, TransformHierarchy& pose, const std::vector<GLuint>& jointBuffers, glm::mat4 matrix = glm::mat4(1.0f));
+	// Counts the memory the model holds right now
+	MemoryReport Memory();
+
+	// Animations and skins of the glTF file and the nodes they move (copy the nodes to give a character a pose of its own)
+	const std::vector<AnimationClip>& Animations();
+	const std::vector<Skin>& Skins();
+	const TransformHierarchy& Transforms();
+
+	// Objects the meshes are in the BVH they were inserted into, in the same order as the meshes
+	std::vector<unsigned int> bvhObjects;
 
 private:
 	// Variables for easy access
 	const char* file;
 	std::vector<unsigned char> data;
 	json JSON;
+	// Keep the CPU copies of the meshes for picking or physics
+	bool cpuAccess;
+	// Size of the JSON text, used to estimate the parsed JSON while it is still around
+	size_t jsonBytes = 0;
+	size_t releasedBytes = 0;
 
 	// All the meshes and transformations
 	std::vector<Mesh> meshes;
@@ -27,23 +74,40 @@ private:
 	std::vector<glm::quat> rotationsMeshes;
 	std::vector<glm::vec3> scalesMeshes;
 	std::vector<glm::mat4> matricesMeshes;
+	// Every node of the file (parents before their children), which node every glTF node became and which node every mesh hangs off
+	TransformHierarchy transforms;
+	std::vector<unsigned int> nodeTransforms;
+	std::vector<unsigned int> meshTransforms;
+	// Skin every mesh is bound to (-1 for meshes that aren't skinned)
+	std::vector<int> meshSkins;
+	std::vector<Skin> skins;
+	std::vector<AnimationClip> animations;
+	// World space boxes of the meshes and which of them passed the frustum test, kept around to reuse their memory
+	BoxBatch boxes;
+	std::vector<unsigned char> visible;
 
 	// Prevents textures from being loaded twice
 	std::vector<std::string> loadedTexName;
-	std::vector<Texture> loadedTex;
+	std::vector<std::shared_ptr<Texture>> loadedTex;
 
 	// Loads a single mesh by its index
 	void loadMesh(unsigned int indMesh);
 
-	// Traverses a node recursively, so it essentially traverses all connected nodes
-	void traverseNode(unsigned int nextNode, glm::mat4 matrix = glm::mat4(1.0f));
+	// Traverses a node recursively, so it essentially traverses all connected nodes, adding them below a parent in the hierarchy
+	void traverseNode(unsigned int nextNode, unsigned int parent = TransformHierarchy::none);
+
+	// Reads the skins and animations, after the nodes so they can refer to them
+	void loadSkins();
+	void loadAnimations();
 
 	// Gets the binary data from a file
 	std::vector<unsigned char> getData();
 	// Interprets the binary data into floats, indices, and textures
 	std::vector<float> getFloats(json accessor);
 	std::vector<GLuint> getIndices(json accessor);
-	std::vector<Texture> getTextures();
+	// Interprets the binary data of joints, weights or keyframes that may be stored as bytes or shorts
+	std::vector<float> getComponents(json accessor, bool normalized);
+	std::vector<std::shared_ptr<Texture>> getTextures();
 
 	// Assembles all the floats into vertices
 	std::vector<Vertex> assembleVertices
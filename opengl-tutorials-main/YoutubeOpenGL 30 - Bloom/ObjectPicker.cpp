@@ -0,0 +1,125 @@
+#include"ObjectPicker.h"
+
+// Makes the ID texture and attaches it to the bound framebuffer
+ObjectPicker::ObjectPicker(int width, int height, unsigned int index)
+{
+	ObjectPicker::width = width;
+	ObjectPicker::height = height;
+	ObjectPicker::index = index;
+
+	// Integer textures can't be filtered, so they have to be sampled with nearest
+	glGenTextures(1, &texture);
+	StateCache::BindTexture(0, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, width, height, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + index, GL_TEXTURE_2D, texture, 0);
+
+	// One pixel is all a request copies, the buffers get read by the CPU so they are made for that
+	for (unsigned int i = 0; i < slotCount; i++)
+	{
+		glGenBuffers(1, &slots[i].buffer);
+		StateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, 2 * sizeof(GLuint), NULL, GL_STREAM_READ);
+	}
+	StateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+// Bytes the ID texture takes up
+size_t ObjectPicker::Bytes()
+{
+	return (size_t)width * height * 2 * sizeof(GLuint);
+}
+
+// Sets every pixel of the ID texture to 0
+void ObjectPicker::Clear()
+{
+	const GLuint background[4] = { 0, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, index, background);
+}
+
+// Copies a pixel of the bound framebuffer into the next free pixel buffer
+bool ObjectPicker::Request(double x, double y)
+{
+	// The window's y points down, the framebuffer's points up
+	int pixelX = (int)x;
+	int pixelY = height - 1 - (int)y;
+	if (x < 0.0 || y < 0.0 || pixelX >= width || pixelY < 0 || pending == slotCount)
+		return false;
+
+	Slot& slot = slots[(first + pending) % slotCount];
+	slot.x = pixelX;
+	slot.y = (int)y;
+	slot.frame = frame;
+	slot.time = glfwGetTime();
+	// With a pixel pack buffer bound glReadPixels only queues the copy and returns right away
+	glReadBuffer(GL_COLOR_ATTACHMENT0 + index);
+	StateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	glReadPixels(pixelX, pixelY, 1, 1, GL_RG_INTEGER, GL_UNSIGNED_INT, (void*)0);
+	StateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pending++;
+	return true;
+}
+
+// Checks the oldest request without waiting
+bool ObjectPicker::Poll(Result& result)
+{
+	if (pending == 0)
+		return false;
+	Slot& slot = slots[first];
+	// A timeout of 0 only asks, the flush makes sure the fence reaches the GPU at all
+	GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return false;
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+
+	// The copy is done, so reading the buffer doesn't wait for anything
+	GLuint ids[2] = { 0, 0 };
+	StateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, sizeof(ids), ids);
+	StateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	result.object = ids[0];
+	result.primitive = ids[1];
+	result.x = slot.x;
+	result.y = slot.y;
+	result.frames = (unsigned int)(frame - slot.frame);
+	result.latencyMs = (glfwGetTime() - slot.time) * 1000.0;
+	first = (first + 1) % slotCount;
+	pending--;
+	return true;
+}
+
+// Counts the frames the latency of a request is measured in
+void ObjectPicker::EndFrame()
+{
+	frame++;
+}
+
+// Deletes the texture, the pixel buffers and the fences
+void ObjectPicker::Delete()
+{
+	for (unsigned int i = 0; i < slotCount; i++)
+	{
+		if (slots[i].fence != 0)
+			glDeleteSync(slots[i].fence);
+		if (slots[i].buffer != 0)
+		{
+			StateCache::ForgetBuffer(slots[i].buffer);
+			glDeleteBuffers(1, &slots[i].buffer);
+		}
+		slots[i] = Slot();
+	}
+	pending = 0;
+	if (texture != 0)
+	{
+		StateCache::ForgetTexture(texture);
+		glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef OBJECT_PICKER_CLASS_H
+#define OBJECT_PICKER_CLASS_H
+
+#include<glad/glad.h>
+#include<GLFW/glfw3.h>
+
+#include"StateCache.h"
+
+// Finds the object and the triangle under a pixel. The scene writes both into an RG32UI attachment next to its colors,
+// the pixel gets copied into a pixel buffer right after the scene was drawn and a fence marks when the GPU is done with
+// the copy. The CPU only reads the buffer once the fence signaled (usually a frame later), so picking never stalls.
+class ObjectPicker
+{
+public:
+	// What was under a pixel
+	struct Result
+	{
+		// ID the draw was given (0 is the background or anything that can't be picked) and its triangle
+		unsigned int object = 0;
+		unsigned int primitive = 0;
+		// Pixel that was read (in window coordinates) and how long it took until the CPU had it
+		int x = 0;
+		int y = 0;
+		unsigned int frames = 0;
+		double latencyMs = 0.0;
+	};
+
+	// Texture with the object and the triangle of every pixel
+	GLuint texture = 0;
+
+	// Makes the ID texture and attaches it to the bound framebuffer as color attachment 'index', which has to be
+	// draw buffer 'index' of the framebuffer as well
+	ObjectPicker(int width, int height, unsigned int index);
+
+	// Bytes the ID texture takes up
+	size_t Bytes();
+	// Sets every pixel of the ID texture to 0 (glClear leaves integer attachments undefined), the framebuffer has to be bound
+	void Clear();
+	// Copies a pixel of the bound framebuffer (in window coordinates, y pointing down) into the next free pixel buffer,
+	// returns false if the pixel is outside or all the buffers are still in flight
+	bool Request(double x, double y);
+	// Checks the oldest request without waiting and returns true with what was under it once the GPU finished the copy
+	bool Poll(Result& result);
+	// Counts the frames the latency of a request is measured in (call this once per frame)
+	void EndFrame();
+	// Deletes the texture, the pixel buffers and the fences
+	void Delete();
+
+private:
+	// A request that is in flight
+	struct Slot
+	{
+		GLuint buffer;
+		GLsync fence;
+		int x;
+		int y;
+		unsigned long long frame;
+		double time;
+	};
+	// Requests that can be in flight at once, one more than the frames the GPU can fall behind
+	static const unsigned int slotCount = 4;
+
+	int width;
+	int height;
+	unsigned int index;
+	Slot slots[slotCount] = {};
+	// Oldest request and how many are in flight, they come back in the order they were made
+	unsigned int first = 0;
+	unsigned int pending = 0;
+	unsigned long long frame = 0;
+};
+#endif
\ No newline at end of file
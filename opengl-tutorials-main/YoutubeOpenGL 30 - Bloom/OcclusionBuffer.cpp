@@ -0,0 +1,247 @@
+#include"OcclusionBuffer.h"
+
+#include<chrono>
+#include<algorithm>
+#include<cmath>
+
+// Four pixels at a time whenever the compiler is allowed to use SSE
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<xmmintrin.h>
+#define OCCLUSION_SSE 1
+#else
+#define OCCLUSION_SSE 0
+#endif
+
+bool OcclusionBuffer::enabled = true;
+
+// Anything closer to the camera's plane than this can't be divided by w safely
+static const float minW = 1e-5f;
+
+// Makes a buffer of width x height pixels (width gets rounded up to a multiple of 4) rasterized by the given number of threads
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height, unsigned int threads)
+{
+	OcclusionBuffer::width = (width + 3) & ~3u;
+	OcclusionBuffer::height = height;
+	OcclusionBuffer::threads = std::max(threads, 1u);
+	pool = std::make_unique<WorkerPool>(OcclusionBuffer::threads);
+	depth.assign(OcclusionBuffer::width * height, 1.0f);
+}
+
+// Clears the depth and the occluders and sets the camera matrix (projection * view) of the frame
+void OcclusionBuffer::Begin(const glm::mat4& cameraMatrix)
+{
+	OcclusionBuffer::cameraMatrix = cameraMatrix;
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	triangles.clear();
+	stats = Stats();
+}
+
+// Moves an occluder to world space with a model matrix and queues its triangles
+void OcclusionBuffer::Add(const Occluder& occluder, const glm::mat4& matrix)
+{
+	glm::mat4 toClip = cameraMatrix * matrix;
+	clipPositions.resize(occluder.positions.size());
+	for (unsigned int i = 0; i < occluder.positions.size(); i++)
+		clipPositions[i] = toClip * glm::vec4(occluder.positions[i], 1.0f);
+	for (unsigned int i = 0; i + 2 < occluder.indices.size(); i += 3)
+		setup(clipPositions[occluder.indices[i]], clipPositions[occluder.indices[i + 1]], clipPositions[occluder.indices[i + 2]]);
+	stats.occluders++;
+}
+
+// Sets a triangle up and queues it unless it is degenerate, off screen or crosses the near plane
+void OcclusionBuffer::setup(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+	// Clipping would only make the occluder smaller, skipping the triangle is just as safe and a lot simpler
+	if (a.w < minW || b.w < minW || c.w < minW)
+		return;
+
+	// Screen space positions with the depth in z
+	glm::vec3 v[3] = { glm::vec3(a) / a.w, glm::vec3(b) / b.w, glm::vec3(c) / c.w };
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		v[i].x = (v[i].x * 0.5f + 0.5f) * width;
+		v[i].y = (v[i].y * 0.5f + 0.5f) * height;
+	}
+	float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+	if (area == 0.0f)
+		return;
+	// Occluders count from both sides, so clockwise triangles just get turned around
+	if (area < 0.0f)
+	{
+		std::swap(v[1], v[2]);
+		area = -area;
+	}
+
+	Triangle triangle;
+	triangle.minX = std::max(0, (int)std::floor(std::min(std::min(v[0].x, v[1].x), v[2].x)));
+	triangle.maxX = std::min((int)width - 1, (int)std::ceil(std::max(std::max(v[0].x, v[1].x), v[2].x)));
+	triangle.minY = std::max(0, (int)std::floor(std::min(std::min(v[0].y, v[1].y), v[2].y)));
+	triangle.maxY = std::min((int)height - 1, (int)std::ceil(std::max(std::max(v[0].y, v[1].y), v[2].y)));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return;
+	// Start at a multiple of 4 so the rows can be filled four pixels at a time without running past the end
+	triangle.minX &= ~3;
+
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		const glm::vec3& from = v[i];
+		const glm::vec3& to = v[(i + 1) % 3];
+		triangle.edgeA[i] = from.y - to.y;
+		triangle.edgeB[i] = to.x - from.x;
+		triangle.edgeC[i] = -(triangle.edgeA[i] * from.x + triangle.edgeB[i] * from.y);
+	}
+	triangle.depthX = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+	triangle.depthY = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+	triangle.depthC = v[0].z - triangle.depthX * v[0].x - triangle.depthY * v[0].y;
+	triangles.push_back(triangle);
+}
+
+// Rasterizes the queued triangles, every thread fills its own band of rows
+void OcclusionBuffer::Rasterize()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	stats.triangles = (unsigned int)triangles.size();
+
+	// The bands don't share any pixels, so the threads never have to wait for each other
+	unsigned int bands = std::min(threads, height);
+	unsigned int rows = (height + bands - 1) / bands;
+	pool->Run(bands, [this, rows](unsigned int band)
+	{
+		rasterizeBand((int)(band * rows), (int)std::min(height, (band + 1) * rows));
+	});
+
+	stats.rasterMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Rasterizes every triangle into the rows from minY up to (but not including) maxY
+void OcclusionBuffer::rasterizeBand(int minY, int maxY)
+{
+	for (unsigned int t = 0; t < triangles.size(); t++)
+	{
+		const Triangle& triangle = triangles[t];
+		int firstRow = std::max(minY, triangle.minY);
+		int lastRow = std::min(maxY - 1, triangle.maxY);
+		for (int y = firstRow; y <= lastRow; y++)
+		{
+			// Everything is sampled at the centers of the pixels
+			float py = y + 0.5f;
+			float* row = &depth[y * width];
+			float rowEdge[3];
+			for (unsigned int i = 0; i < 3; i++)
+				rowEdge[i] = triangle.edgeB[i] * py + triangle.edgeC[i];
+			float rowDepth = triangle.depthY * py + triangle.depthC;
+#if OCCLUSION_SSE
+			__m128 zero = _mm_setzero_ps();
+			__m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			for (int x = triangle.minX; x <= triangle.maxX; x += 4)
+			{
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+				__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[0]), px), _mm_set1_ps(rowEdge[0])), zero);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[1]), px), _mm_set1_ps(rowEdge[1])), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[2]), px), _mm_set1_ps(rowEdge[2])), zero));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+				__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.depthX), px), _mm_set1_ps(rowDepth));
+				__m128 old = _mm_loadu_ps(row + x);
+				__m128 closer = _mm_min_ps(old, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, old)));
+			}
+#else
+			for (int x = triangle.minX; x <= triangle.maxX; x++)
+			{
+				float px = x + 0.5f;
+				if (triangle.edgeA[0] * px + rowEdge[0] < 0.0f || triangle.edgeA[1] * px + rowEdge[1] < 0.0f || triangle.edgeA[2] * px + rowEdge[2] < 0.0f)
+					continue;
+				row[x] = std::min(row[x], triangle.depthX * px + rowDepth);
+			}
+#endif
+		}
+	}
+}
+
+// Tells if a world space box might be visible, false means it is completely behind the occluders
+bool OcclusionBuffer::Test(const AABB& box)
+{
+	stats.tested++;
+
+	// Screen rectangle and closest depth of the box
+	glm::vec2 minScreen = glm::vec2(FLT_MAX);
+	glm::vec2 maxScreen = glm::vec2(-FLT_MAX);
+	float nearest = FLT_MAX;
+	bool visible = false;
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner = glm::vec3(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z);
+		glm::vec4 clip = cameraMatrix * glm::vec4(corner, 1.0f);
+		// A box that reaches behind the camera covers the whole screen and is always in front of something
+		if (clip.w < minW)
+		{
+			visible = true;
+			break;
+		}
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		minScreen = glm::min(minScreen, glm::vec2(ndc));
+		maxScreen = glm::max(maxScreen, glm::vec2(ndc));
+		nearest = std::min(nearest, ndc.z);
+	}
+
+	if (!visible)
+	{
+		int minX = std::max(0, (int)std::floor((minScreen.x * 0.5f + 0.5f) * width)) & ~3;
+		int maxX = std::min((int)width - 1, (int)std::floor((maxScreen.x * 0.5f + 0.5f) * width));
+		int minY = std::max(0, (int)std::floor((minScreen.y * 0.5f + 0.5f) * height));
+		int maxY = std::min((int)height - 1, (int)std::floor((maxScreen.y * 0.5f + 0.5f) * height));
+		// Off screen boxes are the frustum's business, they don't count as hidden
+		visible = minX > maxX || minY > maxY;
+		// The box is hidden only if every pixel it covers already holds something closer
+		for (int y = minY; y <= maxY && !visible; y++)
+		{
+			const float* row = &depth[y * width];
+#if OCCLUSION_SSE
+			__m128 boxDepth = _mm_set1_ps(nearest);
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth)) != 0)
+				{
+					visible = true;
+					break;
+				}
+			}
+#else
+			for (int x = minX; x <= maxX; x++)
+			{
+				if (row[x] >= nearest)
+				{
+					visible = true;
+					break;
+				}
+			}
+#endif
+		}
+	}
+
+	if (!visible)
+		stats.occluded++;
+	return visible;
+}
+
+// Depth of every pixel (-1 near to 1 far), row by row from the bottom of the screen
+const std::vector<float>& OcclusionBuffer::Depth()
+{
+	return depth;
+}
+
+unsigned int OcclusionBuffer::Width()
+{
+	return width;
+}
+
+unsigned int OcclusionBuffer::Height()
+{
+	return height;
+}
+
+OcclusionBuffer::Stats OcclusionBuffer::GetStats()
+{
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef OCCLUSION_BUFFER_CLASS_H
+#define OCCLUSION_BUFFER_CLASS_H
+
+#include<vector>
+#include<memory>
+
+#include"Frustum.h"
+#include"WorkerPool.h"
+
+// Small depth buffer that a few big occluders get rasterized into on the CPU, so that boxes hidden behind them can be
+// dropped before they ever reach OpenGL. It only needs glm and the standard library, so it works without a GPU.
+class OcclusionBuffer
+{
+public:
+	// Triangles of a mesh in its own space, made once and rasterized with a different matrix every frame
+	struct Occluder
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> indices;
+	};
+	// What the last frame cost and how much it hid
+	struct Stats
+	{
+		unsigned int occluders = 0;
+		unsigned int triangles = 0;
+		unsigned int tested = 0;
+		unsigned int occluded = 0;
+		double rasterMs = 0.0;
+	};
+
+	// Turn this off to draw everything, even what is hidden behind the occluders
+	static bool enabled;
+
+	// Makes a buffer of width x height pixels (width gets rounded up to a multiple of 4) rasterized by the given number of threads
+	OcclusionBuffer(unsigned int width = 256, unsigned int height = 128, unsigned int threads = 4);
+
+	// Clears the depth and the occluders and sets the camera matrix (projection * view) of the frame
+	void Begin(const glm::mat4& cameraMatrix);
+	// Moves an occluder to world space with a model matrix and queues its triangles
+	void Add(const Occluder& occluder, const glm::mat4& matrix = glm::mat4(1.0f));
+	// Rasterizes the queued triangles, every thread fills its own band of rows
+	void Rasterize();
+	// Tells if a world space box might be visible, false means it is completely behind the occluders
+	bool Test(const AABB& box);
+
+	// Depth of every pixel (-1 near to 1 far), row by row from the bottom of the screen
+	const std::vector<float>& Depth();
+	unsigned int Width();
+	unsigned int Height();
+	Stats GetStats();
+
+private:
+	// Triangle in screen space, set up so every pixel only needs a few multiply adds
+	struct Triangle
+	{
+		// Edge functions A * x + B * y + C, positive inside of the triangle
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		// Depth plane z = depthX * x + depthY * y + depthC
+		float depthX;
+		float depthY;
+		float depthC;
+		// Pixels the triangle may touch
+		int minX, maxX, minY, maxY;
+	};
+
+	unsigned int width;
+	unsigned int height;
+	unsigned int threads;
+	// Workers that rasterize the bands, started once with the buffer
+	std::unique_ptr<WorkerPool> pool;
+	glm::mat4 cameraMatrix = glm::mat4(1.0f);
+	std::vector<float> depth;
+	std::vector<Triangle> triangles;
+	// Clip space corners of the occluder being added, kept around to reuse the memory
+	std::vector<glm::vec4> clipPositions;
+	Stats stats;
+
+	// Sets a triangle up and queues it unless it is degenerate, off screen or crosses the near plane
+	void setup(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+	// Rasterizes every triangle into the rows from minY up to (but not including) maxY
+	void rasterizeBand(int minY, int maxY);
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include"OcclusionQueries.h"
+
+bool OcclusionQueries::enabled = true;
+
+// Corners and faces of the cube from -1 to 1 that gets stretched over the boxes
+static std::vector<Vertex> cube_vertices()
+{
+	std::vector<Vertex> vertices;
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner = glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+		vertices.push_back(Vertex{ corner, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec2(0.0f) });
+	}
+	return vertices;
+}
+
+static std::vector<GLuint> cube_indices()
+{
+	return std::vector<GLuint>
+	{
+		0, 1, 3, 0, 3, 2,
+		4, 6, 7, 4, 7, 5,
+		0, 4, 5, 0, 5, 1,
+		2, 3, 7, 2, 7, 6,
+		0, 2, 6, 0, 6, 4,
+		1, 5, 7, 1, 7, 3
+	};
+}
+
+// Occlusion queries and conditional rendering need OpenGL 3.3, conservative queries are used with OpenGL 4.3
+bool OcclusionQueries::Supported()
+{
+	return GLAD_GL_VERSION_3_3;
+}
+
+// Builds the shader and the cube the boxes are drawn with
+OcclusionQueries::OcclusionQueries() : boxShader("occlusion.vert", "occlusion.frag")
+{
+	// Conservative queries may say a box is visible when it isn't, which is fine here and cheaper for the GPU
+	target = GLAD_GL_VERSION_4_3 ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+
+	std::vector<Vertex> vertices = cube_vertices();
+	std::vector<GLuint> indices = cube_indices();
+	boxVAO.Bind();
+	boxVBO = VBO(vertices);
+	boxEBO = EBO(indices);
+	boxVAO.LinkAttrib(boxVBO, 0, 3, GL_FLOAT, sizeof(Vertex), (void*)0);
+	boxVAO.BindElementBuffer(boxEBO);
+	boxVAO.Unbind();
+
+	glGenQueries(timerCount, timers);
+}
+
+// Starts a frame
+void OcclusionQueries::Begin(Camera& camera)
+{
+	OcclusionQueries::camera = &camera;
+	pending.clear();
+
+	// The oldest timer was ended a few frames ago, so its result is there unless the GPU fell that far behind
+	unsigned int slot = frame % timerCount;
+	GLuint timer = timers[slot];
+	if (frame >= timerCount)
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(timer, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &elapsed);
+			// The counters of the frame the timer measured, not of the frame that just ended
+			lastStats = frameStats[slot];
+			lastStats.gpuMs = elapsed / 1000000.0;
+		}
+	}
+	stats = Stats();
+	glBeginQuery(GL_TIME_ELAPSED, timer);
+}
+
+// Draws a mesh if its box was visible last frame, the ID has to stay the same for the same draw between frames
+void OcclusionQueries::Draw(unsigned int id, Mesh& mesh, Shader& shader, glm::mat4 matrix)
+{
+	if (Frustum::enabled && !camera->frustum.Test(mesh.bounds, matrix))
+		return;
+	stats.draws++;
+
+	// Grow the box a little so flat meshes don't hide themselves behind their own depth
+	glm::vec3 extents = mesh.bounds.Extents() * 1.01f + 0.01f;
+	glm::mat4 box = matrix * glm::translate(glm::mat4(1.0f), mesh.bounds.Center()) * glm::scale(glm::mat4(1.0f), extents);
+	// A camera inside of the box would only see its back faces, so the box can't tell anything about the mesh
+	glm::vec3 local = glm::vec3(glm::inverse(box) * glm::vec4(camera->Position, 1.0f));
+	bool inside = glm::all(glm::lessThanEqual(glm::abs(local), glm::vec3(1.0f)));
+
+	Query& query = queries.emplace(id, Query{ 0, false }).first->second;
+	if (query.query == 0)
+		glGenQueries(1, &query.query);
+	bool conditional = enabled && query.issued && !inside;
+	if (conditional)
+	{
+		if (countHidden)
+		{
+			GLint available = 0;
+			glGetQueryObjectiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+			GLint passed = 1;
+			if (available)
+				glGetQueryObjectiv(query.query, GL_QUERY_RESULT, &passed);
+			if (!passed)
+				stats.hidden++;
+		}
+		glBeginConditionalRender(query.query, GL_QUERY_NO_WAIT);
+	}
+	mesh.Draw(shader, *camera, matrix);
+	if (conditional)
+		glEndConditionalRender();
+
+	if (inside)
+		query.issued = false;
+	else
+		pending.push_back(Pending{ id, box });
+}
+
+// Tests the boxes of this frame's draws against the depth buffer for the next frame
+void OcclusionQueries::End()
+{
+	if (enabled && !pending.empty())
+	{
+		// The boxes must not show up or change the depth, and both of their sides count
+		StateCache::RasterState previous = StateCache::GetRasterState();
+		StateCache::ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		StateCache::DepthMask(GL_FALSE);
+		StateCache::DepthFunc(GL_LEQUAL);
+		StateCache::Disable(GL_CULL_FACE);
+		boxShader.Activate();
+		camera->Matrix(boxShader, "camMatrix");
+		GLint boxLocation = glGetUniformLocation(boxShader.ID, "box");
+		StateCache::BindVertexArray(boxVAO.ID);
+		for (unsigned int i = 0; i < pending.size(); i++)
+		{
+			Query& query = queries[pending[i].id];
+			glUniformMatrix4fv(boxLocation, 1, GL_FALSE, glm::value_ptr(pending[i].box));
+			glBeginQuery(target, query.query);
+			glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (void*)0);
+			glEndQuery(target);
+			query.issued = true;
+		}
+		stats.queries = (unsigned int)pending.size();
+		// Put back whatever the caller had set up
+		StateCache::SetRasterState(previous);
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	frameStats[frame % timerCount] = stats;
+	frame++;
+}
+
+// Stats of the last frame whose GPU time came back
+OcclusionQueries::Stats OcclusionQueries::LastStats()
+{
+	return lastStats;
+}
+
+// Deletes the queries, the shader and the cube
+void OcclusionQueries::Delete()
+{
+	for (std::unordered_map<unsigned int, Query>::iterator it = queries.begin(); it != queries.end(); it++)
+		glDeleteQueries(1, &it->second.query);
+	queries.clear();
+	if (timers[0] != 0)
+		glDeleteQueries(timerCount, timers);
+	for (unsigned int i = 0; i < timerCount; i++)
+		timers[i] = 0;
+	boxShader.Delete();
+	boxVAO.Delete();
+	boxVBO.Delete();
+	boxEBO.Delete();
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef OCCLUSION_QUERIES_CLASS_H
+#define OCCLUSION_QUERIES_CLASS_H
+
+#include<unordered_map>
+
+#include"Mesh.h"
+
+// Draws expensive meshes with conditional rendering: every mesh gets the box around it tested with an occlusion query
+// at the end of the frame, and the next frame only draws it if some of that box was visible. The GPU reads the
+// result of the query on its own, so the CPU never waits for it (a result that isn't ready yet just draws the mesh).
+class OcclusionQueries
+{
+public:
+	// What the last finished frame cost
+	struct Stats
+	{
+		// Meshes that were drawn conditionally and boxes that were tested for the next frame
+		unsigned int draws = 0;
+		unsigned int queries = 0;
+		// Meshes whose box was hidden last frame (only counted while countHidden is set)
+		unsigned int hidden = 0;
+		// GPU time of everything between Begin and End, a few frames old so reading it never stalls
+		double gpuMs = 0.0;
+	};
+
+	// Turn this off to draw every mesh without waiting for its query
+	static bool enabled;
+	// Reads back the results that are already available to count the hidden meshes (costs a bit of driver time)
+	bool countHidden = false;
+
+	// Occlusion queries and conditional rendering need OpenGL 3.3, conservative queries are used with OpenGL 4.3
+	static bool Supported();
+
+	// Builds the shader and the cube the boxes are drawn with
+	OcclusionQueries();
+
+	// Starts a frame
+	void Begin(Camera& camera);
+	// Draws a mesh if its box was visible last frame, the ID has to stay the same for the same draw between frames
+	void Draw(unsigned int id, Mesh& mesh, Shader& shader, glm::mat4 matrix = glm::mat4(1.0f));
+	// Tests the boxes of this frame's draws against the depth buffer for the next frame
+	void End();
+	// Stats of the last frame whose GPU time came back, the counters are from that same frame
+	Stats LastStats();
+	// Deletes the queries, the shader and the cube
+	void Delete();
+
+private:
+	struct Query
+	{
+		GLuint query;
+		// Set once a box was tested, until then the mesh always gets drawn
+		bool issued;
+	};
+	// Box that gets tested at the end of the frame
+	struct Pending
+	{
+		unsigned int id;
+		glm::mat4 box;
+	};
+	// Timer queries in flight, one more than the frames the GPU can fall behind
+	static const unsigned int timerCount = 4;
+
+	Camera* camera = NULL;
+	std::unordered_map<unsigned int, Query> queries;
+	std::vector<Pending> pending;
+	GLenum target;
+	Shader boxShader;
+	VAO boxVAO;
+	VBO boxVBO;
+	EBO boxEBO;
+	GLuint timers[timerCount] = {};
+	unsigned long long frame = 0;
+	Stats stats;
+	// Counters of the frames whose timers are still in flight, in the same slot as their timer
+	Stats frameStats[timerCount];
+	Stats lastStats;
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include"RenderQueue.h"
+
+#include<chrono>
+#include<algorithm>
+
+// Empties the queue and remembers the camera so the depth of new draws can be computed
+void RenderQueue::Begin(Camera& camera)
+{
+	RenderQueue::camera = &camera;
+	draws.clear();
+	items.clear();
+	boxes.Clear();
+	// Meshes that are gone stay in the maps, once the IDs don't fit into the key anymore they get handed out again
+	if (meshIDs.size() > 0xFFF || materialIDs.size() > 0xFFF)
+	{
+		meshIDs.clear();
+		materialIDs.clear();
+	}
+}
+
+// Queues a mesh to be drawn with a shader and a model matrix
+void RenderQueue::Submit(Mesh& mesh, Shader& shader, glm::mat4 matrix, bool translucent, unsigned int pass, unsigned int objectID)
+{
+	// Hand out IDs the first time something is seen, they wrap around instead of overflowing the key
+	unsigned int program = programIDs.emplace(&shader, (unsigned int)programIDs.size()).first->second & 0x3FF;
+	MeshIDs ids = getMeshIDs(mesh);
+	unsigned int material = ids.material & 0xFFF;
+	unsigned int meshID = ids.mesh & 0xFFF;
+
+	// Depth is the distance from the camera to the origin of the draw, squeezed into 25 bits
+	float distance = glm::length(glm::vec3(matrix[3]) - camera->Position);
+	uint64_t depth = (uint64_t)(glm::clamp(distance / maxDepth, 0.0f, 1.0f) * 0x1FFFFFF);
+
+	uint64_t key = (uint64_t)(pass & 0xF) << 60;
+	if (!translucent)
+	{
+		key |= (uint64_t)program << 49;
+		key |= (uint64_t)material << 37;
+		key |= (uint64_t)meshID << 25;
+		key |= depth;
+	}
+	else
+	{
+		key |= (uint64_t)1 << 59;
+		key |= (0x1FFFFFF - depth) << 34;
+		key |= (uint64_t)program << 24;
+		key |= (uint64_t)material << 12;
+		key |= (uint64_t)meshID;
+	}
+
+	items.push_back(SortItem{ key, (unsigned int)draws.size() });
+	draws.push_back(Draw{ &mesh, &shader, matrix, objectID });
+	boxes.Add(mesh.bounds, matrix);
+}
+
+// Sorts the queued draws and draws them
+void RenderQueue::Execute()
+{
+	stats = Stats();
+	stats.submitted = (unsigned int)items.size();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (Frustum::enabled || (occlusion != NULL && OcclusionBuffer::enabled))
+		cull();
+	std::chrono::steady_clock::time_point culled = std::chrono::steady_clock::now();
+	radixSort();
+	buildBatches();
+	uploadInstances();
+	std::chrono::steady_clock::time_point sorted = std::chrono::steady_clock::now();
+
+	// Only touch the state that actually differs from the previous draw
+	Shader* lastShader = NULL;
+	Mesh* lastMesh = NULL;
+	unsigned int lastMaterial = 0xFFFFFFFF;
+	// Location of the ID uniform of the program in use, looked up with the camera uniforms instead of for every draw
+	GLint objectIDLocation = -1;
+	for (unsigned int i = 0; i < batches.size(); i++)
+	{
+		Batch& batch = batches[i];
+		Draw& draw = draws[items[batch.first].draw];
+		// Instanced batches draw with the instanced version of the shader
+		Shader* shader = batch.count > 1 ? instancedShaders[draw.shader] : draw.shader;
+		if (shader != lastShader)
+		{
+			shader->Activate();
+			// The camera uniforms only have to be set once per program
+			glUniform3f(glGetUniformLocation(shader->ID, "camPos"), camera->Position.x, camera->Position.y, camera->Position.z);
+			camera->Matrix(*shader, "camMatrix");
+			objectIDLocation = glGetUniformLocation(shader->ID, "objectID");
+			lastShader = shader;
+			lastMaterial = 0xFFFFFFFF;
+			stats.programChanges++;
+		}
+		unsigned int material = getMeshIDs(*draw.mesh).material;
+		if (material != lastMaterial)
+		{
+			draw.mesh->BindTextures(*shader);
+			lastMaterial = material;
+			stats.materialChanges++;
+		}
+		if (draw.mesh != lastMesh)
+		{
+			lastMesh = draw.mesh;
+			stats.meshChanges++;
+		}
+
+		if (batch.count == 1)
+		{
+			glUniform1ui(objectIDLocation, draw.objectID);
+			draw.mesh->DrawGeometry(*shader, draw.matrix);
+		}
+		else
+		{
+			// Point the instance attributes of the mesh at the batch's matrices, a mat4 takes up four attributes
+			draw.mesh->Bind();
+			StateCache::BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+			for (unsigned int column = 0; column < 4; column++)
+			{
+				glEnableVertexAttribArray(4 + column);
+				glVertexAttribPointer(4 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(batch.offset + column * sizeof(glm::vec4)));
+				glVertexAttribDivisor(4 + column, 1);
+			}
+			// IDs stay integers all the way to the shader
+			glEnableVertexAttribArray(10);
+			glVertexAttribIPointer(10, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)(instanceIDsOffset + batch.idOffset));
+			glVertexAttribDivisor(10, 1);
+			glDrawElementsInstanced(GL_TRIANGLES, draw.mesh->indexCount, GL_UNSIGNED_INT, (void*)draw.mesh->indexBuffer.offset, batch.count);
+			// The VAO may be shared with meshes that don't draw instanced (see VAOCache), so it gets left the way it was found
+			for (unsigned int attribute : { 4u, 5u, 6u, 7u, 10u })
+			{
+				glVertexAttribDivisor(attribute, 0);
+				glDisableVertexAttribArray(attribute);
+			}
+			stats.instancedDraws++;
+			stats.instances += batch.count;
+		}
+		stats.draws++;
+	}
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	stats.cullMs = std::chrono::duration<double, std::milli>(culled - start).count();
+	stats.sortMs = std::chrono::duration<double, std::milli>(sorted - culled).count();
+	stats.submitMs = std::chrono::duration<double, std::milli>(end - sorted).count();
+}
+
+// Stats of the last call to Execute
+RenderQueue::Stats RenderQueue::LastStats()
+{
+	return stats;
+}
+
+// Lets draws with shader be merged and drawn with instancedShader, which reads the model matrix from attributes 4 to 7
+void RenderQueue::SetInstancedShader(Shader& shader, Shader& instancedShader)
+{
+	instancedShaders[&shader] = &instancedShader;
+}
+
+// Deletes the instance buffer
+void RenderQueue::Delete()
+{
+	if (instanceBuffer == 0)
+		return;
+	StateCache::ForgetBuffer(instanceBuffer);
+	glDeleteBuffers(1, &instanceBuffer);
+	instanceBuffer = 0;
+	instanceBufferSize = 0;
+}
+
+// Removes the items whose boxes are outside of the camera's frustum or hidden behind the occluders
+void RenderQueue::cull()
+{
+	if (Frustum::enabled)
+		camera->frustum.Test(boxes, visible);
+	else
+		visible.assign(boxes.Size(), 1);
+	bool occlusionTest = occlusion != NULL && OcclusionBuffer::enabled;
+	// Items still point at their draws by index, so only the items have to be packed
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < items.size(); i++)
+	{
+		unsigned int draw = items[i].draw;
+		if (!visible[draw])
+			continue;
+		// The occlusion test is a lot more expensive, so it only sees what the frustum let through
+		if (occlusionTest)
+		{
+			glm::vec3 center = glm::vec3(boxes.centerX[draw], boxes.centerY[draw], boxes.centerZ[draw]);
+			glm::vec3 extents = glm::vec3(boxes.extentX[draw], boxes.extentY[draw], boxes.extentZ[draw]);
+			AABB box;
+			box.Add(center - extents);
+			box.Add(center + extents);
+			if (!occlusion->Test(box))
+			{
+				stats.occluded++;
+				continue;
+			}
+		}
+		items[kept++] = items[i];
+	}
+	stats.culled = (unsigned int)items.size() - kept - stats.occluded;
+	items.resize(kept);
+}
+
+// Gets (or hands out) the IDs of a mesh and its material
+RenderQueue::MeshIDs RenderQueue::getMeshIDs(Mesh& mesh)
+{
+	std::unordered_map<unsigned long long, MeshIDs>::iterator found = meshIDs.find(mesh.serial);
+	if (found != meshIDs.end())
+		return found->second;
+
+	// Meshes that use the exact same textures share a material
+	std::vector<GLuint> textureIDs;
+	for (unsigned int i = 0; i < mesh.textures.size(); i++)
+		textureIDs.push_back(mesh.textures[i]->ID);
+	unsigned int material = materialIDs.emplace(textureIDs, (unsigned int)materialIDs.size()).first->second;
+
+	MeshIDs ids = { (unsigned int)meshIDs.size(), material };
+	meshIDs[mesh.serial] = ids;
+	return ids;
+}
+
+// Sorts the items by their keys with a least significant digit radix sort, one byte per pass
+void RenderQueue::radixSort()
+{
+	if (items.size() < 2)
+		return;
+	scratch.resize(items.size());
+	for (unsigned int shift = 0; shift < 64; shift += 8)
+	{
+		// Count how many keys have each value of this byte
+		unsigned int offsets[256] = { 0 };
+		for (unsigned int i = 0; i < items.size(); i++)
+			offsets[(items[i].key >> shift) & 0xFF]++;
+		// Bytes every key agrees on (like unused passes) don't need a pass
+		if (offsets[(items[0].key >> shift) & 0xFF] == items.size())
+			continue;
+
+		// Turn the counts into the position where each value starts
+		unsigned int total = 0;
+		for (unsigned int i = 0; i < 256; i++)
+		{
+			unsigned int count = offsets[i];
+			offsets[i] = total;
+			total += count;
+		}
+		// Scatter the items, keeping the order of equal bytes so the earlier passes stay sorted
+		for (unsigned int i = 0; i < items.size(); i++)
+			scratch[offsets[(items[i].key >> shift) & 0xFF]++] = items[i];
+		items.swap(scratch);
+	}
+}
+
+// Splits the sorted items into batches and gathers the matrices and IDs of the instanced ones
+void RenderQueue::buildBatches()
+{
+	batches.clear();
+	instanceMatrices.clear();
+	instanceIDs.clear();
+	unsigned int i = 0;
+	while (i < items.size())
+	{
+		// Sorting put equal meshes with equal shaders (and so equal materials) right after each other
+		Draw& draw = draws[items[i].draw];
+		unsigned int end = i + 1;
+		while (end < items.size() && draws[items[end].draw].mesh == draw.mesh && draws[items[end].draw].shader == draw.shader)
+			end++;
+
+		bool merge = instancing && end - i > 1 && end - i >= minInstances && instancedShaders.count(draw.shader) > 0;
+		if (merge)
+		{
+			batches.push_back(Batch{ i, end - i, (GLintptr)(instanceMatrices.size() * sizeof(glm::mat4)), (GLintptr)(instanceIDs.size() * sizeof(GLuint)) });
+			for (unsigned int j = i; j < end; j++)
+			{
+				instanceMatrices.push_back(draws[items[j].draw].matrix);
+				instanceIDs.push_back(draws[items[j].draw].objectID);
+			}
+		}
+		else
+		{
+			for (unsigned int j = i; j < end; j++)
+				batches.push_back(Batch{ j, 1, 0, 0 });
+		}
+		i = end;
+	}
+}
+
+// Orphans the instance buffer and fills it with this frame's matrices followed by their IDs
+void RenderQueue::uploadInstances()
+{
+	if (instanceMatrices.empty())
+		return;
+	if (instanceBuffer == 0)
+		glGenBuffers(1, &instanceBuffer);
+
+	StateCache::BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	instanceIDsOffset = instanceMatrices.size() * sizeof(glm::mat4);
+	GLsizeiptr size = instanceIDsOffset + instanceIDs.size() * sizeof(GLuint);
+	// Grow by doubling, otherwise hand the old storage back to the driver so the GPU can keep reading last frame's
+	if (size > instanceBufferSize)
+		instanceBufferSize = std::max(size, instanceBufferSize * 2);
+	glBufferData(GL_ARRAY_BUFFER, instanceBufferSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, instanceIDsOffset, instanceMatrices.data());
+	glBufferSubData(GL_ARRAY_BUFFER, instanceIDsOffset, instanceIDs.size() * sizeof(GLuint), instanceIDs.data());
+}
\ No newline at end of file
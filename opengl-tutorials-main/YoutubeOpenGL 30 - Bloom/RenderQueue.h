@@ -0,0 +1,131 @@
+#ifndef RENDER_QUEUE_CLASS_H
+#define RENDER_QUEUE_CLASS_H
+
+#include<cstdint>
+#include<unordered_map>
+#include<map>
+
+#include"Mesh.h"
+
+// Collects draws during a frame and executes them sorted so that programs, materials and meshes switch as little as possible.
+// Every draw gets a 64 bit key, the top bits are compared first:
+//   opaque:      pass(4) | 0 | program(10) | material(12) | mesh(12) | depth(25)   -> state first, then front to back
+//   translucent: pass(4) | 1 | inverted depth(25) | program(10) | material(12) | mesh(12)   -> back to front, then state
+// Draws of the same mesh and shader that end up next to each other after sorting can be merged into a single
+// instanced draw, their model matrices and object IDs get streamed through a buffer that is refilled every frame.
+class RenderQueue
+{
+public:
+	// What executing the queue cost
+	struct Stats
+	{
+		// Draws that were submitted and draw calls that reached OpenGL after merging
+		unsigned int submitted = 0;
+		unsigned int draws = 0;
+		// Submitted draws that were outside of the frustum or hidden behind the occluders
+		unsigned int culled = 0;
+		unsigned int occluded = 0;
+		// How many of the draw calls were instanced and how many submitted draws they covered
+		unsigned int instancedDraws = 0;
+		unsigned int instances = 0;
+		unsigned int programChanges = 0;
+		unsigned int materialChanges = 0;
+		unsigned int meshChanges = 0;
+		// CPU time spent culling, sorting and issuing the draws
+		double cullMs = 0.0;
+		double sortMs = 0.0;
+		double submitMs = 0.0;
+	};
+
+	// Distance that maps to the largest depth key, anything further away gets clamped
+	float maxDepth = 100.0f;
+	// Turn off to issue every submitted draw on its own
+	bool instancing = true;
+	// Fewest draws worth merging into an instanced draw
+	unsigned int minInstances = 2;
+	// Draws whose boxes are hidden in this buffer get dropped as well (it has to be rasterized before Execute, NULL skips the test)
+	OcclusionBuffer* occlusion = NULL;
+
+	// Empties the queue and remembers the camera so the depth of new draws can be computed
+	void Begin(Camera& camera);
+	// Queues a mesh to be drawn with a shader and a model matrix, objectID is what the draw writes into the ID buffer (0 can't be picked)
+	void Submit(Mesh& mesh, Shader& shader, glm::mat4 matrix = glm::mat4(1.0f), bool translucent = false, unsigned int pass = 0, unsigned int objectID = 0);
+	// Drops the queued draws that are outside of the frustum (see Frustum::enabled) or hidden behind the occluders
+	// (see OcclusionBuffer::enabled), sorts the rest and draws them
+	void Execute();
+	// Stats of the last call to Execute
+	Stats LastStats();
+	// Lets draws with shader be merged and drawn with instancedShader, which reads the model matrix from attributes 4 to 7
+	// and the object ID from attribute 10
+	void SetInstancedShader(Shader& shader, Shader& instancedShader);
+	// Deletes the instance buffer
+	void Delete();
+
+private:
+	struct Draw
+	{
+		Mesh* mesh;
+		Shader* shader;
+		glm::mat4 matrix;
+		unsigned int objectID;
+	};
+	// Only the key and where the draw is get moved around while sorting
+	struct SortItem
+	{
+		uint64_t key;
+		unsigned int draw;
+	};
+	// Sorted items that get drawn with a single draw call
+	struct Batch
+	{
+		unsigned int first;
+		unsigned int count;
+		// Where the matrices of an instanced batch start in the instance buffer and where its IDs start after all the matrices
+		GLintptr offset;
+		GLintptr idOffset;
+	};
+	// Small numbers given to meshes so they fit into the key
+	struct MeshIDs
+	{
+		unsigned int mesh;
+		unsigned int material;
+	};
+
+	Camera* camera = NULL;
+	std::vector<Draw> draws;
+	std::vector<SortItem> items;
+	std::vector<SortItem> scratch;
+	std::vector<Batch> batches;
+	Stats stats;
+
+	// World space box of every draw, tested against the frustum in batches before sorting
+	BoxBatch boxes;
+	std::vector<unsigned char> visible;
+
+	// Shaders that can draw instanced and the matrices and object IDs of every instanced batch of the frame
+	std::unordered_map<Shader*, Shader*> instancedShaders;
+	std::vector<glm::mat4> instanceMatrices;
+	std::vector<GLuint> instanceIDs;
+	GLuint instanceBuffer = 0;
+	GLsizeiptr instanceBufferSize = 0;
+	// Where the IDs start in the instance buffer
+	GLintptr instanceIDsOffset = 0;
+
+	// Every program, mesh and set of textures seen so far gets its own small ID, meshes are told apart by their serial
+	// since a new mesh can end up at the address of one that is gone (the IDs start over once there are too many)
+	std::unordered_map<Shader*, unsigned int> programIDs;
+	std::unordered_map<unsigned long long, MeshIDs> meshIDs;
+	std::map<std::vector<GLuint>, unsigned int> materialIDs;
+
+	// Gets (or hands out) the IDs of a mesh and its material
+	MeshIDs getMeshIDs(Mesh& mesh);
+	// Removes the items whose boxes are outside of the camera's frustum or hidden behind the occluders
+	void cull();
+	// Sorts the items by their keys with a least significant digit radix sort, one byte per pass
+	void radixSort();
+	// Splits the sorted items into batches and gathers the matrices and IDs of the instanced ones
+	void buildBatches();
+	// Orphans the instance buffer and fills it with this frame's matrices followed by their IDs
+	void uploadInstances();
+};
+#endif
\ No newline at end of file
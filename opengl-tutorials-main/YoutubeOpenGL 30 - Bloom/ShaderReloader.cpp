@@ -0,0 +1,407 @@
+#include"ShaderReloader.h"
+
+#include<filesystem>
+#ifdef __linux__
+#include<sys/inotify.h>
+#include<poll.h>
+#include<unistd.h>
+#endif
+
+// Turns a path into a form that can be compared against the paths inotify reports
+static std::string normalizePath(const std::string& path)
+{
+	return std::filesystem::absolute(path).lexically_normal().string();
+}
+
+// Creates a hidden context that shares objects with the window and starts watching in the background
+ShaderReloader::ShaderReloader(GLFWwindow* window)
+{
+	// The context has to be created on the main thread, but it is only ever made current on the watcher thread
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	context = glfwCreateWindow(1, 1, "ShaderReloader", NULL, window);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (context == NULL)
+	{
+		std::cout << "Failed to create shared context, shader hot-reload is disabled" << std::endl;
+		running = false;
+		return;
+	}
+
+	running = true;
+	worker = std::thread(&ShaderReloader::run, this);
+}
+
+ShaderReloader::~ShaderReloader()
+{
+	Delete();
+}
+
+// Starts watching all the source files of a shader
+void ShaderReloader::Watch(Shader& shader)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Watched entry;
+	entry.shader = &shader;
+	entry.files = shader.sourceFiles;
+	watched.push_back(entry);
+	// The shader lets the reloader know when it gets moved or destroyed
+	shader.reloader = this;
+}
+
+// Swaps in the programs that finished compiling (call this once per frame from the render thread)
+void ShaderReloader::Update()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (unsigned int i = 0; i < compiled.size();)
+	{
+		Compiled& result = compiled[i];
+		// Never block the render thread, if the background context isn't done yet just try again next frame
+		if (glClientWaitSync(result.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			i++;
+			continue;
+		}
+		glDeleteSync(result.fence);
+
+		// Swap the programs between two frames so nothing is ever drawn with a half built program
+		GLuint oldProgram = result.shader->ID;
+		if (oldProgram != 0)
+			copyUniforms(oldProgram, result.program);
+		else
+			// The shader failed to build before, so it owns a program again from now on
+			Shader::alive++;
+		result.shader->ID = result.program;
+		result.shader->sourceFiles = result.files;
+		// Copying the uniforms may have swapped the program in use behind the back of the cache
+		StateCache::ForgetProgram(oldProgram);
+		glDeleteProgram(oldProgram);
+
+		// Report how long it took from saving the file until the new program was in use
+		double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - result.changeTime).count();
+		std::cout << "Reloaded " << result.files[0] << " in " << latency << "ms (compile " << result.compileMs << "ms)" << std::endl;
+
+		compiled.erase(compiled.begin() + i);
+	}
+}
+
+// Stops watching the shaders, stops the watcher thread and deletes its context
+void ShaderReloader::Delete()
+{
+	if (running)
+	{
+		running = false;
+		worker.join();
+	}
+
+	for (unsigned int i = 0; i < watched.size(); i++)
+		watched[i].shader->reloader = NULL;
+	watched.clear();
+
+	// Throw away whatever finished compiling but never got swapped in
+	for (unsigned int i = 0; i < compiled.size(); i++)
+	{
+		glDeleteSync(compiled[i].fence);
+		glDeleteProgram(compiled[i].program);
+	}
+	compiled.clear();
+	if (context != NULL)
+	{
+		glfwDestroyWindow(context);
+		context = NULL;
+	}
+}
+
+// Loop of the watcher thread
+void ShaderReloader::run()
+{
+	glfwMakeContextCurrent(context);
+
+	int inotifyFD = -1;
+#ifdef __linux__
+	inotifyFD = inotify_init1(IN_NONBLOCK);
+#endif
+	// Directories being watched by inotify, indexed by their watch descriptor
+	std::map<int, std::string> directories;
+
+	while (running)
+	{
+		waitForChanges(inotifyFD, directories);
+
+		// Build the shaders whose files changed one at a time, the shader can't be moved or destroyed while building
+		// is held, so the pointer stays good from taking the job until the result is queued
+		while (running)
+		{
+			std::lock_guard<std::mutex> guard(building);
+			Watched job;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (unsigned int i = 0; i < watched.size() && job.shader == NULL; i++)
+				{
+					if (watched[i].dirty)
+					{
+						job = watched[i];
+						watched[i].dirty = false;
+					}
+				}
+			}
+			if (job.shader == NULL)
+				break;
+
+			auto start = std::chrono::steady_clock::now();
+			std::vector<std::string> files;
+			GLuint program = 0;
+			try
+			{
+				program = job.shader->Build(files);
+			}
+			catch (...)
+			{
+				// The file is most likely still being written, it will be picked up again by the next event
+				std::cout << "Could not read the sources of " << job.files[0] << std::endl;
+				continue;
+			}
+			double compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			std::lock_guard<std::mutex> lock(mutex);
+			// Includes may have been added or removed so start watching the new list of files
+			for (unsigned int j = 0; j < watched.size(); j++)
+			{
+				if (watched[j].shader == job.shader)
+					watched[j].files = files;
+			}
+			if (program == 0)
+			{
+				std::cout << "Reloading " << files[0] << " failed, keeping the previous program" << std::endl;
+				continue;
+			}
+
+			// The fence lets the render thread know when the program can be used from its own context
+			GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+			compiled.push_back(Compiled{ job.shader, program, fence, files, job.changeTime, compileMs });
+		}
+	}
+
+#ifdef __linux__
+	if (inotifyFD >= 0)
+		close(inotifyFD);
+#endif
+	glfwMakeContextCurrent(NULL);
+}
+
+// Blocks for a short while and flags the shaders whose files changed
+void ShaderReloader::waitForChanges(int inotifyFD, std::map<int, std::string>& directories)
+{
+	std::vector<std::string> files;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (unsigned int i = 0; i < watched.size(); i++)
+			files.insert(files.end(), watched[i].files.begin(), watched[i].files.end());
+	}
+
+#ifdef __linux__
+	if (inotifyFD >= 0)
+	{
+		// Watch directories instead of files since most editors save by replacing the file
+		for (unsigned int i = 0; i < files.size(); i++)
+		{
+			std::string directory = std::filesystem::path(normalizePath(files[i])).parent_path().string();
+			bool found = false;
+			for (auto it = directories.begin(); it != directories.end(); it++)
+			{
+				if (it->second == directory)
+				{
+					found = true;
+					break;
+				}
+			}
+			if (!found)
+			{
+				int wd = inotify_add_watch(inotifyFD, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+				if (wd >= 0)
+					directories[wd] = directory;
+			}
+		}
+
+		// Time out regularly so the thread notices when it has to stop
+		pollfd pfd = { inotifyFD, POLLIN, 0 };
+		if (poll(&pfd, 1, 100) <= 0)
+			return;
+
+		alignas(inotify_event) char buffer[4096];
+		ssize_t length;
+		while ((length = read(inotifyFD, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* ptr = buffer; ptr < buffer + length;)
+			{
+				const inotify_event* event = (const inotify_event*)ptr;
+				if (event->len > 0 && directories.find(event->wd) != directories.end())
+					markDirty(directories[event->wd] + "/" + event->name);
+				ptr += sizeof(inotify_event) + event->len;
+			}
+		}
+		return;
+	}
+#endif
+
+	// Without inotify just compare the modification times a few times per second
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+	for (unsigned int i = 0; i < files.size(); i++)
+	{
+		std::string file = normalizePath(files[i]);
+		std::error_code error;
+		auto writeTime = std::filesystem::last_write_time(file, error);
+		if (error)
+			continue;
+
+		long long ticks = writeTime.time_since_epoch().count();
+		auto it = writeTimes.find(file);
+		if (it == writeTimes.end())
+		{
+			writeTimes[file] = ticks;
+		}
+		else if (it->second != ticks)
+		{
+			it->second = ticks;
+			markDirty(file);
+		}
+	}
+}
+
+// Marks every shader that depends on a given file as dirty
+void ShaderReloader::markDirty(const std::string& file)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (unsigned int i = 0; i < watched.size(); i++)
+	{
+		for (unsigned int j = 0; j < watched[i].files.size(); j++)
+		{
+			if (normalizePath(watched[i].files[j]) == file)
+			{
+				// Keep the time of the first change so the reported latency covers the whole reload
+				if (!watched[i].dirty)
+					watched[i].changeTime = std::chrono::steady_clock::now();
+				watched[i].dirty = true;
+				break;
+			}
+		}
+	}
+}
+
+// Points everything that refers to a shader at another one, or forgets the shader when that is NULL
+void ShaderReloader::repoint(Shader* from, Shader* to)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (unsigned int i = 0; i < watched.size();)
+	{
+		if (watched[i].shader != from)
+			i++;
+		else if (to != NULL)
+			watched[i++].shader = to;
+		else
+			watched.erase(watched.begin() + i);
+	}
+	for (unsigned int i = 0; i < compiled.size();)
+	{
+		if (compiled[i].shader != from)
+		{
+			i++;
+		}
+		else if (to != NULL)
+		{
+			compiled[i++].shader = to;
+		}
+		else
+		{
+			// Nobody is left to swap the program into
+			glDeleteSync(compiled[i].fence);
+			glDeleteProgram(compiled[i].program);
+			compiled.erase(compiled.begin() + i);
+		}
+	}
+}
+
+// Copies the values of all uniforms and uniform block bindings from one program to another
+void ShaderReloader::copyUniforms(GLuint from, GLuint to)
+{
+	// Uniforms can only be set on the active program
+	GLint currentProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+	glUseProgram(to);
+
+	GLint numUniforms;
+	glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &numUniforms);
+	for (GLuint i = 0; i < (GLuint)numUniforms; i++)
+	{
+		char name[256];
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(from, i, sizeof(name), NULL, &size, &type, name);
+
+		// Uniforms inside of blocks live in buffers, so only the block binding has to be carried over
+		GLint blockIndex;
+		glGetActiveUniformsiv(from, 1, &i, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+		if (blockIndex != -1)
+			continue;
+
+		// Arrays are reported as "name[0]" so every element needs to be copied one by one
+		std::string baseName = name;
+		if (size > 1 && baseName.size() > 3 && baseName.compare(baseName.size() - 3, 3, "[0]") == 0)
+			baseName.erase(baseName.size() - 3);
+
+		for (GLint element = 0; element < size; element++)
+		{
+			std::string elementName = size > 1 ? baseName + "[" + std::to_string(element) + "]" : baseName;
+			GLint src = glGetUniformLocation(from, elementName.c_str());
+			GLint dst = glGetUniformLocation(to, elementName.c_str());
+			if (src == -1 || dst == -1)
+				continue;
+
+			GLfloat floats[16];
+			GLint ints[4];
+			GLuint uints[4];
+			switch (type)
+			{
+			case GL_FLOAT: glGetUniformfv(from, src, floats); glUniform1fv(dst, 1, floats); break;
+			case GL_FLOAT_VEC2: glGetUniformfv(from, src, floats); glUniform2fv(dst, 1, floats); break;
+			case GL_FLOAT_VEC3: glGetUniformfv(from, src, floats); glUniform3fv(dst, 1, floats); break;
+			case GL_FLOAT_VEC4: glGetUniformfv(from, src, floats); glUniform4fv(dst, 1, floats); break;
+			case GL_FLOAT_MAT2: glGetUniformfv(from, src, floats); glUniformMatrix2fv(dst, 1, GL_FALSE, floats); break;
+			case GL_FLOAT_MAT3: glGetUniformfv(from, src, floats); glUniformMatrix3fv(dst, 1, GL_FALSE, floats); break;
+			case GL_FLOAT_MAT4: glGetUniformfv(from, src, floats); glUniformMatrix4fv(dst, 1, GL_FALSE, floats); break;
+			case GL_FLOAT_MAT2x3: glGetUniformfv(from, src, floats); glUniformMatrix2x3fv(dst, 1, GL_FALSE, floats); break;
+			case GL_FLOAT_MAT2x4: glGetUniformfv(from, src, floats); glUniformMatrix2x4fv(dst, 1, GL_FALSE, floats); break;
+			case GL_FLOAT_MAT3x2: glGetUniformfv(from, src, floats); glUniformMatrix3x2fv(dst, 1, GL_FALSE, floats); break;
+			case GL_FLOAT_MAT3x4: glGetUniformfv(from, src, floats); glUniformMatrix3x4fv(dst, 1, GL_FALSE, floats); break;
+			case GL_FLOAT_MAT4x2: glGetUniformfv(from, src, floats); glUniformMatrix4x2fv(dst, 1, GL_FALSE, floats); break;
+			case GL_FLOAT_MAT4x3: glGetUniformfv(from, src, floats); glUniformMatrix4x3fv(dst, 1, GL_FALSE, floats); break;
+			case GL_UNSIGNED_INT: glGetUniformuiv(from, src, uints); glUniform1uiv(dst, 1, uints); break;
+			case GL_UNSIGNED_INT_VEC2: glGetUniformuiv(from, src, uints); glUniform2uiv(dst, 1, uints); break;
+			case GL_UNSIGNED_INT_VEC3: glGetUniformuiv(from, src, uints); glUniform3uiv(dst, 1, uints); break;
+			case GL_UNSIGNED_INT_VEC4: glGetUniformuiv(from, src, uints); glUniform4uiv(dst, 1, uints); break;
+			case GL_INT_VEC2: case GL_BOOL_VEC2: glGetUniformiv(from, src, ints); glUniform2iv(dst, 1, ints); break;
+			case GL_INT_VEC3: case GL_BOOL_VEC3: glGetUniformiv(from, src, ints); glUniform3iv(dst, 1, ints); break;
+			case GL_INT_VEC4: case GL_BOOL_VEC4: glGetUniformiv(from, src, ints); glUniform4iv(dst, 1, ints); break;
+			// Ints, bools and all the sampler types
+			default: glGetUniformiv(from, src, ints); glUniform1iv(dst, 1, ints); break;
+			}
+		}
+	}
+
+	// Carry over the binding points of the uniform blocks
+	GLint numBlocks;
+	glGetProgramiv(from, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+	for (GLuint i = 0; i < (GLuint)numBlocks; i++)
+	{
+		char name[256];
+		glGetActiveUniformBlockName(from, i, sizeof(name), NULL, name);
+		GLint binding;
+		glGetActiveUniformBlockiv(from, i, GL_UNIFORM_BLOCK_BINDING, &binding);
+		GLuint index = glGetUniformBlockIndex(to, name);
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(to, index, binding);
+	}
+
+	// Restore the active program, if the old program was active the new one takes its place
+	glUseProgram((GLuint)currentProgram == from ? to : currentProgram);
+}
@@ -0,0 +1,80 @@
+#ifndef SHADER_RELOADER_CLASS_H
+#define SHADER_RELOADER_CLASS_H
+
+#include<glad/glad.h>
+#include<GLFW/glfw3.h>
+#include<map>
+#include<atomic>
+#include<mutex>
+#include<thread>
+#include<chrono>
+
+#include"shaderClass.h"
+
+class ShaderReloader
+{
+public:
+	// Creates a hidden context that shares objects with the window and starts watching in the background
+	ShaderReloader(GLFWwindow* window);
+	// The watcher thread points back at the reloader, so it can't be copied or moved
+	ShaderReloader(const ShaderReloader&) = delete;
+	ShaderReloader& operator=(const ShaderReloader&) = delete;
+	~ShaderReloader();
+
+	// Starts watching all the source files of a shader
+	void Watch(Shader& shader);
+	// Swaps in the programs that finished compiling (call this once per frame from the render thread)
+	void Update();
+	// Stops watching the shaders, stops the watcher thread and deletes its context (the destructor does this too, calling it earlier is fine)
+	void Delete();
+
+private:
+	friend class Shader;
+
+	struct Watched
+	{
+		Shader* shader = NULL;
+		std::vector<std::string> files;
+		// Set when one of the files changed and the shader is waiting to be rebuilt
+		bool dirty = false;
+		std::chrono::steady_clock::time_point changeTime = {};
+	};
+	struct Compiled
+	{
+		Shader* shader;
+		GLuint program;
+		// Signals once the background context is done building the program
+		GLsync fence;
+		std::vector<std::string> files;
+		std::chrono::steady_clock::time_point changeTime;
+		double compileMs;
+	};
+
+	// Hidden window whose context is used by the watcher thread
+	GLFWwindow* context;
+	std::thread worker;
+	std::atomic<bool> running;
+	// Held by the watcher thread while it builds a shader, so the shader can't be moved or destroyed halfway through
+	std::mutex building;
+
+	// Everything below is shared between the two threads and guarded by the mutex
+	std::mutex mutex;
+	std::vector<Watched> watched;
+	std::vector<Compiled> compiled;
+
+	// Last modification time of every file, only used when inotify isn't available
+	std::map<std::string, long long> writeTimes;
+
+	// Loop of the watcher thread
+	void run();
+	// Blocks for a short while and flags the shaders whose files changed
+	void waitForChanges(int inotifyFD, std::map<int, std::string>& directories);
+	// Marks every shader that depends on a given file as dirty
+	void markDirty(const std::string& file);
+	// Points everything that refers to a shader at another one, or forgets the shader when that is NULL
+	// (called by Shader, which holds building so the watcher thread can't build the shader while it changes)
+	void repoint(Shader* from, Shader* to);
+	// Copies the values of all uniforms and uniform block bindings from one program to another
+	static void copyUniforms(GLuint from, GLuint to);
+};
+#endif
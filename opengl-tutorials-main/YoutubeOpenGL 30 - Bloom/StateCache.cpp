@@ -0,0 +1,412 @@
+#include"StateCache.h"
+
+#include<cstddef>
+
+bool StateCache::enabled = true;
+bool StateCache::directStateAccess = true;
+
+GLuint StateCache::program = StateCache::unknown;
+GLuint StateCache::vertexArray = StateCache::unknown;
+GLuint StateCache::elementBuffer = StateCache::unknown;
+GLuint StateCache::buffers[8];
+GLuint StateCache::activeUnit = StateCache::unknown;
+GLuint StateCache::textures[StateCache::maxTextureUnits];
+GLuint StateCache::drawFramebuffer = StateCache::unknown;
+GLuint StateCache::readFramebuffer = StateCache::unknown;
+GLint StateCache::viewport[4];
+GLuint StateCache::capabilities[10];
+GLuint StateCache::depthFunc = StateCache::unknown;
+GLuint StateCache::depthMask = StateCache::unknown;
+GLuint StateCache::colorMask = StateCache::unknown;
+
+StateCache::Stats StateCache::frame;
+StateCache::Stats StateCache::lastFrame;
+
+// Makes sure the arrays start out as unknown before the first call
+static const bool initialized = (StateCache::Invalidate(), true);
+
+// Same as glUseProgram
+void StateCache::UseProgram(GLuint program)
+{
+	if (enabled && StateCache::program == program)
+	{
+		elided();
+		return;
+	}
+	glUseProgram(program);
+	StateCache::program = program;
+	issued();
+}
+
+// Tells if the wrappers should create and edit objects through Direct State Access instead of binding them
+bool StateCache::DSA()
+{
+	// Direct State Access is core since 4.5, objects edited this way never touch the bindings the cache knows about
+	return directStateAccess && GLAD_GL_VERSION_4_5;
+}
+
+// Same as glBindVertexArray, the element buffer is part of the VAO so it gets forgotten too
+void StateCache::BindVertexArray(GLuint vertexArray)
+{
+	if (enabled && StateCache::vertexArray == vertexArray)
+	{
+		elided();
+		return;
+	}
+	glBindVertexArray(vertexArray);
+	StateCache::vertexArray = vertexArray;
+	elementBuffer = unknown;
+	issued();
+#ifdef STATE_CACHE_STATS
+	frame.vertexArrays++;
+#endif
+}
+
+// Same as glBindBuffer
+void StateCache::BindBuffer(GLenum target, GLuint buffer)
+{
+	GLuint* cached = NULL;
+	if (target == GL_ELEMENT_ARRAY_BUFFER)
+		cached = &elementBuffer;
+	else if (bufferIndex(target) != -1)
+		cached = &buffers[bufferIndex(target)];
+
+	if (enabled && cached != NULL && *cached == buffer)
+	{
+		elided();
+		return;
+	}
+	glBindBuffer(target, buffer);
+	if (cached != NULL)
+		*cached = buffer;
+	issued();
+}
+
+// Same as glVertexArrayElementBuffer, which changes the element buffer binding if the VAO is the bound one
+void StateCache::VertexArrayElementBuffer(GLuint vertexArray, GLuint buffer)
+{
+	bool bound = StateCache::vertexArray == vertexArray;
+	if (enabled && bound && elementBuffer == buffer)
+	{
+		elided();
+		return;
+	}
+	glVertexArrayElementBuffer(vertexArray, buffer);
+	if (bound)
+		elementBuffer = buffer;
+	issued();
+}
+
+// Same as glActiveTexture but takes the unit number instead of GL_TEXTUREi
+void StateCache::ActiveTexture(GLuint unit)
+{
+	if (enabled && activeUnit == unit)
+	{
+		elided();
+		return;
+	}
+	glActiveTexture(GL_TEXTURE0 + unit);
+	activeUnit = unit;
+	issued();
+}
+
+// Binds a texture to a texture unit, only switching the active unit if the binding has to change
+void StateCache::BindTexture(GLuint unit, GLuint texture, GLenum target)
+{
+	// Only 2D textures are cached, anything else always goes to the driver
+	bool cached = target == GL_TEXTURE_2D && unit < maxTextureUnits;
+	if (enabled && cached && textures[unit] == texture)
+	{
+		elided();
+		return;
+	}
+	// Binding by unit leaves the active unit alone, which saves a call whenever it would have to change
+	if (DSA() && texture != 0)
+		glBindTextureUnit(unit, texture);
+	else
+	{
+		ActiveTexture(unit);
+		glBindTexture(target, texture);
+	}
+	if (cached)
+		textures[unit] = texture;
+	issued();
+}
+
+// Same as glBindFramebuffer
+void StateCache::BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+	bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+	if (enabled && (!draw || drawFramebuffer == framebuffer) && (!read || readFramebuffer == framebuffer))
+	{
+		elided();
+		return;
+	}
+	glBindFramebuffer(target, framebuffer);
+	if (draw)
+		drawFramebuffer = framebuffer;
+	if (read)
+		readFramebuffer = framebuffer;
+	issued();
+}
+
+// Same as glViewport
+void StateCache::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (enabled && viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height)
+	{
+		elided();
+		return;
+	}
+	glViewport(x, y, width, height);
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+	issued();
+}
+
+// Same as glEnable
+void StateCache::Enable(GLenum capability)
+{
+	int index = capabilityIndex(capability);
+	if (enabled && index != -1 && capabilities[index] == GL_TRUE)
+	{
+		elided();
+		return;
+	}
+	glEnable(capability);
+	if (index != -1)
+		capabilities[index] = GL_TRUE;
+	issued();
+}
+
+// Same as glDisable
+void StateCache::Disable(GLenum capability)
+{
+	int index = capabilityIndex(capability);
+	if (enabled && index != -1 && capabilities[index] == GL_FALSE)
+	{
+		elided();
+		return;
+	}
+	glDisable(capability);
+	if (index != -1)
+		capabilities[index] = GL_FALSE;
+	issued();
+}
+
+// Same as glDepthFunc
+void StateCache::DepthFunc(GLenum func)
+{
+	if (enabled && depthFunc == func)
+	{
+		elided();
+		return;
+	}
+	glDepthFunc(func);
+	depthFunc = func;
+	issued();
+}
+
+// Same as glDepthMask
+void StateCache::DepthMask(GLboolean mask)
+{
+	if (enabled && depthMask == mask)
+	{
+		elided();
+		return;
+	}
+	glDepthMask(mask);
+	depthMask = mask;
+	issued();
+}
+
+// Same as glColorMask
+void StateCache::ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+	GLuint mask = (red ? 1 : 0) | (green ? 2 : 0) | (blue ? 4 : 0) | (alpha ? 8 : 0);
+	if (enabled && colorMask == mask)
+	{
+		elided();
+		return;
+	}
+	glColorMask(red, green, blue, alpha);
+	colorMask = mask;
+	issued();
+}
+
+// Current depth and color write state, only asking the driver for the parts the cache doesn't know
+StateCache::RasterState StateCache::GetRasterState()
+{
+	// Whatever had to be asked for is known from now on
+	if (depthFunc == unknown)
+	{
+		GLint func;
+		glGetIntegerv(GL_DEPTH_FUNC, &func);
+		depthFunc = (GLuint)func;
+	}
+	if (depthMask == unknown)
+	{
+		GLboolean mask;
+		glGetBooleanv(GL_DEPTH_WRITEMASK, &mask);
+		depthMask = mask;
+	}
+	if (colorMask == unknown)
+	{
+		GLboolean mask[4];
+		glGetBooleanv(GL_COLOR_WRITEMASK, mask);
+		colorMask = (mask[0] ? 1 : 0) | (mask[1] ? 2 : 0) | (mask[2] ? 4 : 0) | (mask[3] ? 8 : 0);
+	}
+	GLuint& cullFace = capabilities[capabilityIndex(GL_CULL_FACE)];
+	if (cullFace == unknown)
+		cullFace = glIsEnabled(GL_CULL_FACE);
+
+	RasterState state;
+	state.depthFunc = depthFunc;
+	state.depthMask = (GLboolean)depthMask;
+	for (unsigned int i = 0; i < 4; i++)
+		state.colorMask[i] = (colorMask >> i) & 1 ? GL_TRUE : GL_FALSE;
+	state.cullFace = cullFace == GL_TRUE;
+	return state;
+}
+
+// Puts back a state returned by GetRasterState
+void StateCache::SetRasterState(const RasterState& state)
+{
+	DepthFunc(state.depthFunc);
+	DepthMask(state.depthMask);
+	ColorMask(state.colorMask[0], state.colorMask[1], state.colorMask[2], state.colorMask[3]);
+	if (state.cullFace)
+		Enable(GL_CULL_FACE);
+	else
+		Disable(GL_CULL_FACE);
+}
+
+// Deleting the program in use doesn't unbind it, but the next UseProgram must still reach the driver
+void StateCache::ForgetProgram(GLuint program)
+{
+	if (StateCache::program == program)
+		StateCache::program = unknown;
+}
+
+void StateCache::ForgetVertexArray(GLuint vertexArray)
+{
+	if (StateCache::vertexArray == vertexArray)
+	{
+		StateCache::vertexArray = unknown;
+		elementBuffer = unknown;
+	}
+}
+
+void StateCache::ForgetBuffer(GLuint buffer)
+{
+	if (elementBuffer == buffer)
+		elementBuffer = unknown;
+	for (unsigned int i = 0; i < sizeof(buffers) / sizeof(buffers[0]); i++)
+		if (buffers[i] == buffer)
+			buffers[i] = unknown;
+}
+
+void StateCache::ForgetTexture(GLuint texture)
+{
+	for (unsigned int i = 0; i < maxTextureUnits; i++)
+		if (textures[i] == texture)
+			textures[i] = unknown;
+}
+
+void StateCache::ForgetFramebuffer(GLuint framebuffer)
+{
+	if (drawFramebuffer == framebuffer)
+		drawFramebuffer = unknown;
+	if (readFramebuffer == framebuffer)
+		readFramebuffer = unknown;
+}
+
+// Forgets everything, call this after talking to OpenGL directly
+void StateCache::Invalidate()
+{
+	program = unknown;
+	vertexArray = unknown;
+	elementBuffer = unknown;
+	for (unsigned int i = 0; i < sizeof(buffers) / sizeof(buffers[0]); i++)
+		buffers[i] = unknown;
+	activeUnit = unknown;
+	for (unsigned int i = 0; i < maxTextureUnits; i++)
+		textures[i] = unknown;
+	drawFramebuffer = unknown;
+	readFramebuffer = unknown;
+	for (unsigned int i = 0; i < 4; i++)
+		viewport[i] = -1;
+	for (unsigned int i = 0; i < sizeof(capabilities) / sizeof(capabilities[0]); i++)
+		capabilities[i] = unknown;
+	depthFunc = unknown;
+	depthMask = unknown;
+	colorMask = unknown;
+}
+
+// Stores the counters of the frame that just ended and starts counting again
+void StateCache::EndFrame()
+{
+	lastFrame = frame;
+	frame = Stats();
+}
+
+// Counters of the last finished frame (always zero unless STATE_CACHE_STATS is defined)
+StateCache::Stats StateCache::LastFrame()
+{
+	return lastFrame;
+}
+
+// Slot of a buffer target in buffers, -1 for targets that aren't cached
+int StateCache::bufferIndex(GLenum target)
+{
+	switch (target)
+	{
+		case GL_ARRAY_BUFFER: return 0;
+		case GL_UNIFORM_BUFFER: return 1;
+		case GL_SHADER_STORAGE_BUFFER: return 2;
+		case GL_DRAW_INDIRECT_BUFFER: return 3;
+		case GL_PIXEL_PACK_BUFFER: return 4;
+		case GL_PIXEL_UNPACK_BUFFER: return 5;
+		case GL_COPY_READ_BUFFER: return 6;
+		case GL_COPY_WRITE_BUFFER: return 7;
+		default: return -1;
+	}
+}
+
+// Slot of a capability in capabilities, -1 for capabilities that aren't cached
+int StateCache::capabilityIndex(GLenum capability)
+{
+	switch (capability)
+	{
+		case GL_DEPTH_TEST: return 0;
+		case GL_CULL_FACE: return 1;
+		case GL_BLEND: return 2;
+		case GL_MULTISAMPLE: return 3;
+		case GL_STENCIL_TEST: return 4;
+		case GL_SCISSOR_TEST: return 5;
+		case GL_FRAMEBUFFER_SRGB: return 6;
+		case GL_POLYGON_OFFSET_FILL: return 7;
+		case GL_PRIMITIVE_RESTART: return 8;
+		case GL_RASTERIZER_DISCARD: return 9;
+		default: return -1;
+	}
+}
+
+// Counts a call that went to the driver
+void StateCache::issued()
+{
+#ifdef STATE_CACHE_STATS
+	frame.issued++;
+#endif
+}
+
+// Counts a call that got skipped
+void StateCache::elided()
+{
+#ifdef STATE_CACHE_STATS
+	frame.elided++;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#ifndef STATE_CACHE_CLASS_H
+#define STATE_CACHE_CLASS_H
+
+#include<glad/glad.h>
+
+// Debug builds count every call that reaches the driver and every call that got skipped
+#if defined(_DEBUG) && !defined(STATE_CACHE_STATS)
+#define STATE_CACHE_STATS
+#endif
+
+// Remembers the bindings of the main context so that binding something that is already bound costs nothing.
+// Everything that changes these bindings on the main context has to go through here (or call Invalidate),
+// other contexts (like the one of the ShaderReloader) must never use it.
+class StateCache
+{
+public:
+	// Number of GL calls that were sent to the driver and that were skipped because nothing would change
+	struct Stats
+	{
+		unsigned int issued = 0;
+		unsigned int elided = 0;
+		// VAO switches that reached the driver, the heaviest of the bindings
+		unsigned int vertexArrays = 0;
+	};
+	// Depth and color write state a pass can read before changing it and put back afterwards
+	struct RasterState
+	{
+		GLenum depthFunc;
+		GLboolean depthMask;
+		GLboolean colorMask[4];
+		bool cullFace;
+	};
+
+	// Turn this off to send every call to the driver (useful to compare frame times)
+	static bool enabled;
+	// Turn this off to make the wrappers edit objects by binding them even on OpenGL 4.5 (useful to compare both)
+	static bool directStateAccess;
+
+	// Tells if the wrappers should create and edit objects through Direct State Access instead of binding them
+	static bool DSA();
+
+	// Same as glUseProgram
+	static void UseProgram(GLuint program);
+	// Same as glBindVertexArray, the element buffer is part of the VAO so it gets forgotten too
+	static void BindVertexArray(GLuint vertexArray);
+	// Same as glBindBuffer
+	static void BindBuffer(GLenum target, GLuint buffer);
+	// Same as glVertexArrayElementBuffer, which changes the element buffer binding if the VAO is the bound one
+	static void VertexArrayElementBuffer(GLuint vertexArray, GLuint buffer);
+	// Same as glActiveTexture but takes the unit number instead of GL_TEXTUREi
+	static void ActiveTexture(GLuint unit);
+	// Binds a texture to a texture unit, only switching the active unit if the binding has to change
+	static void BindTexture(GLuint unit, GLuint texture, GLenum target = GL_TEXTURE_2D);
+	// Same as glBindFramebuffer
+	static void BindFramebuffer(GLenum target, GLuint framebuffer);
+	// Same as glViewport
+	static void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	// Same as glEnable and glDisable
+	static void Enable(GLenum capability);
+	static void Disable(GLenum capability);
+	// Same as glDepthFunc, glDepthMask and glColorMask
+	static void DepthFunc(GLenum func);
+	static void DepthMask(GLboolean mask);
+	static void ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+	// Current depth and color write state, only asking the driver for the parts the cache doesn't know
+	static RasterState GetRasterState();
+	// Puts back a state returned by GetRasterState
+	static void SetRasterState(const RasterState& state);
+
+	// Forget objects that are about to be deleted since OpenGL unbinds them behind our back
+	static void ForgetProgram(GLuint program);
+	static void ForgetVertexArray(GLuint vertexArray);
+	static void ForgetBuffer(GLuint buffer);
+	static void ForgetTexture(GLuint texture);
+	static void ForgetFramebuffer(GLuint framebuffer);
+	// Forgets everything, call this after talking to OpenGL directly
+	static void Invalidate();
+
+	// Stores the counters of the frame that just ended and starts counting again
+	static void EndFrame();
+	// Counters of the last finished frame (always zero unless STATE_CACHE_STATS is defined)
+	static Stats LastFrame();
+
+private:
+	// Value for bindings we don't know about, it never matches a real object
+	static const GLuint unknown = 0xFFFFFFFF;
+	static const unsigned int maxTextureUnits = 32;
+
+	static GLuint program;
+	static GLuint vertexArray;
+	static GLuint elementBuffer;
+	static GLuint buffers[8];
+	static GLuint activeUnit;
+	static GLuint textures[maxTextureUnits];
+	static GLuint drawFramebuffer;
+	static GLuint readFramebuffer;
+	static GLint viewport[4];
+	static GLuint capabilities[10];
+	static GLuint depthFunc;
+	static GLuint depthMask;
+	// One bit per channel
+	static GLuint colorMask;
+
+	static Stats frame;
+	static Stats lastFrame;
+
+	// Slot of a buffer target in buffers, -1 for targets that aren't cached
+	static int bufferIndex(GLenum target);
+	// Slot of a capability in capabilities, -1 for capabilities that aren't cached
+	static int capabilityIndex(GLenum capability);
+	// Counts a call that went to the driver or got skipped
+	static void issued();
+	static void elided();
+};
+#endif
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include"Texture.h"
 
+#include<utility>
+#include<cstring>
+
+unsigned int Texture::alive = 0;
+
 Texture::Texture(const char* image, const char* texType, GLuint slot)
 {
 	// Assigns the type of the texture ot the texture object
@@ -12,109 +17,117 @@ Texture::Texture(const char* image, const char* texType, GLuint slot)
 	// Reads the image from a file and stores it in bytes
 	unsigned char* bytes = stbi_load(image, &widthImg, &heightImg, &numColCh, 0);
 
-	// Generates an OpenGL texture object
-	glGenTextures(1, &ID);
-	// Assigns the texture to a Texture Unit
-	glActiveTexture(GL_TEXTURE0 + slot);
-	unit = slot;
-	glBindTexture(GL_TEXTURE_2D, ID);
-
-	// Configures the type of algorithm that is used to make the image smaller or bigger
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Configures the way the texture repeats (if it does at all)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Extra lines in case you choose to use GL_CLAMP_TO_BORDER
-	// float flatColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
-	// glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, flatColor);
-
-	// Check what type of color channels the texture has and load it accordingly
+	// Check what type of color channels the texture has and pick the formats accordingly
+	GLenum internalFormat;
+	GLenum format;
 	if (type == "normal") // prevents SRGB from deforming normals
-		glTexImage2D
-		(
-			GL_TEXTURE_2D,
-			0,
-			GL_RGB,
-			widthImg,
-			heightImg,
-			0,
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			bytes
-		);
+	{
+		internalFormat = GL_RGB8;
+		format = GL_RGBA;
+	}
 	else if (type == "displacement")
-		glTexImage2D
-		(
-			GL_TEXTURE_2D,
-			0,
-			GL_RED,
-			widthImg,
-			heightImg,
-			0,
-			GL_RED,
-			GL_UNSIGNED_BYTE,
-			bytes
-		);
+	{
+		internalFormat = GL_R8;
+		format = GL_RED;
+	}
 	else if (numColCh == 4)
-		glTexImage2D
-		(
-			GL_TEXTURE_2D,
-			0,
-			GL_SRGB_ALPHA,
-			widthImg,
-			heightImg,
-			0,
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			bytes
-		);
+	{
+		internalFormat = GL_SRGB8_ALPHA8;
+		format = GL_RGBA;
+	}
 	else if (numColCh == 3)
-		glTexImage2D
-		(
-			GL_TEXTURE_2D,
-			0,
-			GL_SRGB,
-			widthImg,
-			heightImg,
-			0,
-			GL_RGB,
-			GL_UNSIGNED_BYTE,
-			bytes
-		);
+	{
+		internalFormat = GL_SRGB8;
+		format = GL_RGB;
+	}
 	else if (numColCh == 1)
-		glTexImage2D
-		(
-			GL_TEXTURE_2D,
-			0,
-			GL_SRGB,
-			widthImg,
-			heightImg,
-			0,
-			GL_RED,
-			GL_UNSIGNED_BYTE,
-			bytes
-		);
+	{
+		internalFormat = GL_SRGB8;
+		format = GL_RED;
+	}
 	else
 		throw std::invalid_argument("Automatic Texture type recognition failed");
 
-	// Generates MipMaps
-	glGenerateMipmap(GL_TEXTURE_2D);
+	// Assigns the texture to a Texture Unit
+	unit = slot;
+	if (StateCache::DSA())
+	{
+		// Creates the texture with immutable storage for every mip level and fills it by name, so nothing gets bound
+		GLsizei levels = 1;
+		while ((widthImg | heightImg) >> levels)
+			levels++;
+		glCreateTextures(GL_TEXTURE_2D, 1, &ID);
+		glTextureParameteri(ID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(ID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(ID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTextureParameteri(ID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTextureStorage2D(ID, levels, internalFormat, widthImg, heightImg);
+		glTextureSubImage2D(ID, 0, 0, 0, widthImg, heightImg, format, GL_UNSIGNED_BYTE, bytes);
+		glGenerateTextureMipmap(ID);
+	}
+	else
+	{
+		// Generates an OpenGL texture object
+		glGenTextures(1, &ID);
+		StateCache::BindTexture(unit, ID);
+
+		// Configures the type of algorithm that is used to make the image smaller or bigger
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		// Configures the way the texture repeats (if it does at all)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+		// Extra lines in case you choose to use GL_CLAMP_TO_BORDER
+		// float flatColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
+		// glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, flatColor);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, widthImg, heightImg, 0, format, GL_UNSIGNED_BYTE, bytes);
+		// Generates MipMaps
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		// Unbinds the OpenGL Texture object so that it can't accidentally be modified
+		StateCache::BindTexture(unit, 0);
+	}
+	// Drivers pad RGB to four bytes per texel and the mipmaps add another third
+	Texture::bytes = (GLsizeiptr)widthImg * heightImg * (strcmp(type, "displacement") == 0 ? 1 : 4) * 4 / 3;
 
 	// Deletes the image data as it is already in the OpenGL Texture object
 	stbi_image_free(bytes);
 
-	// Unbinds the OpenGL Texture object so that it can't accidentally be modified
-	glBindTexture(GL_TEXTURE_2D, 0);
+	alive++;
+}
+
+Texture::Texture(Texture&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+Texture& Texture::operator=(Texture&& other) noexcept
+{
+	if (this != &other)
+	{
+		Delete();
+		ID = other.ID;
+		type = other.type;
+		unit = other.unit;
+		bytes = other.bytes;
+		other.ID = 0;
+	}
+	return *this;
+}
+
+Texture::~Texture()
+{
+	Delete();
 }
 
 void Texture::texUnit(Shader& shader, const char* uniform, GLuint unit)
 {
 	// Gets the location of the uniform
 	GLuint texUni = glGetUniformLocation(shader.ID, uniform);
-	// Shader needs to be activated before changing the value of a uniform
+	// Shader needs to be activated before changing the value of a uniform (free if it already is)
 	shader.Activate();
 	// Sets the value of the uniform
 	glUniform1i(texUni, unit);
@@ -122,16 +135,20 @@ void Texture::texUnit(Shader& shader, const char* uniform, GLuint unit)
 
 void Texture::Bind()
 {
-	glActiveTexture(GL_TEXTURE0 + unit);
-	glBindTexture(GL_TEXTURE_2D, ID);
+	StateCache::BindTexture(unit, ID);
 }
 
 void Texture::Unbind()
 {
-	glBindTexture(GL_TEXTURE_2D, 0);
+	StateCache::BindTexture(unit, 0);
 }
 
 void Texture::Delete()
 {
+	if (ID == 0)
+		return;
+	StateCache::ForgetTexture(ID);
 	glDeleteTextures(1, &ID);
+	ID = 0;
+	alive--;
 }
\ No newline at end of file
@@ -9,11 +9,21 @@
 class Texture
 {
 public:
-	GLuint ID;
+	GLuint ID = 0;
 	const char* type;
 	GLuint unit;
+	// Rough size of the texture and its mipmaps on the GPU in bytes
+	GLsizeiptr bytes = 0;
+	// Number of textures that weren't deleted yet (anything left at exit is a leak)
+	static unsigned int alive;
 
 	Texture(const char* image, const char* texType, GLuint slot);
+	// A texture owns its OpenGL object, so it can only be moved and gets deleted with the object
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+	Texture(Texture&& other) noexcept;
+	Texture& operator=(Texture&& other) noexcept;
+	~Texture();
 
 	// Assigns a texture unit to a texture
 	void texUnit(Shader& shader, const char* uniform, GLuint unit);
@@ -21,7 +31,7 @@ public:
 	void Bind();
 	// Unbinds a texture
 	void Unbind();
-	// Deletes a texture
+	// Deletes a texture (the destructor does this too, calling it earlier is fine)
 	void Delete();
 };
 #endif
\ No newline at end of file
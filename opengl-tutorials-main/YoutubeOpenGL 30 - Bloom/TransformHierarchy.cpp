@@ -0,0 +1,261 @@
+#include"TransformHierarchy.h"
+
+#include<chrono>
+#include<stdexcept>
+
+// Four nodes at a time whenever the compiler is allowed to use SSE
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<xmmintrin.h>
+#define TRANSFORM_SSE 1
+#else
+#define TRANSFORM_SSE 0
+#endif
+
+// Adds a node below a parent that was added before it and returns its index
+unsigned int TransformHierarchy::Add(unsigned int parent, glm::vec3 translation, glm::quat rotation, glm::vec3 scale)
+{
+	unsigned int node = (unsigned int)parents.size();
+	if (parent != none && parent >= node)
+		throw std::invalid_argument("A node's parent has to be added before the node");
+	parents.push_back(parent);
+	translationX.push_back(translation.x);
+	translationY.push_back(translation.y);
+	translationZ.push_back(translation.z);
+	rotationX.push_back(rotation.x);
+	rotationY.push_back(rotation.y);
+	rotationZ.push_back(rotation.z);
+	rotationW.push_back(rotation.w);
+	scaleX.push_back(scale.x);
+	scaleY.push_back(scale.y);
+	scaleZ.push_back(scale.z);
+	locals.push_back(glm::mat4(1.0f));
+	worlds.push_back(glm::mat4(1.0f));
+	localDirty.push_back(1);
+	worldDirty.push_back(1);
+	dirty = true;
+	return node;
+}
+
+// Removes every node
+void TransformHierarchy::Clear()
+{
+	parents.clear();
+	translationX.clear();
+	translationY.clear();
+	translationZ.clear();
+	rotationX.clear();
+	rotationY.clear();
+	rotationZ.clear();
+	rotationW.clear();
+	scaleX.clear();
+	scaleY.clear();
+	scaleZ.clear();
+	locals.clear();
+	worlds.clear();
+	localDirty.clear();
+	worldDirty.clear();
+	dirty = false;
+}
+
+unsigned int TransformHierarchy::Size()
+{
+	return (unsigned int)parents.size();
+}
+
+// Marks a node as moved
+void TransformHierarchy::touch(unsigned int node)
+{
+	localDirty[node] = 1;
+	dirty = true;
+}
+
+void TransformHierarchy::SetTranslation(unsigned int node, glm::vec3 translation)
+{
+	translationX[node] = translation.x;
+	translationY[node] = translation.y;
+	translationZ[node] = translation.z;
+	touch(node);
+}
+
+void TransformHierarchy::SetRotation(unsigned int node, glm::quat rotation)
+{
+	rotationX[node] = rotation.x;
+	rotationY[node] = rotation.y;
+	rotationZ[node] = rotation.z;
+	rotationW[node] = rotation.w;
+	touch(node);
+}
+
+void TransformHierarchy::SetScale(unsigned int node, glm::vec3 scale)
+{
+	scaleX[node] = scale.x;
+	scaleY[node] = scale.y;
+	scaleZ[node] = scale.z;
+	touch(node);
+}
+
+void TransformHierarchy::Set(unsigned int node, glm::vec3 translation, glm::quat rotation, glm::vec3 scale)
+{
+	SetTranslation(node, translation);
+	SetRotation(node, rotation);
+	SetScale(node, scale);
+}
+
+glm::vec3 TransformHierarchy::Translation(unsigned int node)
+{
+	return glm::vec3(translationX[node], translationY[node], translationZ[node]);
+}
+
+glm::quat TransformHierarchy::Rotation(unsigned int node)
+{
+	return glm::quat(rotationW[node], rotationX[node], rotationY[node], rotationZ[node]);
+}
+
+glm::vec3 TransformHierarchy::Scale(unsigned int node)
+{
+	return glm::vec3(scaleX[node], scaleY[node], scaleZ[node]);
+}
+
+unsigned int TransformHierarchy::Parent(unsigned int node)
+{
+	return parents[node];
+}
+
+// Builds the local matrices of the nodes from first to first + 3
+void TransformHierarchy::buildLocals(unsigned int first)
+{
+	// Same as translate * mat4_cast(rotation) * scale, with every lane holding a different node
+#if TRANSFORM_SSE
+	__m128 x = _mm_loadu_ps(&rotationX[first]);
+	__m128 y = _mm_loadu_ps(&rotationY[first]);
+	__m128 z = _mm_loadu_ps(&rotationZ[first]);
+	__m128 w = _mm_loadu_ps(&rotationW[first]);
+	__m128 sx = _mm_loadu_ps(&scaleX[first]);
+	__m128 sy = _mm_loadu_ps(&scaleY[first]);
+	__m128 sz = _mm_loadu_ps(&scaleZ[first]);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 two = _mm_set1_ps(2.0f);
+
+	__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+	__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+	__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+	// Every column is a column of the rotation matrix stretched by the scale along its axis
+	__m128 columns[4][4];
+	columns[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+	columns[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+	columns[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+	columns[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+	columns[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+	columns[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+	columns[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+	columns[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+	columns[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+	columns[3][0] = _mm_loadu_ps(&translationX[first]);
+	columns[3][1] = _mm_loadu_ps(&translationY[first]);
+	columns[3][2] = _mm_loadu_ps(&translationZ[first]);
+	columns[0][3] = columns[1][3] = columns[2][3] = _mm_setzero_ps();
+	columns[3][3] = one;
+
+	// Turn the lanes around so every node gets its own four columns
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		__m128 c0 = columns[column][0], c1 = columns[column][1], c2 = columns[column][2], c3 = columns[column][3];
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		_mm_storeu_ps(&locals[first][column][0], c0);
+		_mm_storeu_ps(&locals[first + 1][column][0], c1);
+		_mm_storeu_ps(&locals[first + 2][column][0], c2);
+		_mm_storeu_ps(&locals[first + 3][column][0], c3);
+	}
+#else
+	for (unsigned int node = first; node < first + 4; node++)
+	{
+		glm::mat4 rotation = glm::mat4_cast(Rotation(node));
+		locals[node] = glm::mat4(rotation[0] * scaleX[node], rotation[1] * scaleY[node], rotation[2] * scaleZ[node], glm::vec4(Translation(node), 1.0f));
+	}
+#endif
+}
+
+// Multiplies two matrices, result can't be either of the two
+static void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+{
+#if TRANSFORM_SSE
+	// Every column of the result mixes the columns of a by one column of b
+	__m128 a0 = _mm_loadu_ps(&a[0][0]);
+	__m128 a1 = _mm_loadu_ps(&a[1][0]);
+	__m128 a2 = _mm_loadu_ps(&a[2][0]);
+	__m128 a3 = _mm_loadu_ps(&a[3][0]);
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		__m128 mixed = _mm_mul_ps(a0, _mm_set1_ps(b[column][0]));
+		mixed = _mm_add_ps(mixed, _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+		mixed = _mm_add_ps(mixed, _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+		mixed = _mm_add_ps(mixed, _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+		_mm_storeu_ps(&result[column][0], mixed);
+	}
+#else
+	result = a * b;
+#endif
+}
+
+// Recomputes the local and world matrices of the nodes that moved and of everything below them
+void TransformHierarchy::Update()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	stats = Stats();
+	stats.nodes = Size();
+	if (!dirty)
+		return;
+
+	// Local matrices get built four at a time, so a group gets rebuilt as soon as one of its nodes moved
+	unsigned int count = Size();
+	unsigned int full = count & ~3u;
+	for (unsigned int first = 0; first < count; first += 4)
+	{
+		if (first < full)
+		{
+			if (!(localDirty[first] | localDirty[first + 1] | localDirty[first + 2] | localDirty[first + 3]))
+				continue;
+			buildLocals(first);
+			stats.locals += 4;
+			continue;
+		}
+		// The last few nodes don't fill a group, so they get built one by one
+		for (unsigned int node = first; node < count; node++)
+		{
+			if (!localDirty[node])
+				continue;
+			glm::mat4 rotation = glm::mat4_cast(Rotation(node));
+			locals[node] = glm::mat4(rotation[0] * scaleX[node], rotation[1] * scaleY[node], rotation[2] * scaleZ[node], glm::vec4(Translation(node), 1.0f));
+			stats.locals++;
+		}
+	}
+
+	// Parents come first, so by the time a node is reached its parent's world matrix is already final
+	for (unsigned int node = 0; node < count; node++)
+	{
+		unsigned int parent = parents[node];
+		worldDirty[node] = localDirty[node] | (parent != none && worldDirty[parent]);
+		localDirty[node] = 0;
+		if (!worldDirty[node])
+			continue;
+		if (parent == none)
+			worlds[node] = locals[node];
+		else
+			multiply(worlds[parent], locals[node], worlds[node]);
+		stats.worlds++;
+	}
+	dirty = false;
+	stats.updateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Matrix from the space of a node to the space of the roots (up to date after Update)
+const glm::mat4& TransformHierarchy::World(unsigned int node)
+{
+	return worlds[node];
+}
+
+TransformHierarchy::Stats TransformHierarchy::GetStats()
+{
+	return stats;
+}
\ No newline at end of file
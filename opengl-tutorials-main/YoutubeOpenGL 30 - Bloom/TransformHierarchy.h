@@ -0,0 +1,69 @@
+#ifndef TRANSFORM_HIERARCHY_CLASS_H
+#define TRANSFORM_HIERARCHY_CLASS_H
+
+#include<vector>
+#include<glm/glm.hpp>
+#include<glm/gtc/quaternion.hpp>
+
+// Nodes with a translation, rotation and scale relative to their parent, stored as a structure of arrays.
+// A parent always comes before its children, so the world matrices can be updated with a single pass from the front,
+// and only the nodes that moved (and everything below them) get their matrices computed again.
+class TransformHierarchy
+{
+public:
+	// Parent of the nodes that don't have one
+	static constexpr unsigned int none = 0xFFFFFFFF;
+
+	// What the last update cost
+	struct Stats
+	{
+		unsigned int nodes = 0;
+		// Local matrices built from their translation, rotation and scale, and world matrices multiplied out
+		unsigned int locals = 0;
+		unsigned int worlds = 0;
+		double updateMs = 0.0;
+	};
+
+	// Adds a node below a parent that was added before it and returns its index
+	unsigned int Add(unsigned int parent, glm::vec3 translation = glm::vec3(0.0f), glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3 scale = glm::vec3(1.0f));
+	// Removes every node
+	void Clear();
+	unsigned int Size();
+
+	// Moves a node relative to its parent, it and everything below it get new world matrices with the next Update
+	void SetTranslation(unsigned int node, glm::vec3 translation);
+	void SetRotation(unsigned int node, glm::quat rotation);
+	void SetScale(unsigned int node, glm::vec3 scale);
+	void Set(unsigned int node, glm::vec3 translation, glm::quat rotation, glm::vec3 scale);
+	glm::vec3 Translation(unsigned int node);
+	glm::quat Rotation(unsigned int node);
+	glm::vec3 Scale(unsigned int node);
+	unsigned int Parent(unsigned int node);
+
+	// Recomputes the local and world matrices of the nodes that moved and of everything below them
+	void Update();
+	// Matrix from the space of a node to the space of the roots (up to date after Update)
+	const glm::mat4& World(unsigned int node);
+	Stats GetStats();
+
+private:
+	std::vector<unsigned int> parents;
+	// Translation, rotation and scale split into their components so four nodes can be turned into matrices at once
+	std::vector<float> translationX, translationY, translationZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+	// Nodes whose own transformation changed, and nodes that need a new world matrix because they or a parent changed
+	std::vector<unsigned char> localDirty;
+	std::vector<unsigned char> worldDirty;
+	// Set while any node is dirty so an update of a scene that didn't move costs nothing
+	bool dirty = false;
+	Stats stats;
+
+	// Marks a node as moved
+	void touch(unsigned int node);
+	// Builds the local matrices of the nodes from first to first + 3
+	void buildLocals(unsigned int first);
+};
+#endif
\ No newline at end of file
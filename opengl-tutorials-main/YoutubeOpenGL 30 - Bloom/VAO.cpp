@@ -1,34 +1,130 @@
 #include"VAO.h"
 
+unsigned int VAO::alive = 0;
+
 // Constructor that generates a VAO ID
 VAO::VAO()
 {
-	glGenVertexArrays(1, &ID);
+	if (StateCache::DSA())
+		glCreateVertexArrays(1, &ID);
+	else
+		glGenVertexArrays(1, &ID);
+	alive++;
+}
+
+// Takes over an existing VAO ID, 0 makes an empty VAO that something can be moved into later
+VAO::VAO(GLuint ID)
+{
+	VAO::ID = ID;
+	if (ID != 0)
+		alive++;
+}
+
+VAO::VAO(VAO&& other) noexcept
+{
+	ID = other.ID;
+	other.ID = 0;
+}
+
+VAO& VAO::operator=(VAO&& other) noexcept
+{
+	if (this != &other)
+	{
+		Delete();
+		ID = other.ID;
+		other.ID = 0;
+	}
+	return *this;
+}
+
+VAO::~VAO()
+{
+	Delete();
 }
 
 // Links a VBO Attribute such as a position or color to the VAO
 void VAO::LinkAttrib(VBO& VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset)
 {
+	if (StateCache::DSA())
+	{
+		// Same as glVertexAttribPointer, which gives every attribute a binding point of its own
+		glVertexArrayAttribFormat(ID, layout, numComponents, type, GL_FALSE, 0);
+		glVertexArrayAttribBinding(ID, layout, layout);
+		glVertexArrayVertexBuffer(ID, layout, VBO.ID, (GLintptr)offset, (GLsizei)stride);
+		glEnableVertexArrayAttrib(ID, layout);
+		return;
+	}
 	VBO.Bind();
 	glVertexAttribPointer(layout, numComponents, type, GL_FALSE, stride, offset);
 	glEnableVertexAttribArray(layout);
 	VBO.Unbind();
 }
 
+// Describes an attribute relative to the start of a vertex and says which binding point it reads from
+void VAO::AttribFormat(GLuint layout, GLuint numComponents, GLenum type, GLuint relativeOffset, GLuint binding)
+{
+	if (StateCache::DSA())
+	{
+		glVertexArrayAttribFormat(ID, layout, numComponents, type, GL_FALSE, relativeOffset);
+		glVertexArrayAttribBinding(ID, layout, binding);
+		glEnableVertexArrayAttrib(ID, layout);
+		return;
+	}
+	Bind();
+	glVertexAttribFormat(layout, numComponents, type, GL_FALSE, relativeOffset);
+	glVertexAttribBinding(layout, binding);
+	glEnableVertexAttribArray(layout);
+}
+
+// Points a binding point at a VBO (starting at its offset in the heap)
+void VAO::BindVertexBuffer(VBO& VBO, GLsizei stride, GLuint binding)
+{
+	if (StateCache::DSA())
+		glVertexArrayVertexBuffer(ID, binding, VBO.ID, VBO.offset, stride);
+	else
+	{
+		Bind();
+		glBindVertexBuffer(binding, VBO.ID, VBO.offset, stride);
+	}
+}
+
+// Makes the VAO read its indices from an EBO
+void VAO::BindElementBuffer(EBO& EBO)
+{
+	if (StateCache::DSA())
+		StateCache::VertexArrayElementBuffer(ID, EBO.ID);
+	else
+	{
+		Bind();
+		EBO.Bind();
+	}
+}
+
+// Tells if the current context has separate attribute formats
+bool VAO::SeparateFormat()
+{
+	return GLAD_GL_VERSION_4_3;
+}
+
 // Binds the VAO
 void VAO::Bind()
 {
-	glBindVertexArray(ID);
+	StateCache::BindVertexArray(ID);
 }
 
 // Unbinds the VAO
 void VAO::Unbind()
 {
-	glBindVertexArray(0);
+	StateCache::BindVertexArray(0);
 }
 
-// Deletes the VAO
+// Deletes the VAO (the destructor does this too, calling it earlier is fine)
 void VAO::Delete()
 {
+	if (ID == 0)
+		return;
+	StateCache::ForgetVertexArray(ID);
 	glDeleteVertexArrays(1, &ID);
+	ID = 0;
+	alive--;
 }
\ No newline at end of file
@@ -3,22 +3,44 @@
 
 #include<glad/glad.h>
 #include"VBO.h"
+#include"EBO.h"
+#include"StateCache.h"
 
 class VAO
 {
 public:
 	// ID reference for the Vertex Array Object
 	GLuint ID;
+	// Number of VAOs that were made but not deleted yet (anything left at exit is a leak)
+	static unsigned int alive;
 	// Constructor that generates a VAO ID
 	VAO();
+	// Takes over an existing VAO ID, 0 makes an empty VAO that something can be moved into later
+	explicit VAO(GLuint ID);
+	// A VAO owns its ID, so it can only be moved and gets deleted with the object
+	VAO(const VAO&) = delete;
+	VAO& operator=(const VAO&) = delete;
+	VAO(VAO&& other) noexcept;
+	VAO& operator=(VAO&& other) noexcept;
+	~VAO();
 
 	// Links a VBO Attribute such as a position or color to the VAO
 	void LinkAttrib(VBO& VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset);
+
+	// Separate attribute formats and binding points (OpenGL 4.3), so one VAO per vertex format can serve many buffers:
+	// describes an attribute relative to the start of a vertex and says which binding point it reads from
+	void AttribFormat(GLuint layout, GLuint numComponents, GLenum type, GLuint relativeOffset, GLuint binding = 0);
+	// Points a binding point at a VBO (starting at its offset in the heap)
+	void BindVertexBuffer(VBO& VBO, GLsizei stride, GLuint binding = 0);
+	// Makes the VAO read its indices from an EBO
+	void BindElementBuffer(EBO& EBO);
+	// Tells if the current context has separate attribute formats
+	static bool SeparateFormat();
 	// Binds the VAO
 	void Bind();
 	// Unbinds the VAO
 	void Unbind();
-	// Deletes the VAO
+	// Deletes the VAO (the destructor does this too, calling it earlier is fine)
 	void Delete();
 };
 
@@ -0,0 +1,76 @@
+#include"VAOCache.h"
+
+// Orders the formats so they can be used as keys
+bool VertexFormat::operator<(const VertexFormat& other) const
+{
+	if (stride != other.stride)
+		return stride < other.stride;
+	if (attributes.size() != other.attributes.size())
+		return attributes.size() < other.attributes.size();
+	for (unsigned int i = 0; i < attributes.size(); i++)
+	{
+		const VertexAttribute& a = attributes[i];
+		const VertexAttribute& b = other.attributes[i];
+		if (a.layout != b.layout)
+			return a.layout < b.layout;
+		if (a.numComponents != b.numComponents)
+			return a.numComponents < b.numComponents;
+		if (a.type != b.type)
+			return a.type < b.type;
+		if (a.relativeOffset != b.relativeOffset)
+			return a.relativeOffset < b.relativeOffset;
+	}
+	return false;
+}
+
+// Returns the VAO of a format, making and linking it the first time the format shows up
+VAO& VAOCache::Get(const VertexFormat& format)
+{
+	if (&format == lastFormat)
+		return *lastVAO;
+
+	std::map<VertexFormat, VAO>::iterator found = vaos.find(format);
+	if (found == vaos.end())
+	{
+		found = vaos.emplace(format, VAO()).first;
+		// Every attribute reads from binding point 0, which gets pointed at the buffer of whatever mesh is drawn
+		for (unsigned int i = 0; i < format.attributes.size(); i++)
+		{
+			const VertexAttribute& attribute = format.attributes[i];
+			found->second.AttribFormat(attribute.layout, attribute.numComponents, attribute.type, attribute.relativeOffset);
+		}
+	}
+	lastFormat = &format;
+	lastVAO = &found->second;
+	return found->second;
+}
+
+// Binds the VAO of a format and points it at the vertex and element buffers of a mesh
+void VAOCache::Bind(const VertexFormat& format, VBO& VBO, EBO& EBO)
+{
+	VAO& vao = Get(format);
+	// Bound first so the state cache can skip the element buffer when the last mesh used the same one
+	vao.Bind();
+	vao.BindVertexBuffer(VBO, format.stride);
+	vao.BindElementBuffer(EBO);
+}
+
+// Number of formats (and so VAOs) the cache holds
+unsigned int VAOCache::Size()
+{
+	return (unsigned int)vaos.size();
+}
+
+// Deletes every VAO of the cache
+void VAOCache::Delete()
+{
+	vaos.clear();
+	lastFormat = NULL;
+	lastVAO = NULL;
+}
+
+// Tells if the current context can share VAOs between buffers
+bool VAOCache::Supported()
+{
+	return VAO::SeparateFormat();
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef VAO_CACHE_CLASS_H
+#define VAO_CACHE_CLASS_H
+
+#include<map>
+
+#include"VAO.h"
+
+// Layout of one attribute relative to the start of a vertex
+struct VertexAttribute
+{
+	GLuint layout;
+	GLuint numComponents;
+	GLenum type;
+	GLuint relativeOffset;
+};
+
+// Everything a VAO has to know about a kind of vertex, meshes with the same format can share one VAO
+struct VertexFormat
+{
+	std::vector<VertexAttribute> attributes;
+	GLsizei stride;
+
+	// Orders the formats so they can be used as keys
+	bool operator<(const VertexFormat& other) const;
+};
+
+// Keeps one VAO per vertex format, meshes get drawn by pointing the VAO of their format at their buffers
+// instead of switching to a VAO of their own (needs separate attribute formats, so OpenGL 4.3)
+class VAOCache
+{
+public:
+	// Returns the VAO of a format, making and linking it the first time the format shows up
+	VAO& Get(const VertexFormat& format);
+	// Binds the VAO of a format and points it at the vertex and element buffers of a mesh
+	void Bind(const VertexFormat& format, VBO& VBO, EBO& EBO);
+
+	// Number of formats (and so VAOs) the cache holds
+	unsigned int Size();
+
+	// Deletes every VAO of the cache
+	void Delete();
+
+	// Tells if the current context can share VAOs between buffers
+	static bool Supported();
+
+private:
+	std::map<VertexFormat, VAO> vaos;
+	// The same format gets asked for over and over, so the last one found skips the lookup
+	const VertexFormat* lastFormat = NULL;
+	VAO* lastVAO = NULL;
+};
+#endif
\ No newline at end of file
@@ -1,27 +1,117 @@
 #include"VBO.h"
 
+#include<utility>
+
+unsigned int VBO::alive = 0;
+
 // Constructor that generates a Vertex Buffer Object and links it to vertices
-VBO::VBO(std::vector<Vertex>& vertices)
+VBO::VBO(std::vector<Vertex>& vertices, BufferHeap* heap)
+{
+	upload(vertices.data(), vertices.size() * sizeof(Vertex), heap);
+}
+
+// Constructor that generates a Vertex Buffer Object and links it to the joints and weights of a skinned mesh
+VBO::VBO(std::vector<SkinVertex>& vertices, BufferHeap* heap)
+{
+	upload(vertices.data(), vertices.size() * sizeof(SkinVertex), heap);
+}
+
+// Puts the data into a buffer of its own or into the heap
+void VBO::upload(const void* data, size_t size, BufferHeap* heap)
+{
+	VBO::heap = heap;
+	if (heap != NULL)
+	{
+		allocation = heap->Upload(data, size);
+		ID = heap->Buffer(allocation);
+		offset = heap->Offset(allocation);
+		generation = heap->generation;
+		alive++;
+		return;
+	}
+	if (StateCache::DSA())
+	{
+		// Filled by name, so nothing has to be bound
+		glCreateBuffers(1, &ID);
+		glNamedBufferData(ID, size, data, GL_STATIC_DRAW);
+	}
+	else
+	{
+		glGenBuffers(1, &ID);
+		StateCache::BindBuffer(GL_ARRAY_BUFFER, ID);
+		glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+	}
+	alive++;
+}
+
+// Makes an empty VBO that owns nothing, something can be moved into it later
+VBO::VBO()
+{
+}
+
+VBO::VBO(VBO&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+VBO& VBO::operator=(VBO&& other) noexcept
+{
+	if (this != &other)
+	{
+		Delete();
+		ID = other.ID;
+		offset = other.offset;
+		heap = other.heap;
+		allocation = other.allocation;
+		generation = other.generation;
+		other.ID = 0;
+		other.heap = NULL;
+	}
+	return *this;
+}
+
+VBO::~VBO()
+{
+	Delete();
+}
+
+// Tells if the heap moved the vertices since the last call and updates ID and offset if it did
+bool VBO::Moved()
 {
-	glGenBuffers(1, &ID);
-	glBindBuffer(GL_ARRAY_BUFFER, ID);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+	if (heap == NULL || generation == heap->generation)
+		return false;
+	ID = heap->Buffer(allocation);
+	offset = heap->Offset(allocation);
+	generation = heap->generation;
+	return true;
 }
 
 // Binds the VBO
 void VBO::Bind()
 {
-	glBindBuffer(GL_ARRAY_BUFFER, ID);
+	StateCache::BindBuffer(GL_ARRAY_BUFFER, ID);
 }
 
 // Unbinds the VBO
 void VBO::Unbind()
 {
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	StateCache::BindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-// Deletes the VBO
+// Deletes the VBO (the destructor does this too, calling it earlier is fine)
 void VBO::Delete()
 {
-	glDeleteBuffers(1, &ID);
+	if (ID == 0)
+		return;
+	// The block is shared with other ranges, so only the range goes back
+	if (heap != NULL)
+		heap->Free(allocation);
+	else
+	{
+		StateCache::ForgetBuffer(ID);
+		glDeleteBuffers(1, &ID);
+	}
+	ID = 0;
+	heap = NULL;
+	alive--;
 }
\ No newline at end of file
@@ -5,6 +5,9 @@
 #include<glad/glad.h>
 #include<vector>
 
+#include"StateCache.h"
+#include"BufferHeap.h"
+
 // Structure to standardize the vertices used in the meshes
 struct Vertex
 {
@@ -14,22 +17,55 @@ struct Vertex
 	glm::vec2 texUV;
 };
 
+// Joints a vertex of a skinned mesh follows and how much each of them pulls it, kept apart from the vertices
+// so meshes that aren't skinned stay the same size (the joints are floats so they don't need integer attributes)
+struct SkinVertex
+{
+	glm::vec4 joints;
+	glm::vec4 weights;
+};
+
 
 
 class VBO
 {
 public:
-	// Reference ID of the Vertex Buffer Object
-	GLuint ID;
-	// Constructor that generates a Vertex Buffer Object and links it to vertices
-	VBO(std::vector<Vertex>& vertices);
+	// Reference ID of the Vertex Buffer Object (0 for an empty VBO)
+	GLuint ID = 0;
+	// Number of VBOs that own a buffer or heap range that wasn't deleted yet (anything left at exit is a leak)
+	static unsigned int alive;
+	// Where the vertices start in the buffer (only ever non zero when they live in a heap)
+	GLintptr offset = 0;
+	// Constructor that generates a Vertex Buffer Object and links it to vertices,
+	// with a heap the vertices get a range of one of its blocks instead of a buffer of their own
+	VBO(std::vector<Vertex>& vertices, BufferHeap* heap = NULL);
+	VBO(std::vector<SkinVertex>& vertices, BufferHeap* heap = NULL);
+	// Makes an empty VBO that owns nothing, something can be moved into it later
+	VBO();
+	// A VBO owns its buffer (or heap range), so it can only be moved and gets deleted with the object
+	VBO(const VBO&) = delete;
+	VBO& operator=(const VBO&) = delete;
+	VBO(VBO&& other) noexcept;
+	VBO& operator=(VBO&& other) noexcept;
+	~VBO();
+
+	// Tells if the heap moved the vertices since the last call and updates ID and offset if it did
+	bool Moved();
 
 	// Binds the VBO
 	void Bind();
 	// Unbinds the VBO
 	void Unbind();
-	// Deletes the VBO
+	// Deletes the VBO (the destructor does this too, calling it earlier is fine)
 	void Delete();
+
+private:
+	BufferHeap* heap = NULL;
+	unsigned int allocation = 0;
+	unsigned int generation = 0;
+
+	// Puts the data into a buffer of its own or into the heap
+	void upload(const void* data, size_t size, BufferHeap* heap);
 };
 
 #endif
\ No newline at end of file
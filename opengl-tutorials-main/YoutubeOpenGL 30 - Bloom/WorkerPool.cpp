@@ -0,0 +1,97 @@
+#include"WorkerPool.h"
+
+// Starts threads - 1 workers
+WorkerPool::WorkerPool(unsigned int threads) :
+	next(0)
+{
+	for (unsigned int i = 1; i < threads; i++)
+		workers.emplace_back(&WorkerPool::work, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	Delete();
+}
+
+// Threads a job gets spread over, counting the one that calls Run
+unsigned int WorkerPool::Threads()
+{
+	return (unsigned int)workers.size() + 1;
+}
+
+// Calls job(i) for every i below count on the workers and the calling thread
+void WorkerPool::Run(unsigned int count, const std::function<void(unsigned int)>& job)
+{
+	if (count == 0)
+		return;
+	// Not worth waking anybody up for
+	if (workers.empty() || count == 1)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			job(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		WorkerPool::job = &job;
+		WorkerPool::count = count;
+		next = 0;
+		busy = (unsigned int)workers.size();
+		batch++;
+	}
+	wake.notify_all();
+	drain(job, count);
+
+	// The job lives on the caller's stack, so every worker has to be done with it before returning
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this]() { return busy == 0; });
+	WorkerPool::job = NULL;
+}
+
+// Stops and joins the workers
+void WorkerPool::Delete()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+}
+
+// Loop of every worker
+void WorkerPool::work()
+{
+	unsigned long long seen = 0;
+	while (true)
+	{
+		const std::function<void(unsigned int)>* current;
+		unsigned int currentCount;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this, seen]() { return stopping || batch != seen; });
+			if (stopping)
+				return;
+			seen = batch;
+			current = job;
+			currentCount = count;
+		}
+		drain(*current, currentCount);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy--;
+			if (busy == 0)
+				finished.notify_one();
+		}
+	}
+}
+
+// Takes indices of the current job until there are none left
+void WorkerPool::drain(const std::function<void(unsigned int)>& job, unsigned int count)
+{
+	for (unsigned int i = next++; i < count; i = next++)
+		job(i);
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef WORKER_POOL_CLASS_H
+#define WORKER_POOL_CLASS_H
+
+#include<vector>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<atomic>
+#include<functional>
+
+// Threads that are started once and then wait for work, so splitting a job that has to run every frame only costs
+// waking them up instead of creating and joining threads. The thread that calls Run helps out and counts as one of them.
+class WorkerPool
+{
+public:
+	// Starts threads - 1 workers
+	WorkerPool(unsigned int threads = 4);
+	// The workers point back at the pool, so it can't be copied or moved
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	~WorkerPool();
+
+	// Threads a job gets spread over, counting the one that calls Run
+	unsigned int Threads();
+	// Calls job(i) for every i below count on the workers and the calling thread and returns once all of them are done
+	void Run(unsigned int count, const std::function<void(unsigned int)>& job);
+	// Stops and joins the workers (the destructor does this too, calling it earlier is fine)
+	void Delete();
+
+private:
+	std::vector<std::thread> workers;
+	// Everything below is guarded by the mutex, except for the next index which the threads take turns with
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	const std::function<void(unsigned int)>* job = NULL;
+	unsigned int count = 0;
+	std::atomic<unsigned int> next;
+	// Goes up with every call to Run so the workers can tell new work from a spurious wake up
+	unsigned long long batch = 0;
+	// Workers that are still busy with the current batch
+	unsigned int busy = 0;
+	bool stopping = false;
+
+	// Loop of every worker
+	void work();
+	// Takes indices of the current job until there are none left
+	void drain(const std::function<void(unsigned int)>& job, unsigned int count);
+};
+#endif
\ No newline at end of file
@@ -3,6 +3,8 @@
 // Outputs colors in RGBA
 layout (location = 0) out vec4 FragColor;
 layout (location = 1) out vec4 BloomColor;
+// Object and triangle under the pixel for picking
+layout (location = 2) out uvec2 PickID;
 
 // Imports the current position from the Vertex Shader
 in vec3 crntPos;
@@ -16,6 +18,8 @@ in vec2 texCoord;
 in vec3 lightPos;
 // Gets the position of the camera from the main function
 in vec3 camPos;
+// Imports the ID of the object from the Geometry Shader
+flat in uint objectID;
 
 
 // Gets the Texture Units from the main function
@@ -162,6 +166,8 @@ void main()
 {
 	// outputs final color
 	FragColor = pointLight();
+	// Triangles count from 0 in every draw, so the object tells them apart
+	PickID = uvec2(objectID, uint(gl_PrimitiveID));
 
 	// Make the red lines of the lava brighter
 	if (FragColor.r > 0.05f)
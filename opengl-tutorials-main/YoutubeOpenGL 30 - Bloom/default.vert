@@ -19,6 +19,7 @@ out DATA
 	mat4 model;
 	vec3 lightPos;
 	vec3 camPos;
+	flat uint objectID;
 } data_out;
 
 
@@ -34,6 +35,8 @@ uniform mat4 scale;
 uniform vec3 lightPos;
 // Gets the position of the camera from the main function
 uniform vec3 camPos;
+// What the ID buffer gets for this draw (0 is nothing)
+uniform uint objectID;
 
 void main()
 {
@@ -45,4 +48,5 @@ void main()
 	data_out.model = model * translation * rotation * scale;
 	data_out.lightPos = lightPos;
 	data_out.camPos = camPos;
+	data_out.objectID = objectID;
 }
\ No newline at end of file
@@ -0,0 +1,49 @@
+#version 330 core
+
+// Positions/Coordinates
+layout (location = 0) in vec3 aPos;
+// Normals (not necessarily normalized)
+layout (location = 1) in vec3 aNormal;
+// Colors
+layout (location = 2) in vec3 aColor;
+// Texture Coordinates
+layout (location = 3) in vec2 aTex;
+// Model matrix of the instance, streamed in by the RenderQueue when it merges draws
+layout (location = 4) in mat4 instanceMatrix;
+// What the ID buffer gets for the instance, streamed in next to the matrix
+layout (location = 10) in uint objectID;
+
+
+out DATA
+{
+    vec3 Normal;
+	vec3 color;
+	vec2 texCoord;
+    mat4 projection;
+	mat4 model;
+	vec3 lightPos;
+	vec3 camPos;
+	flat uint objectID;
+} data_out;
+
+
+
+// Imports the camera matrix
+uniform mat4 camMatrix;
+// Gets the position of the light from the main function
+uniform vec3 lightPos;
+// Gets the position of the camera from the main function
+uniform vec3 camPos;
+
+void main()
+{
+	gl_Position = instanceMatrix * vec4(aPos, 1.0f);
+	data_out.Normal = aNormal;
+	data_out.color = aColor;
+	data_out.texCoord = aTex;
+	data_out.projection = camMatrix;
+	data_out.model = instanceMatrix;
+	data_out.lightPos = lightPos;
+	data_out.camPos = camPos;
+	data_out.objectID = objectID;
+}
\ No newline at end of file
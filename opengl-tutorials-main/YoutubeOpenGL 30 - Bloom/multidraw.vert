@@ -0,0 +1,56 @@
+#version 460 core
+
+// Positions/Coordinates
+layout (location = 0) in vec3 aPos;
+// Normals (not necessarily normalized)
+layout (location = 1) in vec3 aNormal;
+// Colors
+layout (location = 2) in vec3 aColor;
+// Texture Coordinates
+layout (location = 3) in vec2 aTex;
+
+
+out DATA
+{
+    vec3 Normal;
+	vec3 color;
+	vec2 texCoord;
+    mat4 projection;
+	mat4 model;
+	vec3 lightPos;
+	vec3 camPos;
+	flat uint objectID;
+} data_out;
+
+
+
+// Model matrices of every draw in the pass, filled by the MeshPool each frame
+layout (std430, binding = 0) readonly buffer DrawParameters
+{
+	mat4 models[];
+};
+// Where the draws of the current multi draw call start in the array above
+uniform uint drawOffset;
+
+// Imports the camera matrix
+uniform mat4 camMatrix;
+// Gets the position of the light from the main function
+uniform vec3 lightPos;
+// Gets the position of the camera from the main function
+uniform vec3 camPos;
+
+void main()
+{
+	// gl_DrawID tells which command of the multi draw call this vertex belongs to
+	mat4 model = models[drawOffset + gl_DrawID];
+	gl_Position = model * vec4(aPos, 1.0f);
+	data_out.Normal = aNormal;
+	data_out.color = aColor;
+	data_out.texCoord = aTex;
+	data_out.projection = camMatrix;
+	data_out.model = model;
+	data_out.lightPos = lightPos;
+	data_out.camPos = camPos;
+	// The pool doesn't know the IDs of its draws, so nothing drawn by it can be picked
+	data_out.objectID = 0u;
+}
\ No newline at end of file
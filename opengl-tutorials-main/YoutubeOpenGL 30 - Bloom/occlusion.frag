@@ -0,0 +1,6 @@
+#version 330 core
+
+// Color writes are masked off while testing boxes, only the samples that pass the depth test matter
+void main()
+{
+}
\ No newline at end of file
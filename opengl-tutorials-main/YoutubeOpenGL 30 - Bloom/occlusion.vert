@@ -0,0 +1,13 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+// Imports the camera matrix
+uniform mat4 camMatrix;
+// Turns the unit cube into the world space box of the mesh that is being tested
+uniform mat4 box;
+
+void main()
+{
+	gl_Position = camMatrix * box * vec4(aPos, 1.0f);
+}
\ No newline at end of file
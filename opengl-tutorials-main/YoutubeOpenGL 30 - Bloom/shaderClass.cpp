@@ -1,4 +1,12 @@
 #include"shaderClass.h"
+#include"ShaderReloader.h"
+
+#include<filesystem>
+#include<utility>
+#include<mutex>
+
+unsigned int Shader::alive = 0;
+std::atomic<int> Shader::spirvNames(-1);
 
 // Reads a text file and outputs a string with everything in the text file
 std::string get_file_contents(const char* filename)
@@ -17,126 +25,303 @@ std::string get_file_contents(const char* filename)
 	throw(errno);
 }
 
+// Reads a shader file and pastes in every #include "file" it finds, storing all the files that were read
+std::string get_shader_source(const char* filename, std::vector<std::string>& dependencies)
+{
+	std::string contents = get_file_contents(filename);
+	dependencies.push_back(filename);
+
+	// Includes are relative to the file that includes them
+	std::string fileStr = std::string(filename);
+	std::string fileDirectory = fileStr.substr(0, fileStr.find_last_of("/\\") + 1);
+
+	std::stringstream in(contents);
+	std::string source;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		size_t directive = line.find_first_not_of(" \t");
+		if (directive != std::string::npos && line.compare(directive, 8, "#include") == 0)
+		{
+			size_t begin = line.find('"', directive);
+			size_t end = line.find('"', begin + 1);
+			if (begin == std::string::npos || end == std::string::npos)
+				throw std::invalid_argument("Malformed #include in " + fileStr);
+
+			std::string includePath = fileDirectory + line.substr(begin + 1, end - begin - 1);
+			// Skip files that were already pasted in so include cycles don't recurse forever
+			bool included = false;
+			for (unsigned int i = 0; i < dependencies.size(); i++)
+			{
+				if (dependencies[i] == includePath)
+				{
+					included = true;
+					break;
+				}
+			}
+			if (!included)
+				source += get_shader_source(includePath.c_str(), dependencies) + "\n";
+		}
+		else
+		{
+			source += line + "\n";
+		}
+	}
+	return source;
+}
+
+// Tells if a shader has an up to date SPIR-V binary next to it (made by the "shaders" build target)
+static bool has_spirv_binary(const std::string& file)
+{
+	std::error_code error;
+	std::filesystem::path binary = file + ".spv";
+	if (!std::filesystem::exists(binary, error))
+		return false;
+	std::filesystem::file_time_type binaryTime = std::filesystem::last_write_time(binary, error);
+	// A binary that is older than its source or anything the source includes would undo any edits made to the GLSL
+	std::vector<std::string> dependencies;
+	try
+	{
+		get_shader_source(file.c_str(), dependencies);
+	}
+	catch (...)
+	{
+		return false;
+	}
+	for (unsigned int i = 0; i < dependencies.size(); i++)
+	{
+		if (std::filesystem::last_write_time(dependencies[i], error) > binaryTime || error)
+			return false;
+	}
+	return true;
+}
+
+// SPIR-V doesn't have to keep the names of uniforms, but everything here looks uniforms up by name
+static bool uniforms_have_names(GLuint program)
+{
+	GLint numUniforms;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numUniforms);
+	for (GLuint i = 0; i < (GLuint)numUniforms; i++)
+	{
+		char name[256];
+		GLint size;
+		GLenum type;
+		GLint blockIndex;
+		glGetActiveUniform(program, i, sizeof(name), NULL, &size, &type, name);
+		glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+		// Uniforms inside of blocks never have a location
+		if (blockIndex == -1 && glGetUniformLocation(program, name) == -1)
+			return false;
+	}
+	return true;
+}
+
 // Constructor that build the Shader Program from 2 different shaders
 Shader::Shader(const char* vertexFile, const char* fragmentFile)
 {
-	// Read vertexFile and fragmentFile and store the strings
-	std::string vertexCode = get_file_contents(vertexFile);
-	std::string fragmentCode = get_file_contents(fragmentFile);
+	Shader::vertexFile = vertexFile;
+	Shader::fragmentFile = fragmentFile;
 
-	// Convert the shader source strings into character arrays
-	const char* vertexSource = vertexCode.c_str();
-	const char* fragmentSource = fragmentCode.c_str();
+	ID = Build(sourceFiles, &spirv);
+	if (ID != 0)
+		alive++;
+}
 
-	// Create Vertex Shader Object and get its reference
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	// Attach Vertex Shader source to the Vertex Shader Object
-	glShaderSource(vertexShader, 1, &vertexSource, NULL);
-	// Compile the Vertex Shader into machine code
-	glCompileShader(vertexShader);
-	// Checks if Shader compiled succesfully
-	compileErrors(vertexShader, "VERTEX");
-
-	// Create Fragment Shader Object and get its reference
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	// Attach Fragment Shader source to the Fragment Shader Object
-	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
-	// Compile the Vertex Shader into machine code
-	glCompileShader(fragmentShader);
-	// Checks if Shader compiled succesfully
-	compileErrors(fragmentShader, "FRAGMENT");
+Shader::Shader(const char* vertexFile, const char* fragmentFile, const char* geometryFile)
+{
+	Shader::vertexFile = vertexFile;
+	Shader::fragmentFile = fragmentFile;
+	Shader::geometryFile = geometryFile;
 
-	// Create Shader Program Object and get its reference
-	ID = glCreateProgram();
-	// Attach the Vertex and Fragment Shaders to the Shader Program
-	glAttachShader(ID, vertexShader);
-	glAttachShader(ID, fragmentShader);
-	// Wrap-up/Link all the shaders together into the Shader Program
-	glLinkProgram(ID);
-	// Checks if Shaders linked succesfully
-	compileErrors(ID, "PROGRAM");
+	ID = Build(sourceFiles, &spirv);
+	if (ID != 0)
+		alive++;
+}
 
-	// Delete the now useless Vertex and Fragment Shader objects
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+Shader::Shader(Shader&& other) noexcept
+{
+	*this = std::move(other);
 }
 
-Shader::Shader(const char* vertexFile, const char* fragmentFile, const char* geometryFile)
+Shader& Shader::operator=(Shader&& other) noexcept
 {
-	// Read vertexFile and fragmentFile and store the strings
-	std::string vertexCode = get_file_contents(vertexFile);
-	std::string fragmentCode = get_file_contents(fragmentFile);
-	std::string geometryCode = get_file_contents(geometryFile);
-
-	// Convert the shader source strings into character arrays
-	const char* vertexSource = vertexCode.c_str();
-	const char* fragmentSource = fragmentCode.c_str();
-	const char* geometrySource = geometryCode.c_str();
-
-	// Create Vertex Shader Object and get its reference
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	// Attach Vertex Shader source to the Vertex Shader Object
-	glShaderSource(vertexShader, 1, &vertexSource, NULL);
-	// Compile the Vertex Shader into machine code
-	glCompileShader(vertexShader);
-	// Checks if Shader compiled succesfully
-	compileErrors(vertexShader, "VERTEX");
-
-	// Create Fragment Shader Object and get its reference
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	// Attach Fragment Shader source to the Fragment Shader Object
-	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
-	// Compile the Fragment Shader into machine code
-	glCompileShader(fragmentShader);
-	// Checks if Shader compiled succesfully
-	compileErrors(fragmentShader, "FRAGMENT");
-
-	// Create Geometry Shader Object and get its reference
-	GLuint geometryShader = glCreateShader(GL_GEOMETRY_SHADER);
-	// Attach Geometry Shader source to the Fragment Shader Object
-	glShaderSource(geometryShader, 1, &geometrySource, NULL);
-	// Compile the Geometry Shader into machine code
-	glCompileShader(geometryShader);
-	// Checks if Shader compiled succesfully
-	compileErrors(geometryShader, "GEOMETRY");
+	if (this != &other)
+	{
+		Delete();
+		// The watcher thread mustn't build the other Shader while its files move over
+		std::unique_lock<std::mutex> guard;
+		if (other.reloader != NULL)
+			guard = std::unique_lock<std::mutex>(other.reloader->building);
+		ID = other.ID;
+		sourceFiles = std::move(other.sourceFiles);
+		spirv = other.spirv;
+		vertexFile = std::move(other.vertexFile);
+		fragmentFile = std::move(other.fragmentFile);
+		geometryFile = std::move(other.geometryFile);
+		other.ID = 0;
+		reloader = other.reloader;
+		other.reloader = NULL;
+		if (reloader != NULL)
+			reloader->repoint(&other, this);
+	}
+	return *this;
+}
+
+Shader::~Shader()
+{
+	Delete();
+}
+
+// Builds a new Shader Program from the shader files, returns 0 if compiling or linking failed
+GLuint Shader::Build(std::vector<std::string>& dependencies, bool* usedSPIRV)
+{
+	bool hasGeometry = !geometryFile.empty();
+
+	// SPIR-V can only be ingested by OpenGL 4.6 contexts and only if every stage has been precompiled,
+	// drivers that dropped the uniform names once will drop them for every other program too
+	bool spirv =
+		GLAD_GL_VERSION_4_6 &&
+		spirvNames != 0 &&
+		has_spirv_binary(vertexFile) &&
+		has_spirv_binary(fragmentFile) &&
+		(!hasGeometry || has_spirv_binary(geometryFile));
+
+	GLuint program = link(dependencies, spirv);
+	if (program != 0 && spirv)
+	{
+		bool names = uniforms_have_names(program);
+		spirvNames = names ? 1 : 0;
+		if (!names)
+		{
+			std::cout << "SPIR-V programs have no uniform names with this driver, compiling the GLSL of every shader instead" << std::endl;
+			glDeleteProgram(program);
+			spirv = false;
+			program = link(dependencies, spirv);
+		}
+	}
+
+	if (usedSPIRV != NULL)
+		*usedSPIRV = spirv;
+	return program;
+}
+
+// Links all the shader stages together into a new Shader Program
+GLuint Shader::link(std::vector<std::string>& dependencies, bool spirv)
+{
+	dependencies.clear();
+	bool hasGeometry = !geometryFile.empty();
+
+	// Remembers if any of the stages failed so the broken program can be thrown away
+	bool success = true;
+
+	// Read every stage before creating any shader objects, a file that is still being written throws here and
+	// would otherwise leave the stages that were already compiled behind
+	std::string vertexCode = readStage(vertexFile, dependencies, spirv);
+	std::string fragmentCode = readStage(fragmentFile, dependencies, spirv);
+	std::string geometryCode;
+	if (hasGeometry)
+		geometryCode = readStage(geometryFile, dependencies, spirv);
+
+	// Compile the Vertex, Fragment and Geometry Shaders
+	GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexCode, "VERTEX", spirv, success);
+	GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentCode, "FRAGMENT", spirv, success);
+	GLuint geometryShader = 0;
+	if (hasGeometry)
+		geometryShader = compileShader(GL_GEOMETRY_SHADER, geometryCode, "GEOMETRY", spirv, success);
 
 	// Create Shader Program Object and get its reference
-	ID = glCreateProgram();
-	// Attach the Vertex and Fragment Shaders to the Shader Program
-	glAttachShader(ID, vertexShader);
-	glAttachShader(ID, fragmentShader);
-	glAttachShader(ID, geometryShader);
+	GLuint program = glCreateProgram();
+	// Attach the Vertex, Fragment and Geometry Shaders to the Shader Program
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	if (hasGeometry)
+		glAttachShader(program, geometryShader);
 	// Wrap-up/Link all the shaders together into the Shader Program
-	glLinkProgram(ID);
+	glLinkProgram(program);
 	// Checks if Shaders linked succesfully
-	compileErrors(ID, "PROGRAM");
+	success &= compileErrors(program, "PROGRAM");
 
-	// Delete the now useless Vertex and Fragment Shader objects
+	// Delete the now useless Vertex, Fragment and Geometry Shader objects
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
-	glDeleteShader(geometryShader);
+	if (hasGeometry)
+		glDeleteShader(geometryShader);
+
+	if (!success)
+	{
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+// Reads a single shader stage, the GLSL with its includes pasted in or the SPIR-V binary next to it
+std::string Shader::readStage(const std::string& file, std::vector<std::string>& dependencies, bool spirv)
+{
+	std::string code = get_shader_source(file.c_str(), dependencies);
+	if (!spirv)
+		return code;
+	// The GLSL and the files it includes are still tracked so that editing them makes the shader fall back to the source
+	return get_file_contents((file + ".spv").c_str());
+}
+
+// Compiles a single shader stage from either its GLSL source or its SPIR-V binary
+GLuint Shader::compileShader(GLenum type, const std::string& code, const char* typeName, bool spirv, bool& success)
+{
+	// Create Shader Object and get its reference
+	GLuint shader = glCreateShader(type);
+	if (spirv)
+	{
+		// Hand the SPIR-V module to the driver and pick its entry point
+		glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V, code.data(), (GLsizei)code.size());
+		glSpecializeShader(shader, "main", 0, NULL, NULL);
+	}
+	else
+	{
+		// Convert the source string into a character array
+		const char* source = code.c_str();
+		// Attach the source to the Shader Object
+		glShaderSource(shader, 1, &source, NULL);
+		// Compile the Shader into machine code
+		glCompileShader(shader);
+	}
+	// Checks if Shader compiled succesfully
+	success &= compileErrors(shader, typeName);
+	return shader;
 }
 
 // Activates the Shader Program
 void Shader::Activate()
 {
-	glUseProgram(ID);
+	StateCache::UseProgram(ID);
 }
 
-// Deletes the Shader Program
+// Deletes the Shader Program and stops it from being reloaded
 void Shader::Delete()
 {
+	if (reloader != NULL)
+	{
+		// Waits for the watcher thread in case it is building this Shader right now
+		std::lock_guard<std::mutex> guard(reloader->building);
+		reloader->repoint(this, NULL);
+		reloader = NULL;
+	}
+	if (ID == 0)
+		return;
+	StateCache::ForgetProgram(ID);
 	glDeleteProgram(ID);
+	ID = 0;
+	alive--;
 }
 
 // Checks if the different Shaders have compiled properly
-void Shader::compileErrors(unsigned int shader, const char* type)
+bool Shader::compileErrors(unsigned int shader, const char* type)
 {
 	// Stores status of compilation
 	GLint hasCompiled;
 	// Character array to store error message in
 	char infoLog[1024];
-	if (type != "PROGRAM")
+	if (std::string(type) != "PROGRAM")
 	{
 		glGetShaderiv(shader, GL_COMPILE_STATUS, &hasCompiled);
 		if (hasCompiled == GL_FALSE)
@@ -154,4 +339,5 @@ void Shader::compileErrors(unsigned int shader, const char* type)
 			std::cout << "SHADER_LINKING_ERROR for:" << type << "\n" << infoLog << std::endl;
 		}
 	}
+	return hasCompiled == GL_TRUE;
 }
\ No newline at end of file
@@ -3,29 +3,72 @@
 
 #include<glad/glad.h>
 #include<string>
+#include<vector>
 #include<fstream>
 #include<sstream>
 #include<iostream>
 #include<cerrno>
+#include<atomic>
+
+#include"StateCache.h"
+
+class ShaderReloader;
 
 std::string get_file_contents(const char* filename);
+// Reads a shader file and pastes in every #include "file" it finds, storing all the files that were read
+std::string get_shader_source(const char* filename, std::vector<std::string>& dependencies);
 
 class Shader
 {
 public:
 	// Reference ID of the Shader Program
-	GLuint ID;
+	GLuint ID = 0;
+	// Number of Shader Programs that weren't deleted yet (anything left at exit is a leak)
+	static unsigned int alive;
+	// All the files the Shader Program was built from (including the ones pulled in by #include)
+	std::vector<std::string> sourceFiles;
 	// Constructor that build the Shader Program from 2 different shaders
 	Shader(const char* vertexFile, const char* fragmentFile);
 	Shader(const char* vertexFile, const char* fragmentFile, const char* geometryFile);
+	// A Shader owns its program, so it can only be moved and gets deleted with the object
+	// (a ShaderReloader that watches it follows it when it moves and forgets it when it gets deleted)
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
+	Shader(Shader&& other) noexcept;
+	Shader& operator=(Shader&& other) noexcept;
+	~Shader();
+
+	// Tells if the Shader Program was made from precompiled SPIR-V instead of GLSL
+	bool spirv = false;
 
+	// Builds a new Shader Program from the shader files, returns 0 if compiling or linking failed
+	GLuint Build(std::vector<std::string>& dependencies, bool* usedSPIRV = NULL);
 	// Activates the Shader Program
 	void Activate();
-	// Deletes the Shader Program
+	// Deletes the Shader Program and stops it from being reloaded (the destructor does this too, calling it earlier is fine)
 	void Delete();
 private:
+	friend class ShaderReloader;
+	// Reloader that watches the files of the Shader Program, if any
+	ShaderReloader* reloader = NULL;
+
+	// Paths of the shaders so the Shader Program can be rebuilt later on
+	std::string vertexFile;
+	std::string fragmentFile;
+	std::string geometryFile;
+
+	// Tells if the driver keeps the uniform names of SPIR-V programs (-1 until the first one was linked), everything here
+	// looks uniforms up by name, so once it didn't SPIR-V isn't tried again (atomic since the ShaderReloader builds on its own thread)
+	static std::atomic<int> spirvNames;
+
+	// Reads a single shader stage, the GLSL with its includes pasted in or the SPIR-V binary next to it
+	std::string readStage(const std::string& file, std::vector<std::string>& dependencies, bool spirv);
+	// Compiles a single shader stage from either its GLSL source or its SPIR-V binary
+	GLuint compileShader(GLenum type, const std::string& code, const char* typeName, bool spirv, bool& success);
+	// Links all the shader stages together into a new Shader Program
+	GLuint link(std::vector<std::string>& dependencies, bool spirv);
 	// Checks if the different Shaders have compiled properly
-	void compileErrors(unsigned int shader, const char* type);
+	bool compileErrors(unsigned int shader, const char* type);
 };
 
 
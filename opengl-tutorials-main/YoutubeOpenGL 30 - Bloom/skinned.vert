@@ -0,0 +1,66 @@
+#version 330 core
+
+// Positions/Coordinates
+layout (location = 0) in vec3 aPos;
+// Normals (not necessarily normalized)
+layout (location = 1) in vec3 aNormal;
+// Colors
+layout (location = 2) in vec3 aColor;
+// Texture Coordinates
+layout (location = 3) in vec2 aTex;
+// Joints that move the vertex and how much each of them pulls it (the weights add up to 1)
+layout (location = 8) in vec4 aJoints;
+layout (location = 9) in vec4 aWeights;
+
+
+out DATA
+{
+    vec3 Normal;
+	vec3 color;
+	vec2 texCoord;
+    mat4 projection;
+	mat4 model;
+	vec3 lightPos;
+	vec3 camPos;
+	flat uint objectID;
+} data_out;
+
+
+
+// Imports the camera matrix
+uniform mat4 camMatrix;
+// Imports the transformation matrices
+uniform mat4 model;
+uniform mat4 translation;
+uniform mat4 rotation;
+uniform mat4 scale;
+// Gets the position of the light from the main function
+uniform vec3 lightPos;
+// Gets the position of the camera from the main function
+uniform vec3 camPos;
+// What the ID buffer gets for this draw (0 is nothing)
+uniform uint objectID;
+// Palette of the skin, filled by the Animator (the size has to match Skin::maxJoints)
+layout (std140) uniform Joints
+{
+	mat4 joints[128];
+};
+
+void main()
+{
+	mat4 skin =
+		aWeights.x * joints[int(aJoints.x)] +
+		aWeights.y * joints[int(aJoints.y)] +
+		aWeights.z * joints[int(aJoints.z)] +
+		aWeights.w * joints[int(aJoints.w)];
+	mat4 world = model * translation * rotation * scale * skin;
+	gl_Position = world * vec4(aPos, 1.0f);
+	data_out.Normal = aNormal;
+	data_out.color = aColor;
+	data_out.texCoord = aTex;
+	data_out.projection = camMatrix;
+	data_out.model = world;
+	data_out.lightPos = lightPos;
+	data_out.camPos = camPos;
+	data_out.objectID = objectID;
+}
\ No newline at end of file
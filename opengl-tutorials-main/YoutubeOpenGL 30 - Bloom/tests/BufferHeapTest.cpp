@@ -0,0 +1,252 @@
+// Stress test of the BufferHeap without a GPU: the buffer functions of glad point at fakes that keep every buffer
+// in memory, so the contents of every range can be checked after allocating, freeing and compacting at random
+#include"BufferHeap.h"
+
+#include<iostream>
+#include<map>
+#include<random>
+#include<cstring>
+#include<iterator>
+#include<algorithm>
+#include<stdexcept>
+
+// Buffers the heap made, what they hold and which one is bound to which target
+static std::map<GLuint, std::vector<unsigned char>> buffers;
+static std::map<GLenum, GLuint> bindings;
+static GLuint nextBuffer = 1;
+// Frame the fake GPU has finished, fences signal once that is past the frame they were made in
+static long long gpuFrame = 0;
+static long long cpuFrame = 0;
+static std::vector<long long> fences;
+
+static void APIENTRY fakeGenBuffers(GLsizei n, GLuint* ids)
+{
+	for (GLsizei i = 0; i < n; i++)
+	{
+		ids[i] = nextBuffer++;
+		buffers[ids[i]];
+	}
+}
+
+static void APIENTRY fakeDeleteBuffers(GLsizei n, const GLuint* ids)
+{
+	for (GLsizei i = 0; i < n; i++)
+		buffers.erase(ids[i]);
+}
+
+static void APIENTRY fakeBindBuffer(GLenum target, GLuint buffer)
+{
+	bindings[target] = buffer;
+}
+
+static void APIENTRY fakeBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum)
+{
+	std::vector<unsigned char>& buffer = buffers.at(bindings[target]);
+	buffer.assign(size, 0xCD);
+	if (data != NULL)
+		std::memcpy(buffer.data(), data, size);
+}
+
+static void APIENTRY fakeBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	std::vector<unsigned char>& buffer = buffers.at(bindings[target]);
+	if (offset < 0 || offset + size > (GLsizeiptr)buffer.size())
+		throw std::out_of_range("glBufferSubData outside of the buffer");
+	std::memcpy(buffer.data() + offset, data, size);
+}
+
+static void APIENTRY fakeCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+{
+	std::vector<unsigned char>& source = buffers.at(bindings[readTarget]);
+	std::vector<unsigned char>& destination = buffers.at(bindings[writeTarget]);
+	if (readOffset + size > (GLsizeiptr)source.size() || writeOffset + size > (GLsizeiptr)destination.size())
+		throw std::out_of_range("glCopyBufferSubData outside of a buffer");
+	std::memcpy(destination.data() + writeOffset, source.data() + readOffset, size);
+}
+
+static GLsync APIENTRY fakeFenceSync(GLenum, GLbitfield)
+{
+	fences.push_back(cpuFrame);
+	return (GLsync)(fences.size());
+}
+
+static GLenum APIENTRY fakeClientWaitSync(GLsync sync, GLbitfield, GLuint64)
+{
+	return fences[(size_t)sync - 1] < gpuFrame ? GL_ALREADY_SIGNALED : GL_TIMEOUT_EXPIRED;
+}
+
+static void APIENTRY fakeDeleteSync(GLsync)
+{
+}
+
+static int failures = 0;
+
+static void check(bool condition, const char* what)
+{
+	if (condition)
+		return;
+	std::cout << "FAILED: " << what << std::endl;
+	failures++;
+}
+
+// Byte every allocation gets filled with, different for every upload so stale data shows up
+static unsigned char pattern(unsigned int upload, GLsizeiptr byte)
+{
+	return (unsigned char)(upload * 31 + byte * 7);
+}
+
+struct Live
+{
+	unsigned int upload;
+	GLsizeiptr size;
+};
+
+// Checks that every live range still holds what was uploaded and that no two of them overlap
+static void checkLive(BufferHeap& heap, std::map<unsigned int, Live>& live)
+{
+	std::map<std::pair<GLuint, GLintptr>, GLsizeiptr> placed;
+	for (std::map<unsigned int, Live>::iterator it = live.begin(); it != live.end(); it++)
+	{
+		GLuint buffer = heap.Buffer(it->first);
+		GLintptr offset = heap.Offset(it->first);
+		check(offset % BufferHeap::granularity == 0, "offsets are multiples of the granularity");
+		std::vector<unsigned char>& data = buffers.at(buffer);
+		check(offset + it->second.size <= (GLsizeiptr)data.size(), "ranges fit into their buffer");
+		bool intact = true;
+		for (GLsizeiptr i = 0; i < it->second.size && offset + i < (GLsizeiptr)data.size(); i++)
+			intact &= data[offset + i] == pattern(it->second.upload, i);
+		check(intact, "ranges keep their data");
+		placed[std::make_pair(buffer, offset)] = it->second.size;
+	}
+	for (std::map<std::pair<GLuint, GLintptr>, GLsizeiptr>::iterator it = placed.begin(); it != placed.end(); it++)
+	{
+		std::map<std::pair<GLuint, GLintptr>, GLsizeiptr>::iterator next = std::next(it);
+		if (next != placed.end() && next->first.first == it->first.first)
+			check(it->first.second + it->second <= next->first.second, "ranges don't overlap");
+	}
+}
+
+// Uploads a range of size bytes filled with its pattern
+static unsigned int upload(BufferHeap& heap, std::map<unsigned int, Live>& live, GLsizeiptr size, unsigned int& uploads)
+{
+	std::vector<unsigned char> data(size);
+	for (GLsizeiptr i = 0; i < size; i++)
+		data[i] = pattern(uploads, i);
+	unsigned int allocation = heap.Upload(data.data(), size);
+	check(live.count(allocation) == 0, "handles of live ranges aren't handed out twice");
+	live[allocation] = Live{ uploads++, size };
+	return allocation;
+}
+
+// Allocations that are bigger than a block and don't fill a whole size class used to find no range in their own block
+void testOversized()
+{
+	const GLsizeiptr blockSize = 64 * 1024;
+	BufferHeap heap(blockSize);
+	std::map<unsigned int, Live> live;
+	unsigned int uploads = 0;
+	GLsizeiptr sizes[] = { blockSize + BufferHeap::granularity, blockSize * 3 + 1, blockSize * 2 + BufferHeap::granularity * 17, 100 };
+	for (GLsizeiptr size : sizes)
+		upload(heap, live, size, uploads);
+	checkLive(heap, live);
+	// 65537 granules with the default block size, the size from the bug report
+	BufferHeap bigHeap;
+	std::map<unsigned int, Live> bigLive;
+	upload(bigHeap, bigLive, 65537 * BufferHeap::granularity, uploads);
+	checkLive(bigHeap, bigLive);
+}
+
+// Allocates, frees, ends frames and compacts at random and checks every range after every step
+void testRandom()
+{
+	std::mt19937 random(1234);
+	BufferHeap heap(256 * 1024);
+	std::map<unsigned int, Live> live;
+	// Ranges that were freed and the frame they were freed in, none of them may be handed out before the GPU finished that frame
+	struct Freed
+	{
+		GLuint buffer;
+		GLintptr offset;
+		GLsizeiptr size;
+		long long frame;
+	};
+	std::vector<Freed> freed;
+	unsigned int uploads = 0;
+
+	for (unsigned int step = 0; step < 10000; step++)
+	{
+		unsigned int action = random() % 1000;
+		if (action < 520 || live.empty())
+		{
+			// Mostly mesh sized allocations, every now and then one that needs a block of its own
+			GLsizeiptr size = random() % 50 == 0 ? 256 * 1024 + random() % (512 * 1024) : 1 + random() % 20000;
+			unsigned int allocation = upload(heap, live, size, uploads);
+			GLuint buffer = heap.Buffer(allocation);
+			GLintptr offset = heap.Offset(allocation);
+			for (unsigned int i = 0; i < freed.size(); i++)
+			{
+				bool overlaps = freed[i].buffer == buffer && offset < freed[i].offset + freed[i].size && freed[i].offset < offset + size;
+				check(!(overlaps && freed[i].frame >= gpuFrame), "freed ranges aren't reused before the GPU is done with them");
+			}
+		}
+		else if (action < 960)
+		{
+			std::map<unsigned int, Live>::iterator victim = live.begin();
+			std::advance(victim, random() % live.size());
+			freed.push_back(Freed{ heap.Buffer(victim->first), heap.Offset(victim->first), victim->second.size, cpuFrame });
+			heap.Free(victim->first);
+			live.erase(victim);
+		}
+		else if (action < 997)
+		{
+			// The GPU falls behind by up to two frames
+			heap.EndFrame();
+			cpuFrame++;
+			gpuFrame = std::max(gpuFrame, cpuFrame - (long long)(random() % 3));
+			// Ranges of frames the GPU finished may be reused from now on
+			std::vector<Freed> pending;
+			for (unsigned int i = 0; i < freed.size(); i++)
+				if (freed[i].frame >= gpuFrame)
+					pending.push_back(freed[i]);
+			freed.swap(pending);
+		}
+		else
+		{
+			heap.Compact();
+			checkLive(heap, live);
+			// Compacting copied everything into new buffers, the old ones are gone
+			freed.clear();
+		}
+		if (step % 1000 == 0)
+			checkLive(heap, live);
+	}
+	checkLive(heap, live);
+
+	BufferHeap::Stats stats = heap.GetStats();
+	GLsizeiptr requested = 0;
+	for (std::map<unsigned int, Live>::iterator it = live.begin(); it != live.end(); it++)
+		requested += it->second.size;
+	check(stats.allocations == live.size(), "stats count the live allocations");
+	check(stats.requested == requested, "stats count the requested bytes");
+	std::cout << uploads << " uploads, " << live.size() << " live, " << stats.bufferObjects << " buffers, " << stats.compactions << " compactions" << std::endl;
+}
+
+int main()
+{
+	glad_glGenBuffers = fakeGenBuffers;
+	glad_glDeleteBuffers = fakeDeleteBuffers;
+	glad_glBindBuffer = fakeBindBuffer;
+	glad_glBufferData = fakeBufferData;
+	glad_glBufferSubData = fakeBufferSubData;
+	glad_glCopyBufferSubData = fakeCopyBufferSubData;
+	glad_glFenceSync = fakeFenceSync;
+	glad_glClientWaitSync = fakeClientWaitSync;
+	glad_glDeleteSync = fakeDeleteSync;
+
+	testOversized();
+	testRandom();
+
+	if (failures == 0)
+		std::cout << "BufferHeap passed" << std::endl;
+	return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
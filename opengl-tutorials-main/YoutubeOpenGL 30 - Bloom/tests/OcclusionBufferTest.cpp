@@ -0,0 +1,202 @@
+// Tests of the OcclusionBuffer on the CPU alone: the rasterizer against a plain reference rasterizer, one thread against
+// several, and the box test against walls and against points sampled inside of the boxes it calls hidden
+#include"OcclusionBuffer.h"
+
+#include<iostream>
+#include<random>
+#include<cmath>
+#include<glm/gtc/matrix_transform.hpp>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what)
+{
+	if (condition)
+		return;
+	std::cout << "FAILED: " << what << std::endl;
+	failures++;
+}
+
+// Depth every pixel should get, found by testing every pixel center against every triangle in double precision.
+// Pixels that are this close to an edge could go either way and are marked with NaN
+static std::vector<double> reference(const OcclusionBuffer::Occluder& occluder, unsigned int width, unsigned int height)
+{
+	std::vector<double> depth(width * height, 1.0);
+	for (unsigned int t = 0; t + 2 < occluder.indices.size(); t += 3)
+	{
+		glm::dvec3 v[3];
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			glm::vec3 p = occluder.positions[occluder.indices[t + i]];
+			v[i] = glm::dvec3((p.x * 0.5 + 0.5) * width, (p.y * 0.5 + 0.5) * height, p.z);
+		}
+		double area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+		if (area == 0.0)
+			continue;
+		for (unsigned int y = 0; y < height; y++)
+		{
+			for (unsigned int x = 0; x < width; x++)
+			{
+				glm::dvec2 p = glm::dvec2(x + 0.5, y + 0.5);
+				// Barycentric coordinates, all of them positive inside of the triangle whichever way it winds
+				double b[3];
+				for (unsigned int i = 0; i < 3; i++)
+				{
+					const glm::dvec3& from = v[(i + 1) % 3];
+					const glm::dvec3& to = v[(i + 2) % 3];
+					b[i] = ((to.x - from.x) * (p.y - from.y) - (to.y - from.y) * (p.x - from.x)) / area;
+				}
+				double smallest = std::min(std::min(b[0], b[1]), b[2]);
+				double& pixel = depth[y * width + x];
+				if (std::fabs(smallest) < 1e-4)
+					pixel = NAN;
+				else if (smallest > 0.0 && !std::isnan(pixel))
+					pixel = std::min(pixel, b[0] * v[0].z + b[1] * v[1].z + b[2] * v[2].z);
+			}
+		}
+	}
+	return depth;
+}
+
+// Triangles scattered over (and a bit past) the screen, in clip space already so the camera matrix can stay the identity
+static OcclusionBuffer::Occluder randomOccluder(std::mt19937& random, unsigned int count)
+{
+	std::uniform_real_distribution<float> position(-1.3f, 1.3f);
+	std::uniform_real_distribution<float> depth(-0.9f, 0.9f);
+	OcclusionBuffer::Occluder occluder;
+	for (unsigned int i = 0; i < count * 3; i++)
+	{
+		occluder.positions.push_back(glm::vec3(position(random), position(random), depth(random)));
+		occluder.indices.push_back(i);
+	}
+	return occluder;
+}
+
+// Rasterizes random triangles and compares every pixel with the reference, and the result of one thread with four
+void testRasterizer()
+{
+	std::mt19937 random(42);
+	OcclusionBuffer single(64, 48, 1);
+	OcclusionBuffer threaded(64, 48, 4);
+	unsigned int compared = 0;
+	for (unsigned int frame = 0; frame < 50; frame++)
+	{
+		OcclusionBuffer::Occluder occluder = randomOccluder(random, 1 + frame % 8);
+		single.Begin(glm::mat4(1.0f));
+		single.Add(occluder);
+		single.Rasterize();
+		threaded.Begin(glm::mat4(1.0f));
+		threaded.Add(occluder);
+		threaded.Rasterize();
+		check(single.Depth() == threaded.Depth(), "every thread count rasterizes the same depth");
+
+		std::vector<double> expected = reference(occluder, single.Width(), single.Height());
+		bool matches = true;
+		for (unsigned int i = 0; i < expected.size(); i++)
+		{
+			if (std::isnan(expected[i]))
+				continue;
+			matches &= std::fabs(single.Depth()[i] - expected[i]) < 1e-4;
+			compared++;
+		}
+		check(matches, "the rasterizer matches the reference rasterizer");
+	}
+	check(compared > 50 * 64 * 40, "most pixels are far enough from the edges to be compared");
+}
+
+// A wall in front of a perspective camera hides what is behind it and nothing else
+void testWall()
+{
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 2.0f, 0.1f, 100.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	OcclusionBuffer buffer(256, 128, 4);
+	OcclusionBuffer::Occluder wall;
+	wall.positions = { glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(-1.0f, 1.0f, 0.0f) };
+	wall.indices = { 0, 1, 2, 0, 2, 3 };
+	buffer.Begin(projection * view);
+	// Two units wide and tall, ten units in front of the camera
+	buffer.Add(wall, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -10.0f)));
+	buffer.Rasterize();
+
+	auto box = [](glm::vec3 center, float size)
+	{
+		AABB result;
+		result.Add(center - glm::vec3(size * 0.5f));
+		result.Add(center + glm::vec3(size * 0.5f));
+		return result;
+	};
+	check(!buffer.Test(box(glm::vec3(0.0f, 0.0f, -20.0f), 1.0f)), "a box right behind the wall is hidden");
+	check(!buffer.Test(box(glm::vec3(0.5f, -0.5f, -40.0f), 2.0f)), "a box far behind the wall is hidden");
+	check(buffer.Test(box(glm::vec3(0.0f, 0.0f, -5.0f), 1.0f)), "a box in front of the wall is visible");
+	check(buffer.Test(box(glm::vec3(0.0f, 0.0f, -10.0f), 1.0f)), "a box that pokes through the wall is visible");
+	check(buffer.Test(box(glm::vec3(6.0f, 0.0f, -20.0f), 1.0f)), "a box next to the wall is visible");
+	check(buffer.Test(box(glm::vec3(1.9f, 0.0f, -20.0f), 1.0f)), "a box half behind the edge of the wall is visible");
+	check(buffer.Test(box(glm::vec3(0.0f, 0.0f, 0.0f), 1.0f)), "a box around the camera is visible");
+	check(buffer.Test(box(glm::vec3(0.0f, 0.0f, 20.0f), 1.0f)), "a box behind the camera isn't called hidden");
+	OcclusionBuffer::Stats stats = buffer.GetStats();
+	check(stats.tested == 8 && stats.occluded == 2, "the stats count the tests and the hidden boxes");
+}
+
+// Boxes the test calls hidden must not have a single point in front of the depth buffer
+void testConservative()
+{
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 100.0f);
+	OcclusionBuffer buffer(128, 96, 4);
+	unsigned int hidden = 0;
+	for (unsigned int frame = 0; frame < 20; frame++)
+	{
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(unit(random) - 0.5f, unit(random) - 0.5f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 cameraMatrix = projection * view;
+		buffer.Begin(cameraMatrix);
+		// A few walls in front of the camera at different depths and angles
+		OcclusionBuffer::Occluder wall;
+		wall.positions = { glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(-1.0f, 1.0f, 0.0f) };
+		wall.indices = { 0, 1, 2, 0, 2, 3 };
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(unit(random) * 8.0f - 4.0f, unit(random) * 6.0f - 3.0f, -5.0f - unit(random) * 10.0f));
+			matrix = glm::rotate(matrix, unit(random) - 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+			buffer.Add(wall, glm::scale(matrix, glm::vec3(1.0f + unit(random) * 3.0f)));
+		}
+		buffer.Rasterize();
+
+		for (unsigned int b = 0; b < 500; b++)
+		{
+			AABB box;
+			glm::vec3 center = glm::vec3(unit(random) * 20.0f - 10.0f, unit(random) * 14.0f - 7.0f, -8.0f - unit(random) * 30.0f);
+			box.Add(center - glm::vec3(unit(random) + 0.1f));
+			box.Add(center + glm::vec3(unit(random) + 0.1f));
+			if (buffer.Test(box))
+				continue;
+			hidden++;
+			bool covered = true;
+			for (unsigned int s = 0; s < 64; s++)
+			{
+				glm::vec3 point = box.min + (box.max - box.min) * glm::vec3(unit(random), unit(random), unit(random));
+				glm::vec4 clip = cameraMatrix * glm::vec4(point, 1.0f);
+				glm::vec3 ndc = glm::vec3(clip) / clip.w;
+				int x = (int)std::floor((ndc.x * 0.5f + 0.5f) * buffer.Width());
+				int y = (int)std::floor((ndc.y * 0.5f + 0.5f) * buffer.Height());
+				if (x < 0 || y < 0 || x >= (int)buffer.Width() || y >= (int)buffer.Height())
+					continue;
+				covered &= buffer.Depth()[y * buffer.Width() + x] < ndc.z;
+			}
+			check(covered, "boxes that are called hidden are behind the depth buffer everywhere");
+		}
+	}
+	check(hidden > 0, "some of the boxes end up hidden");
+	std::cout << hidden << " of " << 20 * 500 << " boxes were hidden" << std::endl;
+}
+
+int main()
+{
+	testRasterizer();
+	testWall();
+	testConservative();
+
+	if (failures == 0)
+		std::cout << "OcclusionBuffer passed" << std::endl;
+	return failures == 0 ? 0 : 1;
+}
\ No newline at end of file